@@ -0,0 +1,246 @@
+#include "abm.h"
+#include <math.h>
+#include <stdio.h>
+
+#define ABM_SAFETY 0.9
+#define ABM_MIN_SCALE 0.2
+// a restart costs order - 1 rk4 steps, so the step only grows once it can double
+#define ABM_GROW_SCALE 2.0
+
+// bashforth weights for f_n, f_n-1, ... and moulton weights for f_n+1, f_n, ...
+static const double abm__ab[ABM_MAX_ORDER + 1][ABM_MAX_ORDER] =
+{
+    {0},
+    {1},
+    {3 / 2.0, -1 / 2.0},
+    {23 / 12.0, -16 / 12.0, 5 / 12.0},
+    {55 / 24.0, -59 / 24.0, 37 / 24.0, -9 / 24.0},
+    {1901 / 720.0, -2774 / 720.0, 2616 / 720.0, -1274 / 720.0, 251 / 720.0},
+};
+
+static const double abm__am[ABM_MAX_ORDER + 1][ABM_MAX_ORDER] =
+{
+    {0},
+    {1},
+    {1 / 2.0, 1 / 2.0},
+    {5 / 12.0, 8 / 12.0, -1 / 12.0},
+    {9 / 24.0, 19 / 24.0, -5 / 24.0, 1 / 24.0},
+    {251 / 720.0, 646 / 720.0, -264 / 720.0, 106 / 720.0, -19 / 720.0},
+};
+
+// error constants of both formulas, milne's device turns the gap between
+// predictor and corrector into the corrector's local error
+static const double abm__ab_error[ABM_MAX_ORDER + 1] = {0, 1 / 2.0, 5 / 12.0, 3 / 8.0, 251 / 720.0, 95 / 288.0};
+static const double abm__am_error[ABM_MAX_ORDER + 1] = {0, 1 / 2.0, 1 / 12.0, 1 / 24.0, 19 / 720.0, 3 / 160.0};
+
+static inline double *abm__f(abm_t *abm, u32 back)
+{
+    return abm->f[(abm->head + ABM_MAX_ORDER - back) % ABM_MAX_ORDER];
+}
+
+static inline void abm__push(abm_t *abm, const double *f, u32 dim)
+{
+    abm->head = (abm->head + 1) % ABM_MAX_ORDER;
+    memcpy(abm->f[abm->head], f, dim * sizeof(*f));
+    if (abm->count < abm->order)
+        abm->count ++;
+}
+
+void init_abm(abm_t *abm, u32 order, int pece)
+{
+    memset(abm, 0, sizeof(*abm));
+    abm->order = order < ABM_MIN_ORDER ? ABM_MIN_ORDER : order > ABM_MAX_ORDER ? ABM_MAX_ORDER : order;
+    abm->pece = pece;
+}
+
+void abm_restart(abm_t *abm, ode_t *ode, double x, const double *y, double h)
+{
+    abm->x = x;
+    abm->h = h;
+    abm->head = 0;
+    abm->count = 1;
+    memcpy(abm->y, y, ode->dim * sizeof(*y));
+    ode_eval(ode, x, y, abm->f[0]);
+}
+
+// one rk4 step from (x, y) with k1 = f(x, y) already known, out may be y
+static void abm__rk4(ode_t *ode, double x, const double *y, const double *k1, double h, double *out)
+{
+    const u32 n = ode->dim;
+    double k2[ODE_MAX_DIM], k3[ODE_MAX_DIM], k4[ODE_MAX_DIM], t[ODE_MAX_DIM];
+
+    for (u32 i = 0; i < n; i ++) t[i] = y[i] + h / 2 * k1[i];
+    ode_eval(ode, x + h / 2, t, k2);
+    for (u32 i = 0; i < n; i ++) t[i] = y[i] + h / 2 * k2[i];
+    ode_eval(ode, x + h / 2, t, k3);
+    for (u32 i = 0; i < n; i ++) t[i] = y[i] + h * k3[i];
+    ode_eval(ode, x + h, t, k4);
+    for (u32 i = 0; i < n; i ++)
+        out[i] = y[i] + h / 6 * (k1[i] + 2 * k2[i] + 2 * k3[i] + k4[i]);
+}
+
+// rk4 that reuses the f already in the history as its first stage. with err
+// the step is taken as two halves and once whole, the gap over 15 estimates
+// the error of the halves, which are kept
+static void abm__bootstrap(abm_t *abm, ode_t *ode, double *err)
+{
+    const u32 n = ode->dim;
+    const double h = abm->h, x = abm->x;
+    const double *k1 = abm__f(abm, 0);
+    double whole[ODE_MAX_DIM], f[ODE_MAX_DIM];
+
+    if (err)
+    {
+        abm__rk4(ode, x, abm->y, k1, h, whole);
+        abm__rk4(ode, x, abm->y, k1, h / 2, abm->y);
+        ode_eval(ode, x + h / 2, abm->y, f);
+        abm__rk4(ode, x + h / 2, abm->y, f, h / 2, abm->y);
+        for (u32 i = 0; i < n; i ++)
+            err[i] = (abm->y[i] - whole[i]) / 15;
+    }
+    else
+        abm__rk4(ode, x, abm->y, k1, h, abm->y);
+
+    abm->x = x + h;
+    ode_eval(ode, abm->x, abm->y, f);
+    abm__push(abm, f, n);
+}
+
+void abm_step(abm_t *abm, ode_t *ode, double *err)
+{
+    const u32 n = ode->dim, k = abm->order;
+    const double h = abm->h;
+    double yp[ODE_MAX_DIM], fp[ODE_MAX_DIM], yc[ODE_MAX_DIM];
+
+    if (abm->count < k)
+    {
+        abm__bootstrap(abm, ode, err);
+        return;
+    }
+
+    for (u32 i = 0; i < n; i ++)
+    {
+        double s = 0;
+        for (u32 j = 0; j < k; j ++)
+            s += abm__ab[k][j] * abm__f(abm, j)[i];
+        yp[i] = abm->y[i] + h * s;
+    }
+    ode_eval(ode, abm->x + h, yp, fp);
+
+    for (u32 i = 0; i < n; i ++)
+    {
+        double s = abm__am[k][0] * fp[i];
+        for (u32 j = 1; j < k; j ++)
+            s += abm__am[k][j] * abm__f(abm, j - 1)[i];
+        yc[i] = abm->y[i] + h * s;
+    }
+
+    if (err)
+    {
+        const double milne = abm__am_error[k] / (abm__ab_error[k] + abm__am_error[k]);
+        for (u32 i = 0; i < n; i ++)
+            err[i] = milne * (yc[i] - yp[i]);
+    }
+
+    abm->x += h;
+    memcpy(abm->y, yc, n * sizeof(*yc));
+    if (abm->pece)
+        ode_eval(ode, abm->x, abm->y, fp);
+    abm__push(abm, fp, n);
+}
+
+static int abm__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const u32 n = ode->dim;
+    const double dir = p->x1 >= p->x0 ? 1 : -1;
+    const int adaptive = p->rtol > 0;
+    double err[ODE_MAX_DIM], x_prev, y_prev[ODE_MAX_DIM];
+    abm_t abm;
+
+    init_abm(&abm, solver->variant & 0xff, !(solver->variant & 0x100));
+    abm_restart(&abm, ode, p->x0, p->y0, fabs(p->h) * dir);
+    if (emit && !emit(user, abm.x, abm.y, n))
+        return 0;
+
+    if (!adaptive)
+    {
+        u64 steps = solve_step_count(p);
+        if (steps > p->max_steps)
+            return 0;
+        for (u64 i = 0; i < steps; i ++)
+        {
+            // a cut last step has no history at its size and restarts
+            if (solve_step_h(p, steps, i) != p->h)
+                abm_restart(&abm, ode, abm.x, abm.y, solve_step_h(p, steps, i));
+            abm_step(&abm, ode, NULL);
+            abm.x = solve_step_x(p, steps, i + 1);
+            stats->steps ++;
+            if (emit && !emit(user, abm.x, abm.y, n))
+                return 0;
+        }
+        return 1;
+    }
+
+    while ((p->x1 - abm.x) * dir > 0)
+    {
+        if (stats->steps + stats->rejected >= p->max_steps)
+            return 0;
+        // the last step is cut to land on x1, which needs a fresh history
+        if ((abm.x + abm.h - p->x1) * dir > 0)
+            abm_restart(&abm, ode, abm.x, abm.y, p->x1 - abm.x);
+
+        x_prev = abm.x;
+        memcpy(y_prev, abm.y, n * sizeof(*y_prev));
+        // bootstrap steps are held to their step doubling estimate of rk4
+        const int bootstrap = abm.count < abm.order;
+        const u32 order = bootstrap ? 4 : abm.order;
+        abm_step(&abm, ode, err);
+
+        double e = 0;
+        for (u32 i = 0; i < n; i ++)
+        {
+            double sc = p->atol + p->rtol * fmax(fabs(y_prev[i]), fabs(abm.y[i]));
+            double r  = fabs(err[i]) / sc;
+            e = r > e ? r : e;
+        }
+        double scale = e > 0 ? ABM_SAFETY * pow(e, -1.0 / (order + 1)) : ABM_GROW_SCALE;
+
+        if (!(e <= 1))
+        {
+            stats->rejected ++;
+            scale = isfinite(scale) ? fmax(ABM_MIN_SCALE, scale) : ABM_MIN_SCALE;
+            abm_restart(&abm, ode, x_prev, y_prev, abm.h * scale);
+            if (fabs(abm.h) < 1e-14 * fmax(1, fabs(x_prev)))
+                return 0;
+            continue;
+        }
+
+        stats->steps ++;
+        if (emit && !emit(user, abm.x, abm.y, n))
+            return 0;
+        // rk4 is no guide to what the multistep formula can take
+        if (scale >= ABM_GROW_SCALE && !bootstrap)
+            abm_restart(&abm, ode, abm.x, abm.y, abm.h * ABM_GROW_SCALE);
+    }
+    return 1;
+}
+
+u32 abm_solver_count(void)
+{
+    return 2 * (ABM_MAX_ORDER - ABM_MIN_ORDER + 1);
+}
+
+// PECE members first, then the cheaper PEC ones
+void abm_solver(u32 index, solver_t *solver)
+{
+    const u32 per_mode = ABM_MAX_ORDER - ABM_MIN_ORDER + 1;
+    const u32 order = ABM_MIN_ORDER + index % per_mode;
+    const int pec = index >= per_mode;
+
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), pec ? "ABM%uPEC" : "ABM%u", order);
+    solver->order    = order;
+    solver->adaptive = 1;
+    solver->run      = abm__solve;
+    solver->variant  = order | (pec ? 0x100 : 0);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.h"
+#include "ode.h"
+#include "solve.h"
+
+#define ABM_MIN_ORDER 2
+#define ABM_MAX_ORDER 5
+
+// adams-bashforth predictor with an adams-moulton corrector of the same
+// order, past f values live in a ring buffer so a step costs one (PEC) or
+// two (PECE) evaluations once the history has been bootstrapped with rk4
+typedef struct abm_t
+{
+    u32 order;
+    int pece;
+    u32 count; // f values in the history, below order while bootstrapping
+    u32 head;  // slot of f at x
+    double x, h;
+    double y[ODE_MAX_DIM];
+    double f[ABM_MAX_ORDER][ODE_MAX_DIM];
+} abm_t;
+
+void init_abm(abm_t *abm, u32 order, int pece);
+
+// drops the history and starts over at (x, y) with step h, costs one evaluation
+void abm_restart(abm_t *abm, ode_t *ode, double x, const double *y, double h);
+
+// advances x and y by h, err gets milne's estimate of the local error, or
+// for the rk4 bootstrap steps a step doubling one, which costs them seven
+// more evaluations. it may be NULL
+void abm_step(abm_t *abm, ode_t *ode, double *err);
+
+u32  abm_solver_count(void);
+void abm_solver(u32 index, solver_t *solver);
@@ -0,0 +1,1619 @@
+#include "common.h"
+#include "platform.h"
+#include "pool.h"
+#include "mexp.h"
+#include "rk.h"
+#include "solve.h"
+#include "traj.h"
+#include "bench.h"
+#include "parareal.h"
+#include "event.h"
+#include "system.h"
+#include "pack.h"
+#include "sde.h"
+#include "bvp.h"
+#include "sens.h"
+#include "symp.h"
+#include "ckpt.h"
+#include "sweep.h"
+#include "diverge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// headless front end: integrates one expression from the command line or a
+// whole job file across all cores, without touching SDL
+
+#define MAX_LENGTH 256
+// |y| past which a sweep run counts as blown up without -limit
+#define SWEEP_LIMIT 1e8
+
+enum
+{
+    FORMAT_CSV = 0,
+    FORMAT_BIN = 1,
+    FORMAT_TRAJ = 2,
+};
+
+typedef struct job_t
+{
+    char expr[MAX_LENGTH + 1];
+    char method[RK_NAME_LENGTH];
+    char out[MAX_LENGTH + 1];
+    int format;
+    solve_params_t params;
+    char events[EVENT_MAX][MAX_LENGTH + 1];
+    int event_terminal[EVENT_MAX];
+    u32 event_count;
+    double param_values[128]; // indexed by parameter letter
+    diverge_t diverge;
+
+    // filled in by the worker
+    int ok;
+    char error[MAX_LENGTH + 1];
+    solve_stats_t stats;
+} job_t;
+
+typedef struct batch_t
+{
+    job_t *jobs;
+    u32 job_count;
+    u32 job_cap;
+    int quiet;
+    pf_mutex_t stdout_lock;
+} batch_t;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] [-e expr | -j jobfile]\n"
+            "  -e expr     right hand side of dy/dx = f(x, y), or a system such as\n"
+            "              \"y' = z; z' = -y\" or \"y'' = -y\" (higher orders add y' to the state)\n"
+            "  -j file     job file, one job per line as key=value pairs using the\n"
+            "              option names below (expr, method, h, x0, y0, x1, rtol, atol,\n"
+            "              p, event, stop, out, format), unset keys default to the command line\n"
+            "  -m method   integrator (default rk4), -m list prints them\n"
+            "  -h step     step size, initial step for adaptive runs (default 0.01)\n"
+            "  -x0 -y0 -x1 initial condition and end of the range (default 0 1 10),\n"
+            "              -y0 takes a comma separated list for systems\n"
+            "  -rtol -atol tolerances, rtol > 0 makes adaptive methods adapt the step\n"
+            "  -p a=v,...  parameter values, any other lone letter in expr (default 1)\n"
+            "  -event g    record where g(x, y) changes sign, may be repeated\n"
+            "  -stop g     end the run where g(x, y) changes sign\n"
+            "  -o file     output file (default stdout)\n"
+            "  -f format   csv, bin (raw native doubles x, y per point) or traj\n"
+            "              (indexed trajectory file for the viewer, needs -o)\n"
+            "  -t threads  worker threads (default one per core)\n"
+            "  -b methods  work-precision benchmark of a comma separated method list or\n"
+            "              'all', halving the step from -h (default (x1 - x0) / 8),\n"
+            "              writes csv to -o or stdout and empirical orders to stderr,\n"
+            "              with -rtol adaptive methods sweep rtol, rtol/10, ... instead\n"
+            "  -exact expr exact solution y(x) for -b, otherwise a tight gbs run\n"
+            "  -levels n   number of step sizes in the benchmark (default 10)\n"
+            "  -parareal n parallel-in-time run over n slices with -m as the fine\n"
+            "              method at -h, compared against a serial fine run, without\n"
+            "              -t it repeats for 1, 2, 4, ... threads up to one per core\n"
+            "  -coarse m   coarse parareal method (default euler)\n"
+            "  -ch step    coarse step (default one step per slice)\n"
+            "  -pack tol   keeps the run compressed in memory, lossless with tol 0,\n"
+            "              otherwise with y off by at most tol, and reports the\n"
+            "              compression ratio and decode throughput, -o writes the\n"
+            "              decoded points as csv\n"
+            "  -bvp n      boundary value problem by multiple shooting over n segments\n"
+            "              with -m at -h, writes the solution as csv to -o or stdout\n"
+            "              and the newton residuals to stderr, without -t it repeats\n"
+            "              for 1, 2, 4, ... threads up to one per core\n"
+            "  -ya -yb     comma separated values the first components take at x0\n"
+            "              and x1, together as many as the system has components\n"
+            "  -noise g    stochastic run of dy = f dx + g dW for a scalar expr,\n"
+            "              writes x, the 5/25/50/75/95%% quantiles and the mean\n"
+            "              over the paths as csv to -o or stdout\n"
+            "  -paths n    number of paths (default 10000)\n"
+            "  -scheme s   em (euler-maruyama, default) or milstein\n"
+            "  -seed n     noise seed, each path is reproducible on any thread count\n"
+            "  -sens list  forward sensitivities with -m (an explicit runge-kutta\n"
+            "              method) at -h, by every initial value and the comma\n"
+            "              separated parameters in list ('y0' for none, 'all' for\n"
+            "              every one), writes x, y and dy/dp columns as csv to -o\n"
+            "              or stdout\n"
+            "  -energy ms  energy drift of a comma separated method list or 'all' on\n"
+            "              a second order system y'' = f(x, y) at -h, writes method,\n"
+            "              x, energy rows as csv to -o or stdout and the largest and\n"
+            "              final drift relative to the initial energy to stderr\n"
+            "  -ckpt file  checkpoints a single fixed step run with -o to file, atomically\n"
+            "              and off the integration thread, at the intervals below\n"
+            "  -ckpt-steps n, -ckpt-seconds s\n"
+            "              checkpoint interval in steps or wall clock seconds\n"
+            "  -resume file  goes on from a checkpoint to the same output, bit for bit\n"
+            "              as if never stopped, and keeps checkpointing to file or -ckpt\n"
+            "  -sweep axes grid of one or two comma separated axes name=lo:hi:count\n"
+            "              over parameters or initial values (y0 or y for y), e.g.\n"
+            "              \"a=0:2:200,y0=-1:1:100\", run across all cores and kept as\n"
+            "              one record per point (final y, max |y|, end x, event count)\n"
+            "              in the sweep file -o, which the viewer shows as a map\n"
+            "  -limit v    |y| past which a run counts as diverged and stops, the x\n"
+            "              where it did is reported (default off, 1e8 for -sweep)\n"
+            "  -growth r   the same once |y| > 1 grows faster than exp(r dx), runs\n"
+            "              always stop where y stops being finite\n"
+            "  -q          only print the summary\n", name);
+}
+
+static int parse_format(const char *s, int *format)
+{
+    if (!strcmp(s, "csv")) { *format = FORMAT_CSV; return 1; }
+    if (!strcmp(s, "bin")) { *format = FORMAT_BIN; return 1; }
+    if (!strcmp(s, "traj")) { *format = FORMAT_TRAJ; return 1; }
+    return 0;
+}
+
+static int parse_double(const char *s, double *v)
+{
+    char *end;
+    *v = strtod(s, &end);
+    return end != s && *end == 0;
+}
+
+// comma separated initial state, components left out keep their value,
+// count gets the number given when it is set
+static int parse_state(const char *s, double *y, u32 *count)
+{
+    for (u32 i = 0; i < ODE_MAX_DIM; i ++)
+    {
+        char *end;
+        y[i] = strtod(s, &end);
+        if (end == s)
+            return 0;
+        if (count)
+            *count = i + 1;
+        if (*end == 0)
+            return 1;
+        if (*end != ',')
+            return 0;
+        s = end + 1;
+    }
+    return 0;
+}
+
+// "a=0.5,b=2", names left out keep their value
+static int parse_params(const char *s, double *values)
+{
+    while (*s)
+    {
+        char *end;
+        char name = *s;
+        if (!((name >= 'a' && name <= 'z') || (name >= 'A' && name <= 'Z')) || s[1] != '=')
+            return 0;
+        values[(u8)name] = strtod(s + 2, &end);
+        if (end == s + 2 || (*end && *end != ','))
+            return 0;
+        s = *end ? end + 1 : end;
+    }
+    return 1;
+}
+
+// shared between argv and job files, returns 0 on an unknown key or bad value
+static int set_job_key(job_t *job, const char *key, const char *value)
+{
+    if (!strcmp(key, "expr") || !strcmp(key, "e"))
+        snprintf(job->expr, sizeof(job->expr), "%s", value);
+    else if (!strcmp(key, "method") || !strcmp(key, "m"))
+        snprintf(job->method, sizeof(job->method), "%s", value);
+    else if (!strcmp(key, "out") || !strcmp(key, "o"))
+        snprintf(job->out, sizeof(job->out), "%s", value);
+    else if (!strcmp(key, "event") || !strcmp(key, "stop"))
+    {
+        if (job->event_count >= EVENT_MAX)
+            return 0;
+        snprintf(job->events[job->event_count], MAX_LENGTH + 1, "%s", value);
+        job->event_terminal[job->event_count ++] = !strcmp(key, "stop");
+    }
+    else if (!strcmp(key, "p"))
+        return parse_params(value, job->param_values);
+    else if (!strcmp(key, "format") || !strcmp(key, "f"))
+        return parse_format(value, &job->format);
+    else if (!strcmp(key, "h"))    return parse_double(value, &job->params.h);
+    else if (!strcmp(key, "x0"))   return parse_double(value, &job->params.x0);
+    else if (!strcmp(key, "y0"))   return parse_state(value, job->params.y0, NULL);
+    else if (!strcmp(key, "x1"))   return parse_double(value, &job->params.x1);
+    else if (!strcmp(key, "limit"))  return parse_double(value, &job->diverge.limit);
+    else if (!strcmp(key, "growth")) return parse_double(value, &job->diverge.growth);
+    else if (!strcmp(key, "rtol")) return parse_double(value, &job->params.rtol);
+    else if (!strcmp(key, "atol")) return parse_double(value, &job->params.atol);
+    else return 0;
+    return 1;
+}
+
+static job_t *push_job(batch_t *batch, const job_t *job)
+{
+    if (batch->job_count >= batch->job_cap)
+    {
+        u32 cap = batch->job_cap ? batch->job_cap * 2 : 64;
+        job_t *jobs = (job_t *)realloc(batch->jobs, cap * sizeof(*jobs));
+        if (!jobs) return NULL;
+        batch->jobs = jobs;
+        batch->job_cap = cap;
+    }
+    batch->jobs[batch->job_count] = *job;
+    return &batch->jobs[batch->job_count ++];
+}
+
+static int read_job_file(batch_t *batch, const char *file_name, const job_t *defaults)
+{
+    size_t size;
+    char *text = (char *)read_entire_file(file_name, &size);
+    if (!text)
+    {
+        fprintf(stderr, "could not read '%s'\n", file_name);
+        return 0;
+    }
+
+    u32 line = 0;
+    char *at = text, *last = text + size;
+    while (at < last)
+    {
+        char *eol = at;
+        while (eol < last && *eol != '\n') eol ++;
+        *eol = 0;
+        line ++;
+
+        job_t job = *defaults;
+        int empty = 1;
+        while (at < eol)
+        {
+            char key[32], value[MAX_LENGTH + 1];
+            int klen = 0, vlen = 0;
+            while (at < eol && (*at == ' ' || *at == '\t' || *at == '\r')) at ++;
+            if (at >= eol || *at == '#') break;
+            while (at < eol && *at != '=' && *at != ' ' && klen < (int)sizeof(key) - 1)
+                key[klen ++] = *at ++;
+            key[klen] = 0;
+            if (*at != '=')
+            {
+                fprintf(stderr, "%s:%u: expected key=value\n", file_name, line);
+                free(text);
+                return 0;
+            }
+            at ++;
+            char quote = (*at == '"' || *at == '\'') ? *at++ : 0;
+            while (at < eol && vlen < MAX_LENGTH && (quote ? *at != quote : (*at != ' ' && *at != '\t' && *at != '\r')))
+                value[vlen ++] = *at ++;
+            if (quote && at < eol) at ++;
+            value[vlen] = 0;
+            if (!set_job_key(&job, key, value))
+            {
+                fprintf(stderr, "%s:%u: bad key or value '%s=%s'\n", file_name, line, key, value);
+                free(text);
+                return 0;
+            }
+            empty = 0;
+        }
+        if (!empty && !push_job(batch, &job))
+        {
+            free(text);
+            return 0;
+        }
+        at = eol + 1;
+    }
+    free(text);
+    return 1;
+}
+
+typedef struct
+{
+    FILE *fp;
+    traj_writer_t traj;
+    int format;
+    diverge_guard_t *guard; // stops the run at the first diverged point, may be NULL
+} sink_t;
+
+static int emit_point(void *user, double x, const double *y, u32 dim)
+{
+    sink_t *sink = (sink_t *)user;
+    if (sink->guard && !diverge_point(sink->guard, x, y, dim))
+        return 0;
+    if (sink->format == FORMAT_TRAJ)
+        return traj_write(&sink->traj, x, y);
+    if (sink->format == FORMAT_BIN)
+    {
+        fwrite(&x, sizeof(x), 1, sink->fp);
+        fwrite(y, sizeof(*y), dim, sink->fp);
+        return 1;
+    }
+    fprintf(sink->fp, "%.17g", x);
+    for (u32 i = 0; i < dim; i ++)
+        fprintf(sink->fp, ",%.17g", y[i]);
+    fputc('\n', sink->fp);
+    return 1;
+}
+
+static int emit_last(void *user, double x, const double *y, u32 dim)
+{
+    (void)x;
+    memcpy(user, y, dim * sizeof(*y));
+    return 1;
+}
+
+// why a run that did not reach x1 stopped
+static void describe_stop(job_t *job, const diverge_guard_t *guard)
+{
+    if (guard->reason)
+        snprintf(job->error, sizeof(job->error), "diverged at x = %.17g, %s", guard->at, diverge_reason(guard->reason));
+    else
+        snprintf(job->error, sizeof(job->error), "integration stopped early");
+}
+
+static void run_job(batch_t *batch, job_t *job)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    sink_t sink;
+    solver_t solver;
+    event_monitor_t monitor;
+    diverge_guard_t guard;
+
+    job->ok = 0;
+    sink.fp = NULL;
+    sink.format = job->format;
+    sink.guard = &guard;
+    reset_diverge_guard(&guard, &job->diverge);
+    if (!find_solver(&solver, job->method))
+    {
+        snprintf(job->error, sizeof(job->error), "unknown method '%s'", job->method);
+        return;
+    }
+    if (job->format == FORMAT_TRAJ && !job->out[0])
+    {
+        snprintf(job->error, sizeof(job->error), "traj output needs a file");
+        return;
+    }
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+    {
+        snprintf(job->error, sizeof(job->error), "out of memory");
+        return;
+    }
+    init_event_monitor(&monitor);
+
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        snprintf(job->error, sizeof(job->error), "%s", sys.error);
+        goto done;
+    }
+    for (u32 e = 0; e < job->event_count; e ++)
+    {
+        if (!add_event(&monitor, &parser, job->events[e], strlen(job->events[e]), job->event_terminal[e], EVENT_ANY))
+        {
+            snprintf(job->error, sizeof(job->error), "event '%.100s': %.100s", job->events[e], mexp_get_error(&parser));
+            goto done;
+        }
+    }
+
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+    reset_event_monitor(&monitor, &ode, emit_point, &sink);
+    // the monitor only sits in between when there are events to look for
+    solve_emit_fn emit = monitor.count ? event_emit : emit_point;
+    void *emit_user = monitor.count ? (void *)&monitor : (void *)&sink;
+    if (job->format == FORMAT_TRAJ)
+    {
+        if (!traj_open_writer(&sink.traj, job->out, job->expr, solver.name, job->params.h, ode.dim))
+        {
+            snprintf(job->error, sizeof(job->error), "could not open '%.200s'", job->out);
+            goto done;
+        }
+        job->ok = solve(&solver, &ode, &job->params, emit, emit_user, &job->stats) || monitor.terminated;
+        if (!traj_close_writer(&sink.traj) && job->ok)
+        {
+            job->ok = 0;
+            snprintf(job->error, sizeof(job->error), "could not write '%.200s'", job->out);
+        }
+        else if (!job->ok)
+            describe_stop(job, &guard);
+        goto done;
+    }
+
+    // stdout is shared, so its points are staged in a temporary file
+    sink.fp = job->out[0] ? fopen(job->out, job->format == FORMAT_BIN ? "wb" : "w") : tmpfile();
+    if (!sink.fp)
+    {
+        snprintf(job->error, sizeof(job->error), "could not open '%.200s'", job->out[0] ? job->out : "temporary file");
+        goto done;
+    }
+
+    job->ok = solve(&solver, &ode, &job->params, emit, emit_user, &job->stats) || monitor.terminated;
+    if (!job->ok)
+        describe_stop(job, &guard);
+
+    if (!job->out[0])
+    {
+        char buf[1 << 14];
+        size_t n;
+        rewind(sink.fp);
+        pf_lock(&batch->stdout_lock);
+        while ((n = fread(buf, 1, sizeof(buf), sink.fp)) > 0)
+            fwrite(buf, 1, n, stdout);
+        fflush(stdout);
+        pf_unlock(&batch->stdout_lock);
+    }
+    fclose(sink.fp);
+
+done:
+    if (monitor.hit_count && !batch->quiet)
+    {
+        pf_lock(&batch->stdout_lock);
+        for (u32 i = 0; i < monitor.hit_count; i ++)
+        {
+            const event_hit_t *hit = &monitor.hits[i];
+            fprintf(stderr, "%s '%s' at x = %.17g, %s = %.17g\n", monitor.events[hit->event].terminal ? "stop" : "event",
+                    job->events[hit->event], hit->x, sys.labels[0], hit->y[0]);
+        }
+        pf_unlock(&batch->stdout_lock);
+    }
+    destroy_event_monitor(&monitor);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+}
+
+static void run_jobs(void *user, u32 begin, u32 end, u32 worker)
+{
+    batch_t *batch = (batch_t *)user;
+    (void)worker;
+    for (u32 i = begin; i < end; i ++)
+    {
+        job_t *job = &batch->jobs[i];
+        run_job(batch, job);
+        if (!batch->quiet || !job->ok)
+        {
+            pf_lock(&batch->stdout_lock);
+            if (job->ok)
+                fprintf(stderr, "job %u: %s, %llu steps, %llu evals, %.6fs\n", i, job->method,
+                        (unsigned long long)job->stats.steps, (unsigned long long)job->stats.evals, job->stats.seconds);
+            else
+                fprintf(stderr, "job %u: error: %s\n", i, job->error);
+            pf_unlock(&batch->stdout_lock);
+        }
+    }
+}
+
+// times the serial fine run once, then parareal on growing thread counts
+static int run_parareal_mode(const job_t *job, const parareal_params_t *pp, u32 threads)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    solve_stats_t stats;
+    double serial_y[ODE_MAX_DIM];
+    int ok = 0;
+
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+    serial_y[0] = NAN;
+    if (!solve(&pp->fine, &ode, &job->params, emit_last, serial_y, &stats))
+    {
+        fprintf(stderr, "serial %s run failed\n", pp->fine.name);
+        goto done;
+    }
+    fprintf(stderr, "serial %s: %llu steps in %.6fs, y(%g) = %.17g\n", pp->fine.name,
+            (unsigned long long)stats.steps, stats.seconds, job->params.x1, serial_y[0]);
+
+    u32 first = threads ? threads : 1, last = threads ? threads : pf_cpu_count();
+    for (u32 t = first; t <= last; t = t * 2 <= last || t == last ? t * 2 : last)
+    {
+        pool_t pool;
+        parareal_t pr;
+        sink_t sink = {NULL};
+        // only the widest run writes the trajectory
+        int write = job->out[0] && t == last;
+        if (!init_pool(&pool, t))
+            goto done;
+        if (write && !(sink.fp = fopen(job->out, "w")))
+        {
+            fprintf(stderr, "could not open '%.200s'\n", job->out);
+            destroy_pool(&pool);
+            goto done;
+        }
+        ok = run_parareal(&pr, &pool, &ode, &job->params, pp, write ? emit_point : NULL, &sink);
+        destroy_pool(&pool);
+        if (sink.fp) fclose(sink.fp);
+        if (!ok)
+        {
+            fprintf(stderr, "parareal failed on %u threads\n", t);
+            goto done;
+        }
+        double diff = 0;
+        for (u32 i = 0; i < pr.dim; i ++)
+            diff = fmax(diff, fabs(pr.u[pr.slices * pr.dim + i] - serial_y[i]));
+        fprintf(stderr, "%3u threads: %u iterations%s, %.6fs, speedup %.2f, |y - serial| = %.3g\n", t, pr.iterations,
+                pr.converged ? "" : " (not converged)", pr.seconds, stats.seconds / pr.seconds, diff);
+        if (!pr.converged) ok = 0;
+        destroy_parareal(&pr);
+    }
+
+done:
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+static int emit_pack(void *user, double x, const double *y, u32 dim)
+{
+    (void)dim;
+    return pack_push((pack_t *)user, x, y);
+}
+
+// decodes the whole pack for at least a tenth of a second, then looks up
+// random points by x the way a viewer scrolling through the run would
+static int run_pack_mode(const job_t *job, double tolerance)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    solver_t solver;
+    solve_stats_t stats;
+    pack_t pack = {0};
+    double *block = NULL;
+    int ok = 0;
+
+    if (!find_solver(&solver, job->method))
+    {
+        fprintf(stderr, "unknown method '%s'\n", job->method);
+        return 0;
+    }
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+    block = (double *)malloc((size_t)PACK_BLOCK_SIZE * (ode.dim + 1) * sizeof(double));
+    if (!block || !init_pack(&pack, ode.dim, tolerance))
+        goto done;
+    if (!solve(&solver, &ode, &job->params, emit_pack, &pack, &stats) || !pack_flush(&pack))
+    {
+        fprintf(stderr, "integration stopped early\n");
+        goto done;
+    }
+    fprintf(stderr, "%llu points, %u components in %.6fs: %zu bytes raw, %zu packed, ratio %.2f, %.2f bits per value, max error %.3g\n",
+            (unsigned long long)pack.count, pack.dim, stats.seconds, pack_raw_bytes(&pack), pack.bytes,
+            pack.bytes ? (double)pack_raw_bytes(&pack) / pack.bytes : 0,
+            pack.count ? pack.bytes * 8.0 / (pack.count * (pack.dim + 1)) : 0, pack.max_error);
+
+    u64 decoded = 0, passes = 0;
+    double begin = pf_time(), seconds;
+    do
+    {
+        for (u64 b = 0; b < pack.block_count; b ++)
+            decoded += pack_decode_block(&pack, b, block);
+        passes ++;
+    }
+    while ((seconds = pf_time() - begin) < 0.1);
+    fprintf(stderr, "decode: %.3g points/s, %.3g MB/s of raw doubles over %llu passes\n", decoded / seconds,
+            decoded * (pack.dim + 1) * sizeof(double) / seconds / 1e6, (unsigned long long)passes);
+
+    u64 lookups = 0, seed = 1;
+    begin = pf_time();
+    do
+    {
+        // xorshift keeps the x values spread without touching the C rng
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        double x = job->params.x0 + (job->params.x1 - job->params.x0) * (seed >> 11) / 9007199254740992.0;
+        u64 b = pack_find_block(&pack, x);
+        if (b < pack.block_count)
+            pack_decode_block(&pack, b, block);
+        lookups ++;
+    }
+    while ((seconds = pf_time() - begin) < 0.1);
+    fprintf(stderr, "random access by x: %.3g lookups/s\n", lookups / seconds);
+
+    ok = 1;
+    if (job->out[0])
+    {
+        FILE *fp = fopen(job->out, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "could not open '%.200s'\n", job->out);
+            ok = 0;
+            goto done;
+        }
+        for (u64 b = 0; b < pack.block_count; b ++)
+        {
+            u32 n = pack_decode_block(&pack, b, block);
+            for (u32 i = 0; i < n; i ++)
+            {
+                fprintf(fp, "%.17g", block[i]);
+                for (u32 c = 0; c < pack.dim; c ++)
+                    fprintf(fp, ",%.17g", block[(size_t)(c + 1) * n + i]);
+                fputc('\n', fp);
+            }
+        }
+        fclose(fp);
+    }
+
+done:
+    destroy_pack(&pack);
+    free(block);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+// newton on growing thread counts, the widest run writes the solution
+static int run_bvp_mode(const job_t *job, const bvp_params_t *bp, u32 threads)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    double serial_seconds = 0;
+    int ok = 0;
+
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    if (bp->left + bp->right != sys.dim)
+    {
+        fprintf(stderr, "%u boundary values for %u components\n", bp->left + bp->right, sys.dim);
+        goto done;
+    }
+    if (sys.dim * bp->segments > BVP_MAX_UNKNOWNS)
+    {
+        fprintf(stderr, "at most %u segments for %u components\n", BVP_MAX_UNKNOWNS / sys.dim, sys.dim);
+        goto done;
+    }
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+
+    u32 first = threads ? threads : 1, last = threads ? threads : pf_cpu_count();
+    for (u32 t = first; t <= last; t = t * 2 <= last || t == last ? t * 2 : last)
+    {
+        pool_t pool;
+        bvp_t bvp;
+        sink_t sink = {NULL};
+        int write = t == last;
+        if (!init_pool(&pool, t))
+            goto done;
+        sink.fp = write && job->out[0] ? fopen(job->out, "w") : write ? stdout : NULL;
+        if (write && !sink.fp)
+        {
+            fprintf(stderr, "could not open '%.200s'\n", job->out);
+            destroy_pool(&pool);
+            goto done;
+        }
+        ok = run_bvp(&bvp, &pool, &ode, &job->params, bp, write ? emit_point : NULL, &sink);
+        destroy_pool(&pool);
+        if (sink.fp && sink.fp != stdout) fclose(sink.fp);
+        if (!ok)
+        {
+            fprintf(stderr, "multiple shooting failed on %u threads\n", t);
+            goto done;
+        }
+        if (t == first)
+        {
+            serial_seconds = bvp.seconds;
+            for (u32 i = 0; i <= bvp.iterations; i ++)
+                fprintf(stderr, "newton %2u: residual %.3g\n", i, bvp.residual[i]);
+        }
+        fprintf(stderr, "%3u threads: %u iterations%s, %.6fs (%.6fs shooting), speedup %.2f, %llu evals\n", t, bvp.iterations,
+                bvp.converged ? "" : " (not converged)", bvp.seconds, bvp.shoot_seconds, serial_seconds / bvp.seconds,
+                (unsigned long long)bvp.evals);
+        ok = bvp.converged;
+        destroy_bvp(&bvp);
+        if (!ok)
+            goto done;
+    }
+
+done:
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+// paths integrated on the pool, then reduced to quantile bands per step
+static int run_sde_mode(pool_t *pool, const job_t *job, const char *noise, u32 paths, u32 scheme, u64 seed)
+{
+    static const double quantiles[] = {0.05, 0.25, 0.5, 0.75, 0.95};
+    const u32 q_count = sizeof(quantiles) / sizeof(quantiles[0]);
+    const solve_params_t *p = &job->params;
+    mexp_parser_t parser;
+    system_t sys;
+    mexp_tree_t diffusion;
+    sde_t sde = {0};
+    double *bands = NULL;
+    int ok = 0;
+
+    if (!mexp_init_parser(&parser) || !init_system(&sys) || !mexp_init_tree(&diffusion))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    if (sys.dim != 1 || sys.param_count)
+    {
+        fprintf(stderr, "noise needs a scalar expression of x and y\n");
+        goto done;
+    }
+    if (!mexp_generate_tree(&diffusion, &parser, noise, strlen(noise)))
+    {
+        fprintf(stderr, "noise: %s\n", mexp_get_error(&parser));
+        goto done;
+    }
+
+    u32 steps = (u32)floor((p->x1 - p->x0) / p->h + 0.5) + 1;
+    if (steps < 2 || !init_sde(&sde, paths, steps) || !(bands = (double *)malloc((size_t)steps * q_count * sizeof(double))))
+    {
+        fprintf(stderr, "could not hold %u paths of %u steps\n", paths, steps);
+        goto done;
+    }
+    if (!run_sde(&sde, pool, &sys.trees[0], &diffusion, scheme, p->x0, p->h, p->y0[0], seed))
+    {
+        fprintf(stderr, "sde run failed\n");
+        goto done;
+    }
+    double begin = pf_time();
+    if (!sde_quantiles(&sde, pool, quantiles, q_count, bands))
+        goto done;
+    double quantile_seconds = pf_time() - begin;
+
+    FILE *fp = job->out[0] ? fopen(job->out, "w") : stdout;
+    if (!fp)
+    {
+        fprintf(stderr, "could not open '%s'\n", job->out);
+        goto done;
+    }
+    fprintf(fp, "x,q05,q25,q50,q75,q95,mean\n");
+    for (u32 s = 0; s < steps; s ++)
+    {
+        const double *row = sde_row(&sde, s);
+        double mean = 0;
+        for (u32 i = 0; i < paths; i ++)
+            mean += row[i];
+        fprintf(fp, "%.17g", p->x0 + s * p->h);
+        for (u32 k = 0; k < q_count; k ++)
+            fprintf(fp, ",%.17g", bands[(size_t)s * q_count + k]);
+        fprintf(fp, ",%.17g\n", mean / paths);
+    }
+    if (fp != stdout) fclose(fp);
+    fprintf(stderr, "%s: %u paths x %u steps on %u threads in %.6fs, %.3g path-steps/s, quantiles in %.6fs\n",
+            sde_scheme_name(scheme), paths, steps - 1, pool_worker_count(pool), sde.seconds, sde.rate, quantile_seconds);
+    ok = 1;
+
+done:
+    free(bands);
+    destroy_sde(&sde);
+    mexp_free_tree(&diffusion);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+static int emit_sens(void *user, double x, const double *y, const double *s, u32 dim, u32 count)
+{
+    FILE *fp = (FILE *)user;
+    fprintf(fp, "%.17g", x);
+    for (u32 i = 0; i < dim; i ++)
+        fprintf(fp, ",%.17g", y[i]);
+    for (u32 i = 0; i < dim * count; i ++)
+        fprintf(fp, ",%.17g", s[i]);
+    fputc('\n', fp);
+    return 1;
+}
+
+// the variational equations ride along the chosen runge-kutta method, the
+// directions are every initial value and then the listed parameters
+static int run_sens_mode(const job_t *job, const char *list)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    solver_t solver;
+    sens_t sens = {0};
+    solve_stats_t stats;
+    u32 slots[SENS_MAX_DIRECTIONS], count = 0;
+    char names[SENS_MAX_DIRECTIONS][SYSTEM_LABEL_LENGTH + 1];
+    int ok = 0;
+
+    if (!find_solver(&solver, job->method) || !solver.rk)
+    {
+        fprintf(stderr, "sensitivities need an explicit runge-kutta method, not '%s'\n", job->method);
+        return 0;
+    }
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+
+    for (u32 i = 0; i < sys.dim; i ++)
+    {
+        snprintf(names[count], sizeof(names[count]), "%s0", sys.labels[i]);
+        slots[count ++] = 1 + i;
+    }
+    if (!strcmp(list, "all"))
+    {
+        for (u32 p = 0; p < sys.param_count; p ++)
+        {
+            snprintf(names[count], sizeof(names[count]), "%c", sys.params[p]);
+            slots[count ++] = system_param_slot(&sys, p);
+        }
+    }
+    else if (strcmp(list, "y0"))
+    {
+        for (const char *at = list; *at; at += at[1] == ',' ? 2 : 1)
+        {
+            u32 p = 0;
+            while (p < sys.param_count && sys.params[p] != *at) p ++;
+            if (p == sys.param_count || (at[1] && at[1] != ','))
+            {
+                fprintf(stderr, "'%s' is not a list of parameters of the expression\n", list);
+                goto done;
+            }
+            const u32 slot = system_param_slot(&sys, p);
+            for (u32 d = 0; d < count; d ++)
+            {
+                if (slots[d] == slot)
+                {
+                    fprintf(stderr, "parameter '%c' is in '%s' twice\n", *at, list);
+                    goto done;
+                }
+            }
+            // distinct parameters always fit, this only guards slots and names
+            if (count >= SENS_MAX_DIRECTIONS)
+            {
+                fprintf(stderr, "more than %u sensitivity directions\n", SENS_MAX_DIRECTIONS);
+                goto done;
+            }
+            snprintf(names[count], sizeof(names[count]), "%c", sys.params[p]);
+            slots[count ++] = slot;
+        }
+    }
+
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+    if (!init_sens(&sens, &ode, slots, count))
+    {
+        fprintf(stderr, "could not differentiate the expression\n");
+        goto done;
+    }
+
+    FILE *fp = job->out[0] ? fopen(job->out, "w") : stdout;
+    if (!fp)
+    {
+        fprintf(stderr, "could not open '%.200s'\n", job->out);
+        goto done;
+    }
+    fprintf(fp, "x");
+    for (u32 i = 0; i < sys.dim; i ++)
+        fprintf(fp, ",%s", sys.labels[i]);
+    for (u32 i = 0; i < sys.dim; i ++)
+        for (u32 d = 0; d < count; d ++)
+            fprintf(fp, ",d%s/d%s", sys.labels[i], names[d]);
+    fputc('\n', fp);
+    ok = run_sens(&sens, solver.rk->tableau, &ode, &job->params, emit_sens, fp, &stats);
+    if (fp != stdout) fclose(fp);
+    if (!ok)
+    {
+        fprintf(stderr, "integration stopped early\n");
+        goto done;
+    }
+    fprintf(stderr, "%s: %llu steps with %u directions in %.6fs, %llu evals\n", solver.name,
+            (unsigned long long)stats.steps, count, stats.seconds, (unsigned long long)stats.evals);
+
+done:
+    destroy_sens(&sens);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+// a comma separated list of method names or 'all' for every built-in one
+static int parse_methods(const char *list, solver_t *methods, u32 cap, u32 *method_count)
+{
+    *method_count = 0;
+    if (!strcmp(list, "all"))
+    {
+        for (u32 m = 0; m < solver_builtin_count() && m < cap; m ++)
+            solver_builtin(m, &methods[(*method_count) ++]);
+        return 1;
+    }
+    const char *at = list;
+    while (*at && *method_count < cap)
+    {
+        char name[RK_NAME_LENGTH];
+        u32 len = 0;
+        while (*at && *at != ',')
+        {
+            if (len < RK_NAME_LENGTH - 1) name[len ++] = *at;
+            at ++;
+        }
+        name[len] = 0;
+        if (*at == ',') at ++;
+        if (!find_solver(&methods[(*method_count) ++], name))
+        {
+            fprintf(stderr, "unknown method '%s'\n", name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef struct
+{
+    symp_energy_t energy;
+    double last;
+    const char *name;
+    FILE *fp;
+} energy_sink_t;
+
+static int emit_energy(void *user, double x, const double *y, u32 dim)
+{
+    energy_sink_t *sink = (energy_sink_t *)user;
+    (void)dim;
+    sink->last = symp_energy_point(&sink->energy, x, y);
+    fprintf(sink->fp, "%s,%.17g,%.17g\n", sink->name, x, sink->last);
+    return 1;
+}
+
+// every listed method over the same run of a separable second order
+// system, tracking how far the energy wanders from its initial value
+static int run_energy_mode(const job_t *job, const char *list)
+{
+    solver_t methods[64];
+    u32 method_count;
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    int ok = 0;
+
+    if (!parse_methods(list, methods, 64, &method_count))
+        return 0;
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+
+    energy_sink_t sink;
+    if (!init_symp_energy(&sink.energy, &ode))
+    {
+        fprintf(stderr, "the energy needs a second order system y'' = f(x, y) without y' on the right\n");
+        goto done;
+    }
+    sink.fp = job->out[0] ? fopen(job->out, "w") : stdout;
+    if (!sink.fp)
+    {
+        fprintf(stderr, "could not open '%.200s'\n", job->out);
+        goto done;
+    }
+    fprintf(sink.fp, "method,x,energy\n");
+    ok = 1;
+    for (u32 m = 0; m < method_count; m ++)
+    {
+        solve_stats_t stats;
+        init_symp_energy(&sink.energy, &ode);
+        sink.name = methods[m].name;
+        if (!solve(&methods[m], &ode, &job->params, emit_energy, &sink, &stats))
+        {
+            fprintf(stderr, "%-10s failed\n", methods[m].name);
+            ok = 0;
+            continue;
+        }
+        // relative to the initial energy unless that is 0
+        const double scale = fabs(sink.energy.e0) > 0 ? fabs(sink.energy.e0) : 1;
+        fprintf(stderr, "%-10s %llu steps, %llu evals in %.6fs, energy drift max %.3g, final %.3g\n", methods[m].name,
+                (unsigned long long)stats.steps, (unsigned long long)stats.evals, stats.seconds,
+                sink.energy.max_drift / scale, fabs(sink.last - sink.energy.e0) / scale);
+    }
+    if (sink.fp != stdout) fclose(sink.fp);
+
+done:
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+// everything a fixed step run needs to go on from a step: the job it came
+// from, the state after that step and how much of the output holds it
+typedef struct checkpoint_t
+{
+    job_t job;
+    double y[ODE_MAX_DIM];
+    u64 out_bytes;
+    u64 every_steps;
+    double every_seconds;
+} checkpoint_t;
+
+typedef struct
+{
+    sink_t sink;
+    ckpt_writer_t writer;
+    checkpoint_t state;
+    u64 step; // index of the next point
+    int skip; // the resumed point is already in the output
+} ckpt_sink_t;
+
+static int emit_checkpointed(void *user, double x, const double *y, u32 dim)
+{
+    ckpt_sink_t *c = (ckpt_sink_t *)user;
+    const u64 step = c->step ++;
+    if (c->skip)
+        c->skip = 0;
+    else if (!emit_point(&c->sink, x, y, dim))
+        return 0;
+    if (ckpt_due(&c->writer, step))
+    {
+        // the file must hold what the checkpoint counts before it is posted
+        long bytes;
+        if (fflush(c->sink.fp) != 0 || (bytes = ftell(c->sink.fp)) < 0)
+            return 0;
+        c->state.out_bytes = (u64)bytes;
+        memcpy(c->state.y, y, dim * sizeof(*y));
+        ckpt_post(&c->writer, &c->state, step);
+    }
+    return 1;
+}
+
+// a single fixed step run that checkpoints itself to ckpt_path every so
+// many steps or seconds, or that goes on from the checkpoint in resume_path
+// where it left off, with its output bit for bit that of an unbroken run
+static int run_checkpoint_mode(const job_t *job, const char *ckpt_path, u64 every_steps, double every_seconds, const char *resume_path)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    solver_t solver;
+    ckpt_sink_t *c;
+    u64 first_step = 0;
+    int ok = 0;
+
+    c = (ckpt_sink_t *)calloc(1, sizeof(*c));
+    if (!c)
+        return 0;
+    if (resume_path)
+    {
+        if (!ckpt_read(resume_path, &c->state, sizeof(c->state), &first_step))
+        {
+            fprintf(stderr, "'%.200s' is not a checkpoint of this build\n", resume_path);
+            free(c);
+            return 0;
+        }
+        // the run as it was, at the intervals given now if any
+        if (!every_steps && every_seconds <= 0)
+        {
+            every_steps = c->state.every_steps;
+            every_seconds = c->state.every_seconds;
+        }
+        ckpt_path = ckpt_path ? ckpt_path : resume_path;
+    }
+    else
+        c->state.job = *job;
+    c->state.job.params.pool = NULL;
+    c->state.every_steps = every_steps;
+    c->state.every_seconds = every_seconds;
+    job = &c->state.job;
+
+    if (!find_solver(&solver, job->method))
+    {
+        fprintf(stderr, "unknown method '%s'\n", job->method);
+        free(c);
+        return 0;
+    }
+    if (!solver.restartable || (solver.adaptive && job->params.rtol > 0) || job->event_count || job->format == FORMAT_TRAJ || !job->out[0])
+    {
+        fprintf(stderr, "checkpoints need a fixed step one step method without events, writing csv or bin to -o\n");
+        free(c);
+        return 0;
+    }
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+    {
+        free(c);
+        return 0;
+    }
+    // the program is compiled again from the text, which gives the same
+    // instructions and so the same rounding
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+
+    c->sink.format = job->format;
+    c->sink.fp = fopen(job->out, resume_path ? "r+b" : "wb");
+    if (!c->sink.fp)
+    {
+        fprintf(stderr, "could not open '%.200s'\n", job->out);
+        goto done;
+    }
+    if (resume_path)
+    {
+        long size = fseek(c->sink.fp, 0, SEEK_END) == 0 ? ftell(c->sink.fp) : -1;
+        if (size < 0 || (u64)size < c->state.out_bytes || fseek(c->sink.fp, (long)c->state.out_bytes, SEEK_SET) != 0)
+        {
+            fprintf(stderr, "'%.200s' is shorter than its checkpoint\n", job->out);
+            fclose(c->sink.fp);
+            goto done;
+        }
+    }
+    if (!init_ckpt_writer(&c->writer, ckpt_path, sizeof(c->state), every_steps, every_seconds))
+    {
+        fprintf(stderr, "could not start the checkpoint writer\n");
+        fclose(c->sink.fp);
+        goto done;
+    }
+
+    solve_params_t params = job->params;
+    solve_stats_t stats;
+    if (resume_path)
+    {
+        memcpy(params.y0, c->state.y, sizeof(params.y0));
+        params.first_step = first_step;
+        c->writer.last_step = first_step;
+        c->step = first_step;
+        c->skip = 1;
+    }
+    ok = solve(&solver, &ode, &params, emit_checkpointed, c, &stats);
+    destroy_ckpt_writer(&c->writer);
+    ok = fclose(c->sink.fp) == 0 && ok;
+    if (ok)
+        fprintf(stderr, "%s from step %llu: %llu steps, %llu evals, %.6fs, %u checkpoints posted, %u written, %u failed\n", job->method,
+                (unsigned long long)first_step, (unsigned long long)stats.steps, (unsigned long long)stats.evals, stats.seconds,
+                c->writer.posted, c->writer.written, c->writer.failed);
+    else
+        fprintf(stderr, "integration stopped early\n");
+
+done:
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    free(c);
+    return ok;
+}
+
+// "a=0:2:200,y0=-1:1:100", one or two axes of name=lo:hi:count
+static int parse_axes(const char *s, sweep_axis_t *axes, const system_t *sys)
+{
+    u32 count = 0;
+    memset(axes, 0, 2 * sizeof(*axes));
+    axes[1].count = 1;
+    while (*s)
+    {
+        const char *eq = strchr(s, '=');
+        char *end;
+        if (count >= 2 || !eq || eq == s || eq - s >= SWEEP_NAME_LENGTH)
+            return 0;
+        sweep_axis_t *axis = &axes[count ++];
+        memcpy(axis->name, s, eq - s);
+        if (!sweep_find_slot(sys, axis->name, &axis->slot))
+        {
+            fprintf(stderr, "'%s' is neither a parameter nor a component\n", axis->name);
+            return 0;
+        }
+        axis->lo = strtod(eq + 1, &end);
+        if (*end != ':') return 0;
+        axis->hi = strtod(end + 1, &end);
+        if (*end != ':') return 0;
+        axis->count = (u32)strtoul(end + 1, &end, 10);
+        if (axis->count == 0 || (*end != ',' && *end != 0)) return 0;
+        s = *end ? end + 1 : end;
+    }
+    return count > 0 && (count == 1 || axes[0].slot != axes[1].slot);
+}
+
+// one run per grid point on the pool, each reduced to a summary record
+static int run_sweep_mode(pool_t *pool, const job_t *job, const char *spec)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    sweep_t sweep;
+    const char *events[EVENT_MAX];
+    int ok = 0;
+
+    if (!job->out[0])
+    {
+        fprintf(stderr, "a sweep needs an output file\n");
+        return 0;
+    }
+    if (!mexp_init_parser(&parser) || !init_system(&sys))
+        return 0;
+    memset(&sweep, 0, sizeof(sweep));
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    for (u32 e = 0; e < job->event_count; e ++)
+        events[e] = job->events[e];
+    if (!init_sweep(&sweep, pool, &sys, &parser, events, job->event_terminal, job->event_count))
+    {
+        fprintf(stderr, "event: %s\n", mexp_get_error(&parser));
+        goto done;
+    }
+    if (!find_solver(&sweep.solver, job->method))
+    {
+        fprintf(stderr, "unknown method '%s'\n", job->method);
+        goto done;
+    }
+    if (!parse_axes(spec, sweep.axes, &sys))
+    {
+        fprintf(stderr, "bad sweep '%s'\n", spec);
+        goto done;
+    }
+    sweep.params = job->params;
+    sweep.params.pool = NULL; // the grid keeps every worker busy
+    memcpy(sweep.param_values, job->param_values, sizeof(sweep.param_values));
+    sweep.diverge = job->diverge;
+    if (!(sweep.diverge.limit > 0))
+        sweep.diverge.limit = SWEEP_LIMIT;
+
+    FILE *fp = fopen(job->out, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "could not open '%.200s'\n", job->out);
+        goto done;
+    }
+    ok = run_sweep(&sweep, pool, fp, job->expr);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "could not write '%.200s'\n", job->out);
+        goto done;
+    }
+    const u32 runs = sweep.axes[0].count * sweep.axes[1].count;
+    fprintf(stderr, "%u runs of %s on %u threads in %.6fs: %.3g runs/s, %.3g evals/s, %u blew up, %u stopped, %u failed\n",
+            runs, sweep.solver.name, pool_worker_count(pool), sweep.seconds,
+            sweep.seconds > 0 ? runs / sweep.seconds : 0, sweep.seconds > 0 ? sweep.evals / sweep.seconds : 0,
+            sweep.blowups, sweep.stops, sweep.failures);
+
+done:
+    destroy_sweep(&sweep);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+// resolves the method list, runs the sweep on the pool and prints the table
+static int run_benchmark(pool_t *pool, const job_t *job, const char *list, const char *exact_expr, u32 levels, int have_h)
+{
+    solver_t methods[64];
+    u32 method_count;
+    if (!parse_methods(list, methods, 64, &method_count))
+        return 0;
+
+    mexp_parser_t parser;
+    system_t sys;
+    mexp_tree_t exact;
+    bench_t bench;
+    int ok = 0;
+    if (!mexp_init_parser(&parser) || !init_system(&sys) || !mexp_init_tree(&exact))
+        return 0;
+
+    if (!parse_system(&sys, &parser, job->expr, strlen(job->expr)))
+    {
+        fprintf(stderr, "%s\n", sys.error);
+        goto done;
+    }
+    if (exact_expr && !mexp_generate_tree(&exact, &parser, exact_expr, strlen(exact_expr)))
+    {
+        fprintf(stderr, "%s\n", mexp_get_error(&parser));
+        goto done;
+    }
+
+    const solve_params_t *p = &job->params;
+    ode_t ode;
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, job->param_values);
+    double h0 = have_h ? p->h : (p->x1 - p->x0) / 8;
+    double begin = pf_time();
+    if (!run_bench(&bench, pool, &ode, exact_expr ? &exact : NULL, methods, method_count, p->x0, p->y0, p->x1, h0, p->rtol, levels))
+    {
+        fprintf(stderr, "benchmark failed\n");
+        goto done;
+    }
+    double seconds = pf_time() - begin;
+
+    FILE *fp = job->out[0] ? fopen(job->out, "w") : stdout;
+    if (!fp)
+        fprintf(stderr, "could not open '%s'\n", job->out);
+    else
+    {
+        write_bench_csv(&bench, fp);
+        if (fp != stdout) fclose(fp);
+        ok = 1;
+    }
+    fprintf(stderr, "reference %s(%g) = %.17g (%s)\n", sys.labels[0], p->x1, bench.reference[0], exact_expr ? "exact" : "gbs");
+    for (u32 m = 0; m < method_count; m ++)
+        fprintf(stderr, "%-10s order %u, measured %.2f\n", methods[m].name, methods[m].order, bench.eoc[m]);
+    fprintf(stderr, "%u runs on %u threads in %.3fs\n", method_count * levels, pool_worker_count(pool), seconds);
+    destroy_bench(&bench);
+
+done:
+    mexp_free_tree(&exact);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    batch_t batch = {0};
+    job_t defaults;
+    const char *job_file = NULL;
+    const char *bench_methods = NULL, *exact_expr = NULL;
+    u32 bench_levels = 10;
+    u32 parareal_slices = 0;
+    const char *coarse_method = "euler";
+    double coarse_h = 0;
+    double pack_tolerance = -1;
+    const char *noise = NULL;
+    const char *sens_list = NULL;
+    const char *energy_methods = NULL;
+    const char *ckpt_path = NULL, *resume_path = NULL;
+    const char *sweep_spec = NULL;
+    u64 ckpt_steps = 0;
+    double ckpt_seconds = 0;
+    u32 sde_paths = 10000, sde_scheme = SDE_EULER_MARUYAMA;
+    u64 sde_seed = 1;
+    bvp_params_t bp;
+    init_bvp_params(&bp, 0);
+    int have_expr = 0, have_h = 0;
+    u32 threads = 0;
+
+    memset(&defaults, 0, sizeof(defaults));
+    init_solve_params(&defaults.params);
+    init_diverge(&defaults.diverge);
+    snprintf(defaults.method, sizeof(defaults.method), "rk4");
+    defaults.format = FORMAT_CSV;
+    for (u32 i = 0; i < 128; i ++)
+        defaults.param_values[i] = SYSTEM_PARAM_DEFAULT;
+
+    for (int i = 1; i < argc; i ++)
+    {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "-q")) { batch.quiet = 1; continue; }
+        if (!strcmp(arg, "--help")) { usage(argv[0]); return 0; }
+        if (arg[0] != '-' || i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char *value = argv[++i];
+        if (!strcmp(arg, "-j")) job_file = value;
+        else if (!strcmp(arg, "-t")) threads = (u32)atoi(value);
+        else if (!strcmp(arg, "-b")) bench_methods = value;
+        else if (!strcmp(arg, "-exact")) exact_expr = value;
+        else if (!strcmp(arg, "-levels")) bench_levels = (u32)atoi(value);
+        else if (!strcmp(arg, "-parareal")) parareal_slices = (u32)atoi(value);
+        else if (!strcmp(arg, "-coarse")) coarse_method = value;
+        else if (!strcmp(arg, "-ch"))
+        {
+            if (!parse_double(value, &coarse_h)) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(arg, "-pack"))
+        {
+            if (!parse_double(value, &pack_tolerance) || pack_tolerance < 0) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(arg, "-bvp")) bp.segments = (u32)atoi(value);
+        else if (!strcmp(arg, "-ya") || !strcmp(arg, "-yb"))
+        {
+            int left = !strcmp(arg, "-ya");
+            if (!parse_state(value, left ? bp.ya : bp.yb, left ? &bp.left : &bp.right)) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(arg, "-noise")) noise = value;
+        else if (!strcmp(arg, "-sens")) sens_list = value;
+        else if (!strcmp(arg, "-energy")) energy_methods = value;
+        else if (!strcmp(arg, "-sweep")) sweep_spec = value;
+        else if (!strcmp(arg, "-ckpt")) ckpt_path = value;
+        else if (!strcmp(arg, "-resume")) resume_path = value;
+        else if (!strcmp(arg, "-ckpt-steps")) ckpt_steps = strtoull(value, NULL, 10);
+        else if (!strcmp(arg, "-ckpt-seconds"))
+        {
+            if (!parse_double(value, &ckpt_seconds) || ckpt_seconds < 0) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(arg, "-paths")) sde_paths = (u32)atoi(value);
+        else if (!strcmp(arg, "-seed")) sde_seed = strtoull(value, NULL, 10);
+        else if (!strcmp(arg, "-scheme"))
+        {
+            if (!find_sde_scheme(value, &sde_scheme)) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(arg, "-m") && !strcmp(value, "list"))
+        {
+            for (u32 m = 0; m < solver_builtin_count(); m ++)
+            {
+                solver_t solver;
+                solver_builtin(m, &solver);
+                printf("%-10s order %u", solver.name, solver.order);
+                if (solver.rk)
+                    printf(", %u stages", solver.rk->tableau->stages);
+                printf("%s\n", solver.adaptive ? ", adaptive" : "");
+            }
+            return 0;
+        }
+        else if (!set_job_key(&defaults, arg + 1, value))
+        {
+            fprintf(stderr, "bad option '%s %s'\n", arg, value);
+            return 1;
+        }
+        if (!strcmp(arg, "-e")) have_expr = 1;
+        if (!strcmp(arg, "-h")) have_h = 1;
+    }
+
+    if (parareal_slices)
+    {
+        parareal_params_t pp;
+        init_parareal_params(&pp, parareal_slices);
+        pp.coarse_h = coarse_h;
+        if (!have_expr || !find_solver(&pp.fine, defaults.method) || !find_solver(&pp.coarse, coarse_method))
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_parareal_mode(&defaults, &pp, threads) ? 0 : 1;
+    }
+
+    if (pack_tolerance >= 0)
+    {
+        if (!have_expr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_pack_mode(&defaults, pack_tolerance) ? 0 : 1;
+    }
+
+    if (bp.segments)
+    {
+        if (!have_expr || !find_solver(&bp.solver, defaults.method))
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_bvp_mode(&defaults, &bp, threads) ? 0 : 1;
+    }
+
+    if (sens_list)
+    {
+        if (!have_expr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_sens_mode(&defaults, sens_list) ? 0 : 1;
+    }
+
+    if (energy_methods)
+    {
+        if (!have_expr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_energy_mode(&defaults, energy_methods) ? 0 : 1;
+    }
+
+    if (ckpt_path || resume_path)
+    {
+        if (!resume_path && (!have_expr || (!ckpt_steps && ckpt_seconds <= 0)))
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_checkpoint_mode(&defaults, ckpt_path, ckpt_steps, ckpt_seconds, resume_path) ? 0 : 1;
+    }
+
+    if (sweep_spec)
+    {
+        pool_t pool;
+        if (!have_expr)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!init_pool(&pool, threads))
+            return 1;
+        int ok = run_sweep_mode(&pool, &defaults, sweep_spec);
+        destroy_pool(&pool);
+        return ok ? 0 : 1;
+    }
+
+    if (noise)
+    {
+        pool_t pool;
+        if (!have_expr || sde_paths == 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!init_pool(&pool, threads))
+            return 1;
+        int ok = run_sde_mode(&pool, &defaults, noise, sde_paths, sde_scheme, sde_seed);
+        destroy_pool(&pool);
+        return ok ? 0 : 1;
+    }
+
+    if (bench_methods)
+    {
+        pool_t pool;
+        if (!have_expr || bench_levels < 2 || bench_levels > 30)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (!init_pool(&pool, threads))
+            return 1;
+        int ok = run_benchmark(&pool, &defaults, bench_methods, exact_expr, bench_levels, have_h);
+        destroy_pool(&pool);
+        return ok ? 0 : 1;
+    }
+
+    if (job_file)
+    {
+        if (!read_job_file(&batch, job_file, &defaults))
+            return 1;
+    }
+    else if (have_expr)
+    {
+        if (!push_job(&batch, &defaults))
+            return 1;
+    }
+    else
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    pool_t pool;
+    if (!pf_init_mutex(&batch.stdout_lock) || !init_pool(&pool, threads))
+        return 1;
+
+    double begin = pf_time();
+    if (batch.job_count == 1)
+    {
+        // a lone job runs on this thread and may use the pool inside its steps
+        batch.jobs[0].params.pool = &pool;
+        run_jobs(&batch, 0, 1, 0);
+    }
+    else
+        pool_for(&pool, batch.job_count, 1, run_jobs, &batch);
+    double seconds = pf_time() - begin;
+
+    u64 steps = 0, evals = 0;
+    u32 failed = 0;
+    for (u32 i = 0; i < batch.job_count; i ++)
+    {
+        steps += batch.jobs[i].stats.steps;
+        evals += batch.jobs[i].stats.evals;
+        failed += !batch.jobs[i].ok;
+    }
+    fprintf(stderr, "%u jobs (%u failed) on %u threads in %.6fs: %.3g steps/s, %.3g evals/s, %.3g jobs/s\n",
+            batch.job_count, failed, pool_worker_count(&pool), seconds,
+            seconds > 0 ? steps / seconds : 0, seconds > 0 ? evals / seconds : 0,
+            seconds > 0 ? batch.job_count / seconds : 0);
+
+    destroy_pool(&pool);
+    pf_destroy_mutex(&batch.stdout_lock);
+    free(batch.jobs);
+    return failed ? 1 : 0;
+}
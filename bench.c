@@ -0,0 +1,224 @@
+#include "bench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// short runs are repeated until they take at least this long
+#define BENCH_MIN_SECONDS 0.005
+
+typedef struct
+{
+    bench_t *bench;
+    const ode_t *source;
+    mexp_program_t *progs;
+} bench_job_t;
+
+static int bench__keep_last(void *user, double x, const double *y, u32 dim)
+{
+    (void)x;
+    memcpy(user, y, dim * sizeof(*y));
+    return 1;
+}
+
+static void bench__worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    bench_job_t *job = (bench_job_t *)user;
+    bench_t *b = job->bench;
+    for (u32 i = begin; i < end; i ++)
+    {
+        const u32 m = i / b->levels, l = i % b->levels;
+        bench_point_t *pt = bench_point(b, m, l);
+        solve_params_t params;
+        solve_stats_t stats;
+        double y[ODE_MAX_DIM];
+        ode_t ode;
+        u32 reps = 0;
+        int ok;
+        double begin_time = pf_time(), elapsed;
+
+        init_ode(&ode, &job->progs[worker]);
+        memcpy(ode.vars, job->source->vars, sizeof(ode.vars));
+        init_solve_params(&params);
+        params.x0 = b->x0;
+        params.x1 = b->x1;
+        memcpy(params.y0, b->y0, sizeof(params.y0));
+        params.h = pt->h;
+        params.rtol = pt->tol;
+        params.atol = pt->tol;
+        do
+        {
+            ok = solve(&b->methods[m], &ode, &params, bench__keep_last, y, &stats);
+            reps ++;
+            elapsed = pf_time() - begin_time;
+        }
+        while (ok && elapsed < BENCH_MIN_SECONDS);
+
+        pt->seconds = elapsed / reps;
+        if (!ok)
+        {
+            // y is stale or never written, the point stays out of the fit and the plot
+            pt->steps = 0;
+            pt->evals = 0;
+            pt->error = INFINITY;
+            continue;
+        }
+        pt->steps   = stats.steps;
+        pt->evals   = stats.evals;
+        pt->error   = 0;
+        for (u32 c = 0; c < b->checked; c ++)
+        {
+            double d = fabs(y[c] - b->reference[c]);
+            // a blown up run must not hide behind fmax dropping nan
+            pt->error = isfinite(d) ? fmax(pt->error, d) : INFINITY;
+            if (!isfinite(d)) break;
+        }
+    }
+}
+
+// tolerance runs have no single step size, their mean step goes as 1 / evals
+static inline double bench__step(const bench_point_t *pt)
+{
+    return pt->tol > 0 ? 1.0 / pt->evals : pt->h;
+}
+
+// least squares slope of log(error) over log(h) on the finest half of the
+// sweep, coarse steps are rarely asymptotic and roundoff floors the fine end
+static double bench__fit_order(const bench_t *b, u32 m)
+{
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    u32 n = 0, want = b->levels / 2 > 3 ? b->levels / 2 : 3;
+    double scale = 1;
+    for (u32 c = 0; c < b->checked; c ++)
+        scale = fmax(scale, fabs(b->reference[c]));
+    double floor = 1e-13 * scale;
+    for (u32 l = b->levels; l-- > 0 && n < want;)
+    {
+        const bench_point_t *pt = bench_point(b, m, l);
+        if (!isfinite(pt->error) || pt->error <= floor)
+            continue;
+        double lx = log(bench__step(pt)), ly = log(pt->error);
+        sx += lx; sy += ly; sxx += lx * lx; sxy += lx * ly;
+        n ++;
+    }
+    if (n < 2)
+        return NAN;
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+int run_bench(bench_t *b, pool_t *pool, const ode_t *source, const mexp_tree_t *exact,
+              const solver_t *methods, u32 method_count, double x0, const double *y0, double x1, double h0, double tol0, u32 levels)
+{
+    memset(b, 0, sizeof(*b));
+    // h0 divides the range, so every halving does and no run ends on a cut step
+    h0 = (x1 - x0) / fmax(1, ceil(fabs((x1 - x0) / h0) - 1e-9));
+    b->method_count = method_count;
+    b->levels = levels;
+    b->x0 = x0;
+    b->x1 = x1;
+    b->dim = source->dim;
+    b->checked = exact ? 1 : b->dim;
+    memcpy(b->y0, y0, b->dim * sizeof(*y0));
+    b->methods = (solver_t *)malloc(method_count * sizeof(*b->methods));
+    b->points  = (bench_point_t *)calloc((size_t)method_count * levels, sizeof(*b->points));
+    b->eoc     = (double *)calloc(method_count, sizeof(*b->eoc));
+    if (!b->methods || !b->points || !b->eoc)
+    {
+        destroy_bench(b);
+        return 0;
+    }
+    memcpy(b->methods, methods, method_count * sizeof(*methods));
+
+    u32 workers = pool_worker_count(pool);
+    bench_job_t job = {b, source, (mexp_program_t *)calloc(workers, sizeof(mexp_program_t))};
+    int ok = job.progs != NULL;
+    for (u32 i = 0; ok && i < workers; i ++)
+        ok = mexp_init_program(&job.progs[i]) && mexp_copy_program(&job.progs[i], source->prog);
+
+    if (ok && exact)
+    {
+        mexp_tree_t copy;
+        double v[ODE_MAX_VARS];
+        // the exact solution reads the parameters from the slots the ode does
+        memcpy(v, source->vars, sizeof(v));
+        v[0] = x1;
+        ok = mexp_init_tree(&copy) && mexp_copy_tree(&copy, exact);
+        if (ok) b->reference[0] = mexp_eval_tree(&copy, v);
+        mexp_free_tree(&copy);
+    }
+    else if (ok)
+    {
+        solve_params_t params;
+        double y[ODE_MAX_DIM];
+        ode_t ode;
+        init_ode(&ode, &job.progs[0]);
+        memcpy(ode.vars, source->vars, sizeof(ode.vars));
+        init_solve_params(&params);
+        params.x0 = x0;
+        params.x1 = x1;
+        memcpy(params.y0, b->y0, sizeof(params.y0));
+        solver_t reference;
+        params.h = h0 / (1 << levels);
+        params.rtol = 1e-14;
+        params.atol = 1e-14;
+        params.pool = pool;
+        ok = find_solver(&reference, "gbs") && solve(&reference, &ode, &params, bench__keep_last, y, NULL);
+        memcpy(b->reference, y, b->dim * sizeof(*y));
+    }
+
+    if (ok)
+    {
+        for (u32 m = 0; m < method_count; m ++)
+        {
+            for (u32 l = 0; l < levels; l ++)
+            {
+                bench_point_t *pt = bench_point(b, m, l);
+                int sweep_tol = tol0 > 0 && b->methods[m].adaptive;
+                pt->h   = sweep_tol ? h0 : h0 / (double)(1 << l);
+                pt->tol = sweep_tol ? tol0 * pow(10, -(double)l) : 0;
+            }
+        }
+        pool_for(pool, method_count * levels, 1, bench__worker, &job);
+        for (u32 m = 0; m < method_count; m ++)
+            b->eoc[m] = bench__fit_order(b, m);
+    }
+
+    for (u32 i = 0; job.progs && i < workers; i ++)
+        mexp_free_program(&job.progs[i]);
+    free(job.progs);
+    if (!ok)
+        destroy_bench(b);
+    return ok;
+}
+
+void destroy_bench(bench_t *b)
+{
+    free(b->methods);
+    free(b->points);
+    free(b->eoc);
+    b->methods = NULL;
+    b->points = NULL;
+    b->eoc = NULL;
+    b->method_count = 0;
+    b->levels = 0;
+}
+
+void write_bench_csv(const bench_t *b, FILE *fp)
+{
+    fprintf(fp, "method,h,tol,steps,evals,seconds,error,eoc\n");
+    for (u32 m = 0; m < b->method_count; m ++)
+    {
+        for (u32 l = 0; l < b->levels; l ++)
+        {
+            const bench_point_t *pt = bench_point(b, m, l);
+            // local order between neighbouring runs
+            double eoc = NAN;
+            if (l > 0 && isfinite(pt->error) && isfinite(bench_point(b, m, l - 1)->error))
+            {
+                const bench_point_t *prev = bench_point(b, m, l - 1);
+                eoc = log(prev->error / pt->error) / log(bench__step(prev) / bench__step(pt));
+            }
+            fprintf(fp, "%s,%.17g,%g,%llu,%llu,%.9g,%.17g,%.4f\n", b->methods[m].name, pt->h, pt->tol,
+                    (unsigned long long)pt->steps, (unsigned long long)pt->evals, pt->seconds, pt->error, eoc);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "mexp.h"
+#include "solve.h"
+#include <stdio.h>
+
+// work-precision sweep: every method runs at h0, h0/2, ... and its error at
+// x1 is measured against the exact solution or a tight gbs reference
+// (max norm over the components of a system). h0 is rounded down to divide
+// [x0, x1], so every run takes whole steps.
+// with tol0 > 0 adaptive methods sweep tol0, tol0/10, ... instead
+// a run the solver fails has error INFINITY and no steps or evals
+typedef struct bench_point_t
+{
+    double h;
+    double tol; // 0 for fixed step runs
+    u64 steps;
+    u64 evals;
+    double seconds;
+    double error;
+} bench_point_t;
+
+typedef struct bench_t
+{
+    solver_t *methods;
+    u32 method_count;
+    u32 levels;
+    bench_point_t *points; // method-major, levels per method
+    double *eoc;           // fitted empirical order per method
+    double reference[ODE_MAX_DIM];
+    u32 dim;
+    u32 checked; // components compared, an exact solution only gives y[0]
+    double x0, x1;
+    double y0[ODE_MAX_DIM];
+} bench_t;
+
+int  run_bench(bench_t *bench, pool_t *pool, const ode_t *ode, const mexp_tree_t *exact,
+               const solver_t *methods, u32 method_count, double x0, const double *y0, double x1, double h0, double tol0, u32 levels);
+void destroy_bench(bench_t *bench);
+void write_bench_csv(const bench_t *bench, FILE *fp);
+
+static inline bench_point_t *bench_point(const bench_t *bench, u32 method, u32 level)
+{ return &bench->points[method * bench->levels + level]; }
@@ -0,0 +1,314 @@
+#include "bvp.h"
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    const bvp_params_t *bp;
+    const solve_params_t *params;
+    ode_t *odes;
+    u32 dim, segments;
+    const double *s; // start states of the sweep
+    double *end;     // phi_j(s_j)
+    double *jac;     // dim x dim per segment, row-major, NULL for the residual alone
+} bvp_job_t;
+
+typedef struct
+{
+    solve_emit_fn emit;
+    void *user;
+    int skip; // the first point of a later segment repeats the last one
+} bvp_out_t;
+
+static int bvp__keep_last(void *user, double x, const double *y, u32 dim)
+{
+    (void)x;
+    memcpy(user, y, dim * sizeof(*y));
+    return 1;
+}
+
+static int bvp__forward(void *user, double x, const double *y, u32 dim)
+{
+    bvp_out_t *out = (bvp_out_t *)user;
+    if (out->skip)
+    {
+        out->skip = 0;
+        return 1;
+    }
+    return out->emit(out->user, x, y, dim);
+}
+
+static inline double bvp__x(const solve_params_t *p, u32 segments, u32 j)
+{
+    return j == segments ? p->x1 : p->x0 + (p->x1 - p->x0) * j / segments;
+}
+
+// the step is rounded so that a whole number of them covers the segment,
+// and never adapted, the finite differences need the same steps every time
+static int bvp__propagate(const solver_t *solver, ode_t *ode, const solve_params_t *p, double xa, double xb,
+                          const double *y, double *out, solve_emit_fn emit, void *user)
+{
+    solve_params_t sp = *p;
+    double steps = fmax(1, floor(fabs(xb - xa) / fabs(p->h) + 0.5));
+    sp.x0 = xa;
+    sp.x1 = xb;
+    sp.h = (xb - xa) / steps;
+    sp.rtol = 0;
+    sp.pool = NULL;
+    memcpy(sp.y0, y, ode->dim * sizeof(*y));
+    if (emit)
+        return solve(solver, ode, &sp, emit, user, NULL);
+    return solve(solver, ode, &sp, bvp__keep_last, out, NULL);
+}
+
+static void bvp__sweep(void *user, u32 begin, u32 end, u32 worker)
+{
+    bvp_job_t *job = (bvp_job_t *)user;
+    const u32 dim = job->dim;
+    ode_t *ode = &job->odes[worker];
+    for (u32 j = begin; j < end; j ++)
+    {
+        const double xa = bvp__x(job->params, job->segments, j), xb = bvp__x(job->params, job->segments, j + 1);
+        const double *s = job->s + j * dim;
+        double *e = job->end + j * dim;
+        // a segment that blows up poisons the residual, newton backs off
+        if (!bvp__propagate(&job->bp->solver, ode, job->params, xa, xb, s, e, NULL, NULL))
+            e[0] = NAN;
+        if (!job->jac)
+            continue;
+
+        double y[ODE_MAX_DIM], out[ODE_MAX_DIM];
+        double *jac = job->jac + (size_t)j * dim * dim;
+        for (u32 c = 0; c < dim; c ++)
+        {
+            memcpy(y, s, dim * sizeof(*y));
+            y[c] += 1.5e-8 * fmax(1, fabs(s[c]));
+            double d = y[c] - s[c];
+            if (!bvp__propagate(&job->bp->solver, ode, job->params, xa, xb, y, out, NULL, NULL))
+                out[0] = NAN;
+            for (u32 r = 0; r < dim; r ++)
+                jac[r * dim + c] = (out[r] - e[r]) / d;
+        }
+    }
+}
+
+// largest residual of the matching conditions, infinite when one is not finite
+static double bvp__residual(const bvp_params_t *bp, u32 dim, u32 m, const double *s, const double *end, double *f)
+{
+    u32 r = 0;
+    double norm = 0;
+    for (u32 c = 0; c < bp->left; c ++)
+        f[r ++] = s[c] - bp->ya[c];
+    for (u32 j = 0; j + 1 < m; j ++)
+        for (u32 c = 0; c < dim; c ++)
+            f[r ++] = end[j * dim + c] - s[(j + 1) * dim + c];
+    for (u32 c = 0; c < bp->right; c ++)
+        f[r ++] = end[(m - 1) * dim + c] - bp->yb[c];
+    for (u32 i = 0; i < r; i ++)
+    {
+        if (!isfinite(f[i]))
+            return INFINITY;
+        norm = fmax(norm, fabs(f[i]));
+    }
+    return norm;
+}
+
+// rows in the order of bvp__residual, columns by segment then component
+static void bvp__assemble(const bvp_params_t *bp, u32 dim, u32 m, const double *jac, double *a)
+{
+    const u32 n = dim * m;
+    u32 r = 0;
+    memset(a, 0, (size_t)n * n * sizeof(*a));
+    for (u32 c = 0; c < bp->left; c ++, r ++)
+        a[(size_t)r * n + c] = 1;
+    for (u32 j = 0; j < m; j ++)
+    {
+        u32 rows = j + 1 < m ? dim : bp->right;
+        for (u32 c = 0; c < rows; c ++, r ++)
+        {
+            memcpy(a + (size_t)r * n + j * dim, jac + ((size_t)j * dim + c) * dim, dim * sizeof(*a));
+            if (j + 1 < m)
+                a[(size_t)r * n + (j + 1) * dim + c] = -1;
+        }
+    }
+}
+
+// gaussian elimination with partial pivoting, b is overwritten by the solution
+static int bvp__solve(double *a, double *b, u32 n)
+{
+    for (u32 k = 0; k < n; k ++)
+    {
+        u32 p = k;
+        for (u32 i = k + 1; i < n; i ++)
+            if (fabs(a[(size_t)i * n + k]) > fabs(a[(size_t)p * n + k])) p = i;
+        if (a[(size_t)p * n + k] == 0)
+            return 0;
+        if (p != k)
+        {
+            for (u32 j = k; j < n; j ++)
+            {
+                double t = a[(size_t)k * n + j];
+                a[(size_t)k * n + j] = a[(size_t)p * n + j];
+                a[(size_t)p * n + j] = t;
+            }
+            double t = b[k]; b[k] = b[p]; b[p] = t;
+        }
+        for (u32 i = k + 1; i < n; i ++)
+        {
+            double l = a[(size_t)i * n + k] / a[(size_t)k * n + k];
+            if (l == 0) continue;
+            for (u32 j = k + 1; j < n; j ++)
+                a[(size_t)i * n + j] -= l * a[(size_t)k * n + j];
+            b[i] -= l * b[k];
+        }
+    }
+    for (u32 k = n; k -- > 0;)
+    {
+        double v = b[k];
+        for (u32 j = k + 1; j < n; j ++)
+            v -= a[(size_t)k * n + j] * b[j];
+        b[k] = v / a[(size_t)k * n + k];
+    }
+    return 1;
+}
+
+// the boundary values are interpolated where both ends give one, other
+// components start from the end that does, or from 0
+static void bvp__guess(const bvp_params_t *bp, const solve_params_t *p, u32 dim, u32 m, double *s)
+{
+    for (u32 j = 0; j < m; j ++)
+    {
+        double t = (bvp__x(p, m, j) - p->x0) / (p->x1 - p->x0);
+        for (u32 c = 0; c < dim; c ++)
+        {
+            double v = 0;
+            if (c < bp->left && c < bp->right) v = bp->ya[c] + t * (bp->yb[c] - bp->ya[c]);
+            else if (c < bp->left)             v = bp->ya[c];
+            else if (c < bp->right)            v = bp->yb[c];
+            s[j * dim + c] = v;
+        }
+    }
+}
+
+static void bvp__shoot(bvp_t *bvp, pool_t *pool, bvp_job_t *job, const double *s, double *end, double *jac)
+{
+    double begin = pf_time();
+    job->s = s;
+    job->end = end;
+    job->jac = jac;
+    pool_for(pool, job->segments, 1, bvp__sweep, job);
+    bvp->shoot_seconds += pf_time() - begin;
+}
+
+void init_bvp_params(bvp_params_t *bp, u32 segments)
+{
+    memset(bp, 0, sizeof(*bp));
+    find_solver(&bp->solver, "rk4");
+    bp->segments = segments;
+    bp->tol = 1e-10;
+    bp->max_iterations = 20;
+}
+
+int run_bvp(bvp_t *bvp, pool_t *pool, const ode_t *ode, const solve_params_t *p,
+            const bvp_params_t *bp, solve_emit_fn emit, void *user)
+{
+    const u32 m = bp->segments, dim = ode->dim, n = m * dim, workers = pool_worker_count(pool);
+    const u32 max_iterations = bp->max_iterations < BVP_MAX_ITERATIONS ? bp->max_iterations : BVP_MAX_ITERATIONS;
+    double begin = pf_time();
+
+    memset(bvp, 0, sizeof(*bvp));
+    if (!m || p->h == 0 || p->x1 == p->x0 || bp->left + bp->right != dim || n > BVP_MAX_UNKNOWNS)
+        return 0;
+    bvp->segments = m;
+    bvp->dim = dim;
+
+    bvp->s = (double *)calloc(n, sizeof(double));
+    double *trial = (double *)calloc(n, sizeof(double));
+    double *end   = (double *)calloc(n, sizeof(double));
+    double *f     = (double *)calloc(n, sizeof(double));
+    double *delta = (double *)calloc(n, sizeof(double));
+    double *jac   = (double *)calloc((size_t)n * dim, sizeof(double));
+    double *a     = (double *)calloc((size_t)n * n, sizeof(double));
+    mexp_program_t *progs = (mexp_program_t *)calloc(workers, sizeof(*progs));
+    ode_t *odes = (ode_t *)calloc(workers, sizeof(*odes));
+
+    int ok = bvp->s && trial && end && f && delta && jac && a && progs && odes;
+    for (u32 w = 0; ok && w < workers; w ++)
+    {
+        ok = mexp_init_program(&progs[w]) && mexp_copy_program(&progs[w], ode->prog);
+        if (!ok) break;
+        init_ode(&odes[w], &progs[w]);
+        memcpy(odes[w].vars, ode->vars, sizeof(ode->vars));
+    }
+
+    bvp_job_t job = {bp, p, odes, dim, m, NULL, NULL, NULL};
+    if (ok)
+        bvp__guess(bp, p, dim, m, bvp->s);
+    while (ok)
+    {
+        bvp__shoot(bvp, pool, &job, bvp->s, end, jac);
+        double norm = bvp__residual(bp, dim, m, bvp->s, end, f);
+        bvp->residual[bvp->iterations] = norm;
+        bvp->converged = norm <= bp->tol;
+        if (bvp->converged || bvp->iterations >= max_iterations || !isfinite(norm))
+            break;
+
+        bvp__assemble(bp, dim, m, jac, a);
+        for (u32 i = 0; i < n; i ++)
+            delta[i] = -f[i];
+        if (!bvp__solve(a, delta, n))
+            break;
+
+        // halve the step until the largest residual goes down, when it never
+        // does newton has stalled and s stays the best iterate found
+        double lambda = 1;
+        int descended = 0;
+        for (u32 tries = 0; !descended && tries < 12; tries ++, lambda /= 2)
+        {
+            for (u32 i = 0; i < n; i ++)
+                trial[i] = bvp->s[i] + lambda * delta[i];
+            bvp__shoot(bvp, pool, &job, trial, end, NULL);
+            descended = bvp__residual(bp, dim, m, trial, end, f) < norm;
+        }
+        if (!descended)
+            break;
+        memcpy(bvp->s, trial, n * sizeof(double));
+        bvp->iterations ++;
+    }
+
+    // one more pass from the converged states produces the solution
+    if (ok && emit && bvp->converged)
+    {
+        bvp_out_t out = {emit, user, 0};
+        for (u32 j = 0; ok && j < m; j ++)
+        {
+            out.skip = j > 0;
+            ok = bvp__propagate(&bp->solver, &odes[0], p, bvp__x(p, m, j), bvp__x(p, m, j + 1),
+                                bvp->s + j * dim, NULL, bvp__forward, &out);
+        }
+    }
+
+    for (u32 w = 0; progs && w < workers; w ++)
+    {
+        bvp->evals += odes ? odes[w].evals : 0;
+        mexp_free_program(&progs[w]);
+    }
+    free(progs);
+    free(odes);
+    free(trial);
+    free(end);
+    free(f);
+    free(delta);
+    free(jac);
+    free(a);
+    bvp->seconds = pf_time() - begin;
+    if (!ok)
+        destroy_bvp(bvp);
+    return ok;
+}
+
+void destroy_bvp(bvp_t *bvp)
+{
+    free(bvp->s);
+    bvp->s = NULL;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "solve.h"
+
+#define BVP_MAX_ITERATIONS 32
+// the newton matrix is dense, segments * dim unknowns
+#define BVP_MAX_UNKNOWNS 1024
+
+// two-point boundary value problem by multiple shooting: [x0, x1] is cut
+// into segments whose start states s_j are the unknowns, every sweep
+// integrates all segments at once, and newton closes
+//   s_0[c] = ya[c]                  for c < left
+//   phi_j(s_j) = s_{j+1}            between segments
+//   phi_last(s_last)[c] = yb[c]     for c < right
+// with left + right = dim. the jacobian of phi_j is taken by finite
+// differences, so each segment runs dim + 1 times per newton step
+typedef struct bvp_params_t
+{
+    solver_t solver;
+    u32 segments;
+    u32 left, right;
+    double ya[ODE_MAX_DIM], yb[ODE_MAX_DIM];
+    double tol; // on the largest residual
+    u32 max_iterations;
+} bvp_params_t;
+
+typedef struct bvp_t
+{
+    u32 segments, dim;
+    double *s;        // segment start states, segments * dim
+    u32 iterations;
+    int converged;
+    double residual[BVP_MAX_ITERATIONS + 1]; // largest residual before every newton step and after the last
+    double seconds;
+    double shoot_seconds; // spent in the parallel sweeps
+    u64 evals;
+} bvp_t;
+
+void init_bvp_params(bvp_params_t *bp, u32 segments);
+
+// params gives the interval and the step, the steps are rounded so that a
+// whole number of them covers every segment. returns 0 on bad input or
+// when out of memory, whether newton got there is in bvp->converged. when
+// no damped step lowers the residual newton stops with s at the best
+// iterate. the converged solution is emitted in order when emit is set
+int  run_bvp(bvp_t *bvp, pool_t *pool, const ode_t *ode, const solve_params_t *params,
+             const bvp_params_t *bp, solve_emit_fn emit, void *user);
+void destroy_bvp(bvp_t *bvp);
@@ -0,0 +1,117 @@
+#include "ckpt.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static u64 ckpt__hash(const void *data, u64 size, u64 hash)
+{
+    const u8 *p = (const u8 *)data;
+    for (u64 i = 0; i < size; i ++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void ckpt__write(void *user, const void *job, u32 generation)
+{
+    ckpt_writer_t *writer = (ckpt_writer_t *)user;
+    const u64 size = sizeof(ckpt_header_t) + writer->size;
+    const u64 hash = ckpt__hash(job, size, 0xcbf29ce484222325ull);
+    char tmp[CKPT_PATH_LENGTH + 8];
+    (void)generation;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", writer->path);
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp != NULL;
+    if (fp)
+    {
+        ok = fwrite(job, 1, size, fp) == size && fwrite(&hash, sizeof(hash), 1, fp) == 1;
+        ok = fclose(fp) == 0 && ok;
+    }
+    if (ok && pf_replace_file(tmp, writer->path))
+        pf_atomic_add(&writer->written, 1);
+    else
+        pf_atomic_add(&writer->failed, 1);
+}
+
+int init_ckpt_writer(ckpt_writer_t *writer, const char *path, u32 size, u64 every_steps, double every_seconds)
+{
+    memset(writer, 0, sizeof(*writer));
+    if (strlen(path) >= sizeof(writer->path))
+        return 0;
+    snprintf(writer->path, sizeof(writer->path), "%s", path);
+    writer->size = size;
+    writer->every_steps = every_steps;
+    writer->every_seconds = every_seconds;
+    writer->last_time = pf_time();
+    writer->staging = malloc(sizeof(ckpt_header_t) + size);
+    if (!writer->staging)
+        return 0;
+    if (!init_task(&writer->task, ckpt__write, writer, sizeof(ckpt_header_t) + size))
+    {
+        free(writer->staging);
+        return 0;
+    }
+    return 1;
+}
+
+void destroy_ckpt_writer(ckpt_writer_t *writer)
+{
+    // the last post is the newest checkpoint, it must reach the disk
+    finish_task(&writer->task);
+    destroy_task(&writer->task);
+    free(writer->staging);
+}
+
+int ckpt_due(ckpt_writer_t *writer, u64 step)
+{
+    if (writer->every_steps && step - writer->last_step >= writer->every_steps)
+        return 1;
+    if (writer->every_seconds > 0 && step % CKPT_CLOCK_EVERY == 0)
+        return pf_time() - writer->last_time >= writer->every_seconds;
+    return 0;
+}
+
+void ckpt_post(ckpt_writer_t *writer, const void *payload, u64 step)
+{
+    ckpt_header_t *hd = (ckpt_header_t *)writer->staging;
+    memset(hd, 0, sizeof(*hd));
+    memcpy(hd->magic, CKPT_MAGIC, sizeof(CKPT_MAGIC));
+    hd->version    = CKPT_VERSION;
+    hd->byte_order = CKPT_BYTE_ORDER;
+    hd->size       = writer->size;
+    hd->step       = step;
+    memcpy(hd + 1, payload, writer->size);
+    post_task(&writer->task, writer->staging);
+    writer->posted ++;
+
+    writer->last_step = step;
+    if (writer->every_seconds > 0)
+        writer->last_time = pf_time();
+}
+
+int ckpt_read(const char *path, void *payload, u32 size, u64 *step)
+{
+    pf_mapping_t map;
+    if (!pf_map_file(&map, path))
+        return 0;
+    const ckpt_header_t *hd = (const ckpt_header_t *)map.data;
+    const u64 body = sizeof(*hd) + size;
+    u64 hash;
+    int ok = map.size == body + sizeof(hash)
+          && memcmp(hd->magic, CKPT_MAGIC, sizeof(CKPT_MAGIC)) == 0
+          && hd->version == CKPT_VERSION && hd->byte_order == CKPT_BYTE_ORDER && hd->size == size;
+    if (ok)
+    {
+        memcpy(&hash, (const u8 *)map.data + body, sizeof(hash));
+        ok = hash == ckpt__hash(map.data, body, 0xcbf29ce484222325ull);
+    }
+    if (ok)
+    {
+        memcpy(payload, hd + 1, size);
+        *step = hd->step;
+    }
+    pf_unmap_file(&map);
+    return ok;
+}
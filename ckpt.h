@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+#include "task.h"
+
+// checkpoint file, native byte order: ckpt_header_t, the caller's payload,
+// then the fnv-1a hash of header and payload. a checkpoint is written to
+// path.tmp and replaces path only once complete, so a run killed at any
+// point leaves the previous one readable
+#define CKPT_MAGIC "ERKCKPT"
+#define CKPT_VERSION 1
+#define CKPT_BYTE_ORDER 0x01020304
+#define CKPT_PATH_LENGTH 256
+// steps between clock reads when the interval is in seconds
+#define CKPT_CLOCK_EVERY 64
+
+typedef struct ckpt_header_t
+{
+    char magic[8];
+    u32 version;
+    u32 byte_order;
+    u32 size;
+    u32 reserved;
+    u64 step;
+} ckpt_header_t;
+
+// the integration thread only copies the payload into the writer's task,
+// the file is written on its thread. checkpoints posted while one is being
+// written replace each other, only the newest of them is written next.
+// destroy_ckpt_writer returns once the last post is on disk
+typedef struct ckpt_writer_t
+{
+    task_t task;
+    char path[CKPT_PATH_LENGTH];
+    u32 size;
+    u64 every_steps;      // 0 for no step interval
+    double every_seconds; // 0 for no time interval
+    u64 last_step;
+    double last_time;
+    void *staging; // header and payload as posted
+    u32 posted;
+    volatile u32 written;
+    volatile u32 failed;
+} ckpt_writer_t;
+
+int  init_ckpt_writer(ckpt_writer_t *writer, const char *path, u32 size, u64 every_steps, double every_seconds);
+void destroy_ckpt_writer(ckpt_writer_t *writer);
+// whether step is past either interval since the last post
+int  ckpt_due(ckpt_writer_t *writer, u64 step);
+void ckpt_post(ckpt_writer_t *writer, const void *payload, u64 step);
+// 0 unless path holds an intact checkpoint of exactly size payload bytes
+int  ckpt_read(const char *path, void *payload, u32 size, u64 *step);
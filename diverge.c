@@ -0,0 +1,57 @@
+#include "diverge.h"
+#include <math.h>
+
+void init_diverge(diverge_t *diverge)
+{
+    diverge->limit  = 0;
+    diverge->growth = 0;
+}
+
+const char *diverge_reason(u32 reason)
+{
+    switch (reason)
+    {
+        case DIVERGE_NONFINITE: return "y not finite";
+        case DIVERGE_LIMIT:     return "|y| past the limit";
+        case DIVERGE_GROWTH:    return "|y| growing past the rate";
+        default:                return "fine";
+    }
+}
+
+u32 diverge_test(const diverge_t *diverge, double norm, double last_norm, double dx)
+{
+    if (!isfinite(norm))
+        return DIVERGE_NONFINITE;
+    if (diverge->limit > 0 && norm > diverge->limit)
+        return DIVERGE_LIMIT;
+    // log(norm / last) > growth dx, with both held at 1 from below
+    if (diverge->growth > 0 && norm > 1 && norm > last_norm &&
+        log(norm / fmax(last_norm, 1)) > diverge->growth * fabs(dx))
+        return DIVERGE_GROWTH;
+    return DIVERGE_NONE;
+}
+
+void reset_diverge_guard(diverge_guard_t *guard, const diverge_t *diverge)
+{
+    guard->params = *diverge;
+    guard->have_last = 0;
+    guard->reason = DIVERGE_NONE;
+    guard->at = 0;
+}
+
+int diverge_point(diverge_guard_t *guard, double x, const double *y, u32 dim)
+{
+    if (guard->reason)
+        return 0;
+    const double norm = diverge_norm(y, dim);
+    guard->reason = diverge_test(&guard->params, norm, guard->have_last ? guard->norm : norm, x - guard->x);
+    if (guard->reason)
+    {
+        guard->at = x;
+        return 0;
+    }
+    guard->have_last = 1;
+    guard->x = x;
+    guard->norm = norm;
+    return 1;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+
+enum
+{
+    DIVERGE_NONE = 0,
+    DIVERGE_NONFINITE,
+    DIVERGE_LIMIT,
+    DIVERGE_GROWTH,
+};
+
+// a run has diverged once y stops being finite, once some |y_i| passes
+// limit, or once |y| = max |y_i| grows faster than exp(growth dx) between
+// two points. growth only counts above |y| = 1 so that small values
+// crossing 0 do not look like an explosion. limit and growth 0 are off,
+// the finite test is always on
+typedef struct diverge_t
+{
+    double limit;
+    double growth;
+} diverge_t;
+
+// follows one run point by point and keeps where it diverged
+typedef struct diverge_guard_t
+{
+    diverge_t params;
+    int have_last;
+    double x, norm; // last point
+    u32 reason;
+    double at;      // x of the first diverged point
+} diverge_guard_t;
+
+void init_diverge(diverge_t *diverge);
+const char *diverge_reason(u32 reason);
+
+// max |y_i|, NaN if any component is
+static inline double diverge_norm(const double *y, u32 dim)
+{
+    double norm = 0;
+    for (u32 i = 0; i < dim; i ++)
+    {
+        const double a = y[i] < 0 ? -y[i] : y[i];
+        if (!(a <= norm))
+            norm = a;
+    }
+    return norm;
+}
+
+// the test between two norms dx apart, DIVERGE_NONE while the run is fine
+u32  diverge_test(const diverge_t *diverge, double norm, double last_norm, double dx);
+
+void reset_diverge_guard(diverge_guard_t *guard, const diverge_t *diverge);
+// returns 0 from the first diverged point on
+int  diverge_point(diverge_guard_t *guard, double x, const double *y, u32 dim);
@@ -0,0 +1,176 @@
+#include "ensemble.h"
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    ensemble_t *ensemble;
+    mexp_tree_t *trees;
+    const diverge_t *diverge;
+    volatile u32 failed;
+    volatile u32 diverged;
+} ensemble_job_t;
+
+typedef struct
+{
+    double x[MEXP_BATCH_SIZE];
+    double y[MEXP_BATCH_SIZE];
+    double k1[MEXP_BATCH_SIZE];
+    double k2[MEXP_BATCH_SIZE];
+    double k3[MEXP_BATCH_SIZE];
+    double k4[MEXP_BATCH_SIZE];
+    double p0[MEXP_BATCH_SIZE], p1[MEXP_BATCH_SIZE]; // live lanes packed once some have died
+} ensemble_lanes_t;
+
+static void ensemble__fill(double *dst, double v, u32 n)
+{
+    for (u32 i = 0; i < n; i ++)
+        dst[i] = v;
+}
+
+// one rk4 step for n lanes at the same x
+static int ensemble__rk4(mexp_tree_t *tree, ensemble_lanes_t *l, double x, double h, const double *y0, double *y1, u32 n)
+{
+    const double *v0[2] = {l->x, y0};
+    const double *v[2] = {l->x, l->y};
+    int ok = 1;
+
+    ensemble__fill(l->x, x, n);
+    ok &= mexp_eval_tree_batch(tree, v0, l->k1, n);
+
+    ensemble__fill(l->x, x + h / 2, n);
+    for (u32 i = 0; i < n; i ++) l->y[i] = y0[i] + h / 2 * l->k1[i];
+    ok &= mexp_eval_tree_batch(tree, v, l->k2, n);
+
+    for (u32 i = 0; i < n; i ++) l->y[i] = y0[i] + h / 2 * l->k2[i];
+    ok &= mexp_eval_tree_batch(tree, v, l->k3, n);
+
+    ensemble__fill(l->x, x + h, n);
+    for (u32 i = 0; i < n; i ++) l->y[i] = y0[i] + h * l->k3[i];
+    ok &= mexp_eval_tree_batch(tree, v, l->k4, n);
+
+    for (u32 i = 0; i < n; i ++)
+        y1[i] = y0[i] + h * (l->k1[i] + 2 * l->k2[i] + 2 * l->k3[i] + l->k4[i]) / 6;
+    return ok;
+}
+
+static void ensemble__worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    ensemble_job_t *job = (ensemble_job_t *)user;
+    ensemble_t *e = job->ensemble;
+    mexp_tree_t *tree = &job->trees[worker];
+    ensemble_lanes_t lanes;
+
+    for (u32 lane = begin; lane < end; lane += MEXP_BATCH_SIZE)
+    {
+        u32 n = end - lane < MEXP_BATCH_SIZE ? end - lane : MEXP_BATCH_SIZE;
+        u32 live[MEXP_BATCH_SIZE], live_count = 0;
+        double norm[MEXP_BATCH_SIZE];
+        double x = e->x0;
+        for (u32 i = 0; i < n; i ++)
+        {
+            const double v = ensemble_row(e, 0)[lane + i];
+            norm[live_count] = fabs(v);
+            e->alive[lane + i] = e->steps;
+            if (diverge_test(job->diverge, fabs(v), fabs(v), 0))
+            {
+                e->alive[lane + i] = 0;
+                pf_atomic_add(&job->diverged, 1);
+            }
+            else
+                live[live_count ++] = i;
+        }
+        for (u32 s = 1; s < e->steps && live_count; s ++)
+        {
+            // the rows themselves while every lane lives, packed copies after
+            const int packed = live_count < n;
+            const double *y0 = packed ? lanes.p0 : ensemble_row(e, s - 1) + lane;
+            double *y1 = packed ? lanes.p1 : ensemble_row(e, s) + lane;
+            for (u32 k = 0; packed && k < live_count; k ++)
+                lanes.p0[k] = ensemble_row(e, s - 1)[lane + live[k]];
+            if (!ensemble__rk4(tree, &lanes, x, e->h, y0, y1, live_count))
+                pf_atomic_store(&job->failed, 1);
+            x = e->x0 + s * e->h;
+
+            u32 keep = 0;
+            for (u32 k = 0; k < live_count; k ++)
+            {
+                const double v = y1[k];
+                ensemble_row(e, s)[lane + live[k]] = v;
+                if (diverge_test(job->diverge, fabs(v), norm[k], e->h))
+                {
+                    e->alive[lane + live[k]] = s;
+                    pf_atomic_add(&job->diverged, 1);
+                    continue;
+                }
+                live[keep] = live[k];
+                norm[keep ++] = fabs(v);
+            }
+            live_count = keep;
+        }
+    }
+}
+
+int init_ensemble(ensemble_t *ensemble, u32 count, u32 steps)
+{
+    ensemble->count = count;
+    ensemble->steps = steps;
+    ensemble->x0 = 0;
+    ensemble->h  = 0;
+    ensemble->seconds = 0;
+    ensemble->rate = 0;
+    ensemble->diverged = 0;
+    ensemble->y = (double *)calloc((size_t)count * steps, sizeof(*ensemble->y));
+    ensemble->alive = (u32 *)calloc(count, sizeof(*ensemble->alive));
+    return ensemble->y != NULL && ensemble->alive != NULL;
+}
+
+void destroy_ensemble(ensemble_t *ensemble)
+{
+    if (ensemble->y)
+        free(ensemble->y);
+    free(ensemble->alive);
+    ensemble->y = NULL;
+    ensemble->alive = NULL;
+    ensemble->count = 0;
+    ensemble->steps = 0;
+}
+
+int run_ensemble(ensemble_t *ensemble, pool_t *pool, const mexp_tree_t *tree, const diverge_t *diverge, double x0, double h, const double *y0)
+{
+    u32 workers = pool_worker_count(pool);
+    ensemble_job_t job = {ensemble, NULL, diverge, 0, 0};
+
+    // every worker evaluates its own copy, trees keep scratch values in their nodes
+    job.trees = (mexp_tree_t *)calloc(workers, sizeof(*job.trees));
+    if (!job.trees)
+        return 0;
+    for (u32 i = 0; i < workers; i ++)
+        if (!mexp_init_tree(&job.trees[i]) || !mexp_copy_tree(&job.trees[i], tree))
+            job.failed = 1;
+
+    ensemble->x0 = x0;
+    ensemble->h  = h;
+    memcpy(ensemble_row(ensemble, 0), y0, ensemble->count * sizeof(*y0));
+
+    double begin = pf_time();
+    if (!job.failed)
+    {
+        // lane groups are never split between workers
+        u32 grain = MEXP_BATCH_SIZE * 4;
+        pool_for(pool, ensemble->count, grain, ensemble__worker, &job);
+    }
+    ensemble->seconds = pf_time() - begin;
+    ensemble->diverged = job.diverged;
+
+    // a lane that died at row s took s steps, one that did not steps - 1
+    double lane_steps = 0;
+    for (u32 i = 0; !job.failed && i < ensemble->count; i ++)
+        lane_steps += ensemble->alive[i] < ensemble->steps ? ensemble->alive[i] : ensemble->steps - 1;
+    ensemble->rate = ensemble->seconds > 0 ? lane_steps / ensemble->seconds : 0;
+
+    for (u32 i = 0; i < workers; i ++)
+        mexp_free_tree(&job.trees[i]);
+    free(job.trees);
+    return !job.failed;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "mexp.h"
+#include "diverge.h"
+
+// integrates many initial conditions of dy/dx = f(x, y) in lockstep with rk4,
+// y is stored step-major so that every step is one contiguous row of lanes.
+// a lane that diverges is dropped from its group and the live ones are
+// packed together, so the rest of the run spends nothing on it
+typedef struct ensemble_t
+{
+    u32 count;
+    u32 steps;
+    double x0, h;
+    double *y;
+    u32 *alive; // rows of each lane before it diverged, the rest are stale
+    u32 diverged;
+
+    double seconds;
+    double rate; // live trajectory-steps per second of the last run
+} ensemble_t;
+
+int  init_ensemble(ensemble_t *ensemble, u32 count, u32 steps);
+void destroy_ensemble(ensemble_t *ensemble);
+int  run_ensemble(ensemble_t *ensemble, pool_t *pool, const mexp_tree_t *tree, const diverge_t *diverge, double x0, double h, const double *y0);
+
+static inline double *ensemble_row(const ensemble_t *ensemble, u32 step)
+{ return ensemble->y + (size_t)step * ensemble->count; }
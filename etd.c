@@ -0,0 +1,157 @@
+#include "etd.h"
+#include <math.h>
+#include <stdio.h>
+
+#define ETD_SERIES_TERMS 20
+
+// phi_0 .. phi_3 of z, phi_k+1(z) = (phi_k(z) - 1 / k!) / z, by their series
+// near 0 where that recurrence cancels
+static void etd__phi(double z, double *phi)
+{
+    if (fabs(z) < 1)
+    {
+        for (u32 k = 0; k < 4; k ++)
+        {
+            // z^n / (n + k)!, summed from the small end
+            double terms[ETD_SERIES_TERMS], term = 1, sum = 0;
+            for (u32 n = 1; n <= k; n ++)
+                term /= n;
+            for (u32 n = 0; n < ETD_SERIES_TERMS; n ++)
+            {
+                terms[n] = term;
+                term *= z / (n + k + 1);
+            }
+            for (u32 n = ETD_SERIES_TERMS; n -- > 0;)
+                sum += terms[n];
+            phi[k] = sum;
+        }
+        return;
+    }
+    phi[0] = exp(z);
+    phi[1] = (phi[0] - 1) / z;
+    phi[2] = (phi[1] - 1) / z;
+    phi[3] = (phi[2] - 0.5) / z;
+}
+
+// the weights of one step size, the same for every whole step of a run
+typedef struct
+{
+    double a[ODE_MAX_DIM];
+    double e[ODE_MAX_DIM], e2[ODE_MAX_DIM]; // exp(h a), exp(h a / 2)
+    double p1[ODE_MAX_DIM];                 // h phi_1(h a)
+    double q[ODE_MAX_DIM];                  // h / 2 phi_1(h a / 2)
+    double w[4][ODE_MAX_DIM];               // h times the weights of the four slopes
+} etd_t;
+
+// g = f - a y
+static void etd__rest(const etd_t *t, ode_t *ode, double x, const double *y, double *g)
+{
+    ode_eval(ode, x, y, g);
+    for (u32 i = 0; i < ode->dim; i ++)
+        g[i] -= t->a[i] * y[i];
+}
+
+static int etd__setup(etd_t *t, ode_t *ode, const solve_params_t *p)
+{
+    double f[ODE_MAX_DIM];
+    // leaves the parameters' subexpressions in the registers
+    ode_eval(ode, p->x0, p->y0, f);
+    for (u32 i = 0; i < ode->dim; i ++)
+        if (!mexp_program_linear(ode->prog, i, 1 + i, 1 + ode->dim, &t->a[i]))
+            return 0;
+    return 1;
+}
+
+static void etd__weights(etd_t *t, u32 dim, double h)
+{
+    for (u32 i = 0; i < dim; i ++)
+    {
+        double phi[4], half[4];
+        etd__phi(h * t->a[i], phi);
+        etd__phi(0.5 * h * t->a[i], half);
+        t->e[i]    = phi[0];
+        t->e2[i]   = half[0];
+        t->p1[i]   = h * phi[1];
+        t->q[i]    = 0.5 * h * half[1];
+        t->w[0][i] = h * (phi[1] - 3 * phi[2] + 4 * phi[3]);
+        t->w[1][i] = h * (2 * phi[2] - 4 * phi[3]);
+        t->w[2][i] = t->w[1][i];
+        t->w[3][i] = h * (4 * phi[3] - phi[2]);
+    }
+}
+
+static void etd__euler(const etd_t *t, ode_t *ode, double x, double *y)
+{
+    double g[ODE_MAX_DIM];
+    etd__rest(t, ode, x, y, g);
+    for (u32 i = 0; i < ode->dim; i ++)
+        y[i] = t->e[i] * y[i] + t->p1[i] * g[i];
+}
+
+// cox and matthews, the stages start from the half step exponentials
+static void etd__rk4(const etd_t *t, ode_t *ode, double x, double *y, double h)
+{
+    const u32 n = ode->dim;
+    double g0[ODE_MAX_DIM], ga[ODE_MAX_DIM], gb[ODE_MAX_DIM], gc[ODE_MAX_DIM];
+    double ya[ODE_MAX_DIM], yb[ODE_MAX_DIM], yc[ODE_MAX_DIM];
+
+    etd__rest(t, ode, x, y, g0);
+    for (u32 i = 0; i < n; i ++)
+        ya[i] = t->e2[i] * y[i] + t->q[i] * g0[i];
+    etd__rest(t, ode, x + 0.5 * h, ya, ga);
+    for (u32 i = 0; i < n; i ++)
+        yb[i] = t->e2[i] * y[i] + t->q[i] * ga[i];
+    etd__rest(t, ode, x + 0.5 * h, yb, gb);
+    for (u32 i = 0; i < n; i ++)
+        yc[i] = t->e2[i] * ya[i] + t->q[i] * (2 * gb[i] - g0[i]);
+    etd__rest(t, ode, x + h, yc, gc);
+    for (u32 i = 0; i < n; i ++)
+        y[i] = t->e[i] * y[i] + t->w[0][i] * g0[i] + t->w[1][i] * ga[i] + t->w[2][i] * gb[i] + t->w[3][i] * gc[i];
+}
+
+static int etd__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    etd_t t;
+    double y[ODE_MAX_DIM];
+    memcpy(y, p->y0, sizeof(y));
+    if (!etd__setup(&t, ode, p))
+        return 0;
+    etd__weights(&t, ode->dim, p->h);
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, solve_step_x(p, n, p->first_step), y, ode->dim))
+        return 0;
+    for (u64 i = p->first_step; i < n; i ++)
+    {
+        const double x = solve_step_x(p, n, i), h = solve_step_h(p, n, i);
+        // only a cut last step needs weights of its own
+        if (h != p->h)
+            etd__weights(&t, ode->dim, h);
+        if (solver->variant == 1)
+            etd__euler(&t, ode, x, y);
+        else
+            etd__rk4(&t, ode, x, y, h);
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, i + 1), y, ode->dim))
+            return 0;
+    }
+    return 1;
+}
+
+u32 etd_solver_count(void)
+{
+    return 2;
+}
+
+void etd_solver(u32 index, solver_t *solver)
+{
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), index == 0 ? "EXPEULER" : "ETDRK4");
+    solver->order    = index == 0 ? 1 : 4;
+    solver->adaptive = 0;
+    solver->run      = etd__solve;
+    solver->variant  = solver->order;
+    solver->restartable = 1;
+}
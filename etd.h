@@ -0,0 +1,15 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+// exponential time differencing for y_i' = a_i y_i + g_i(x, y): the
+// constant a_i come out of the program (mexp_program_linear) with the
+// parameters bound, g is f minus that part, and the linear part is
+// integrated exactly through the phi functions of h a_i. EXPEULER is
+// first order at one evaluation per step, ETDRK4 is the fourth order
+// scheme of cox and matthews at four. however large and negative the a_i
+// the step is only held back by g, with every a_i = 0 they reduce to
+// euler and a classic four stage method
+u32  etd_solver_count(void);
+void etd_solver(u32 index, solver_t *solver);
@@ -0,0 +1,161 @@
+#include "event.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define EVENT_MAX_ITERATIONS 64
+
+void init_event_monitor(event_monitor_t *m)
+{
+    memset(m, 0, sizeof(*m));
+}
+
+void destroy_event_monitor(event_monitor_t *m)
+{
+    for (u32 i = 0; i < m->count; i ++)
+        mexp_free_tree(&m->events[i].tree);
+    free(m->hits);
+    memset(m, 0, sizeof(*m));
+}
+
+int add_event(event_monitor_t *m, mexp_parser_t *parser, const char *expr, int32_t length, int terminal, int direction)
+{
+    if (m->count >= EVENT_MAX)
+        return 0;
+    event_t *e = &m->events[m->count];
+    if (!mexp_init_tree(&e->tree))
+        return 0;
+    if (!mexp_generate_tree(&e->tree, parser, expr, length))
+    {
+        mexp_free_tree(&e->tree);
+        return 0;
+    }
+    e->terminal = terminal;
+    e->direction = direction;
+    m->count ++;
+    return 1;
+}
+
+void reset_event_monitor(event_monitor_t *m, ode_t *ode, solve_emit_fn emit, void *user)
+{
+    m->ode = ode;
+    m->emit = emit;
+    m->user = user;
+    m->hit_count = 0;
+    m->terminated = 0;
+    m->have_last = 0;
+}
+
+// events see the same variable slots as the ode
+static double event__g(event_monitor_t *m, u32 index, double x, const double *y)
+{
+    double vars[ODE_MAX_VARS];
+    memcpy(vars, m->ode->vars, sizeof(vars));
+    vars[0] = x;
+    for (u32 i = 0; i < m->ode->dim; i ++)
+        vars[i + 1] = y[i];
+    return mexp_eval_tree(&m->events[index].tree, vars);
+}
+
+// cubic hermite between the last point and (x1, y1) with slopes f0, f1
+static void event__interpolate(const event_monitor_t *m, double x1, const double *y1, const double *f1, double s, double *out)
+{
+    const double h = x1 - m->x;
+    const double s2 = s * s, s3 = s2 * s;
+    const double h00 = 2 * s3 - 3 * s2 + 1, h10 = s3 - 2 * s2 + s;
+    const double h01 = -2 * s3 + 3 * s2, h11 = s3 - s2;
+    for (u32 i = 0; i < m->ode->dim; i ++)
+        out[i] = h00 * m->y[i] + h10 * h * m->f[i] + h01 * y1[i] + h11 * h * f1[i];
+}
+
+static int event__crossed(int direction, double g0, double g1)
+{
+    int rising  = g0 < 0 && g1 >= 0;
+    int falling = g0 > 0 && g1 <= 0;
+    return direction == EVENT_RISING ? rising : direction == EVENT_FALLING ? falling : rising || falling;
+}
+
+static int event__record(event_monitor_t *m, u32 index, double x, const double *y)
+{
+    if (m->hit_count >= m->hit_cap)
+    {
+        u32 cap = m->hit_cap ? m->hit_cap * 2 : 16;
+        event_hit_t *hits = (event_hit_t *)realloc(m->hits, cap * sizeof(*hits));
+        if (!hits)
+            return 0;
+        m->hits = hits;
+        m->hit_cap = cap;
+    }
+    event_hit_t *hit = &m->hits[m->hit_count ++];
+    hit->event = index;
+    hit->x = x;
+    memcpy(hit->y, y, m->ode->dim * sizeof(*y));
+    return 1;
+}
+
+int event_emit(void *user, double x, const double *y, u32 dim)
+{
+    event_monitor_t *m = (event_monitor_t *)user;
+    double f[ODE_MAX_DIM], g[EVENT_MAX];
+
+    // without events there is nothing to bracket, f would cost an eval per step
+    if (!m->count)
+        return m->emit ? m->emit(m->user, x, y, dim) : 1;
+    ode_eval(m->ode, x, y, f);
+    for (u32 e = 0; e < m->count; e ++)
+        g[e] = event__g(m, e, x, y);
+
+    if (m->have_last)
+    {
+        // every crossing inside the step, kept sorted by position
+        struct { double s; u32 event; double y[ODE_MAX_DIM]; } found[EVENT_MAX];
+        u32 found_count = 0;
+        for (u32 e = 0; e < m->count; e ++)
+        {
+            if (!event__crossed(m->events[e].direction, m->g[e], g[e]))
+                continue;
+            double a = 0, b = 1, ga = m->g[e], gb = g[e], s, ys[ODE_MAX_DIM];
+            int side = 0;
+            for (u32 it = 0; it < EVENT_MAX_ITERATIONS && b - a > 1e-15; it ++)
+            {
+                s = (a * gb - b * ga) / (gb - ga);
+                if (!(s > a && s < b)) s = 0.5 * (a + b);
+                event__interpolate(m, x, y, f, s, ys);
+                double gs = event__g(m, e, m->x + s * (x - m->x), ys);
+                if (gs == 0) { a = b = s; break; }
+                // illinois: halve the stale end so the bracket keeps shrinking from both sides
+                if ((gs < 0) == (ga < 0)) { a = s; ga = gs; if (side == -1) gb *= 0.5; side = -1; }
+                else                      { b = s; gb = gs; if (side == 1) ga *= 0.5; side = 1; }
+            }
+
+            u32 at = found_count ++;
+            while (at > 0 && found[at - 1].s > b)
+            {
+                found[at] = found[at - 1];
+                at --;
+            }
+            found[at].s = b;
+            found[at].event = e;
+            event__interpolate(m, x, y, f, b, found[at].y);
+        }
+
+        for (u32 i = 0; i < found_count; i ++)
+        {
+            double xs = m->x + found[i].s * (x - m->x);
+            if (!event__record(m, found[i].event, xs, found[i].y))
+                return 0;
+            if (m->events[found[i].event].terminal)
+            {
+                m->terminated = 1;
+                if (m->emit) m->emit(m->user, xs, found[i].y, dim);
+                return 0;
+            }
+        }
+    }
+
+    m->have_last = 1;
+    m->x = x;
+    memcpy(m->y, y, dim * sizeof(*y));
+    memcpy(m->f, f, dim * sizeof(*f));
+    memcpy(m->g, g, m->count * sizeof(*g));
+    return m->emit ? m->emit(m->user, x, y, dim) : 1;
+}
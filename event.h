@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common.h"
+#include "mexp.h"
+#include "ode.h"
+#include "solve.h"
+
+#define EVENT_MAX 8
+
+enum
+{
+    EVENT_ANY = 0,
+    EVENT_RISING = 1,
+    EVENT_FALLING = -1,
+};
+
+// sign changes of g(x, y), terminal events end the run at the crossing
+typedef struct event_t
+{
+    mexp_tree_t tree;
+    int terminal;
+    int direction;
+} event_t;
+
+typedef struct event_hit_t
+{
+    u32 event;
+    double x;
+    double y[ODE_MAX_DIM];
+} event_hit_t;
+
+// sits between a solver and its emit callback: every accepted step is
+// bracketed by a cubic hermite interpolant built from y and f at both ends,
+// and crossings are located on it with the illinois method
+typedef struct event_monitor_t
+{
+    event_t events[EVENT_MAX];
+    u32 count;
+    ode_t *ode;
+    solve_emit_fn emit;
+    void *user;
+
+    event_hit_t *hits;
+    u32 hit_count, hit_cap;
+    int terminated;
+
+    // last accepted point
+    int have_last;
+    double x, y[ODE_MAX_DIM], f[ODE_MAX_DIM], g[EVENT_MAX];
+} event_monitor_t;
+
+void init_event_monitor(event_monitor_t *monitor);
+void destroy_event_monitor(event_monitor_t *monitor);
+int  add_event(event_monitor_t *monitor, mexp_parser_t *parser, const char *expr, int32_t length, int terminal, int direction);
+
+// arms the monitor for a run of ode that forwards points to emit
+void reset_event_monitor(event_monitor_t *monitor, ode_t *ode, solve_emit_fn emit, void *user);
+
+// solve_emit_fn taking the monitor as user, a terminal hit emits the event
+// point and stops the solver, which then reports failure: check terminated
+int  event_emit(void *user, double x, const double *y, u32 dim);
@@ -0,0 +1,288 @@
+#include "gbs.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GBS_SAFETY 0.94
+#define GBS_SAFETY_EXP 0.65
+#define GBS_MIN_SCALE 0.02
+#define GBS_MAX_SCALE 4.0
+
+static const u32 gbs__seq[GBS_MAX_ROWS] = {2, 4, 6, 8, 10, 12, 14, 16, 18, 20};
+
+typedef struct gbs_t
+{
+    ode_t *odes; // one per pool worker, the caller's ode is odes[0]
+    u32 ode_count;
+    mexp_program_t *progs;
+    pool_t *pool;
+    u32 dim;
+
+    // the step being extrapolated
+    double x, H;
+    const double *y;
+    double f0[ODE_MAX_DIM];
+    double T[GBS_MAX_ROWS][GBS_MAX_ROWS][ODE_MAX_DIM];
+    u32 rows; // rows the next pool_for computes
+} gbs_t;
+
+// unsmoothed modified midpoint, its error expands in even powers of h for even n
+static void gbs__midpoint(gbs_t *g, ode_t *ode, u32 row)
+{
+    const u32 n = gbs__seq[row], dim = g->dim;
+    const double h = g->H / n;
+    double z0[ODE_MAX_DIM], z1[ODE_MAX_DIM], f[ODE_MAX_DIM];
+
+    for (u32 i = 0; i < dim; i ++)
+    {
+        z0[i] = g->y[i];
+        z1[i] = g->y[i] + h * g->f0[i];
+    }
+    for (u32 m = 1; m < n; m ++)
+    {
+        ode_eval(ode, g->x + m * h, z1, f);
+        for (u32 i = 0; i < dim; i ++)
+        {
+            double z = z0[i] + 2 * h * f[i];
+            z0[i] = z1[i];
+            z1[i] = z;
+        }
+    }
+    memcpy(g->T[row][0], z1, dim * sizeof(*z1));
+}
+
+// rows are handed out longest first so the tail of the pool_for stays short
+static void gbs__rows(void *user, u32 begin, u32 end, u32 worker)
+{
+    gbs_t *g = (gbs_t *)user;
+    for (u32 i = begin; i < end; i ++)
+        gbs__midpoint(g, &g->odes[worker], g->rows - 1 - i);
+}
+
+static void gbs__extrapolate(gbs_t *g, u32 j)
+{
+    for (u32 k = 1; k <= j; k ++)
+    {
+        double r = (double)gbs__seq[j] / gbs__seq[j - k];
+        double d = r * r - 1;
+        for (u32 i = 0; i < g->dim; i ++)
+            g->T[j][k][i] = g->T[j][k - 1][i] + (g->T[j][k - 1][i] - g->T[j - 1][k - 1][i]) / d;
+    }
+}
+
+static double gbs__error(const gbs_t *g, u32 j, const solve_params_t *p)
+{
+    double e = 0;
+    for (u32 i = 0; i < g->dim; i ++)
+    {
+        double sc = p->atol + p->rtol * fmax(fabs(g->y[i]), fabs(g->T[j][j][i]));
+        double r = fabs(g->T[j][j][i] - g->T[j][j - 1][i]) / sc;
+        e = r > e ? r : e;
+    }
+    return e;
+}
+
+// rows [first, last] of the tableau, in parallel when there is a pool
+static void gbs__compute_rows(gbs_t *g, u32 first, u32 last)
+{
+    if (g->pool && first == 0 && last > 0)
+    {
+        g->rows = last + 1;
+        pool_for(g->pool, g->rows, 1, gbs__rows, g);
+    }
+    else
+    {
+        for (u32 j = first; j <= last; j ++)
+            gbs__midpoint(g, &g->odes[0], j);
+    }
+}
+
+static int gbs__init(gbs_t *g, ode_t *ode, pool_t *pool)
+{
+    memset(g, 0, sizeof(*g));
+    g->dim = ode->dim;
+    g->ode_count = pool && pool_worker_count(pool) > 1 ? pool_worker_count(pool) : 1;
+    g->pool = g->ode_count > 1 ? pool : NULL;
+    g->odes = (ode_t *)calloc(g->ode_count, sizeof(*g->odes));
+    g->progs = (mexp_program_t *)calloc(g->ode_count, sizeof(*g->progs));
+    if (!g->odes || !g->progs)
+        return 0;
+
+    // worker 0 is the calling thread and keeps using the caller's program
+    g->odes[0] = *ode;
+    g->odes[0].evals = 0;
+    for (u32 w = 1; w < g->ode_count; w ++)
+    {
+        if (!mexp_init_program(&g->progs[w]) || !mexp_copy_program(&g->progs[w], ode->prog))
+            return 0;
+        init_ode(&g->odes[w], &g->progs[w]);
+        memcpy(g->odes[w].vars, ode->vars, sizeof(ode->vars));
+    }
+    return 1;
+}
+
+static void gbs__destroy(gbs_t *g, ode_t *ode)
+{
+    for (u32 w = 0; g->odes && w < g->ode_count; w ++)
+        ode->evals += g->odes[w].evals;
+    for (u32 w = 1; g->progs && w < g->ode_count; w ++)
+        mexp_free_program(&g->progs[w]);
+    free(g->odes);
+    free(g->progs);
+}
+
+static int gbs__fixed(gbs_t *g, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const u32 k = GBS_FIXED_COLUMN;
+    double y[ODE_MAX_DIM];
+    memcpy(y, p->y0, sizeof(y));
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, p->x0, y, g->dim))
+        return 0;
+    for (u64 s = 0; s < n; s ++)
+    {
+        g->x = solve_step_x(p, n, s);
+        g->H = solve_step_h(p, n, s);
+        g->y = y;
+        ode_eval(&g->odes[0], g->x, y, g->f0);
+        gbs__compute_rows(g, 0, k);
+        for (u32 j = 1; j <= k; j ++)
+            gbs__extrapolate(g, j);
+        memcpy(y, g->T[k][k], g->dim * sizeof(*y));
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, s + 1), y, g->dim))
+            return 0;
+    }
+    return 1;
+}
+
+// order and step control after hairer, norsett and wanner, with the rows up
+// to k + 1 computed at once when they can run in parallel
+static int gbs__adaptive(gbs_t *g, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const double dir = p->x1 >= p->x0 ? 1 : -1;
+    double y[ODE_MAX_DIM], x = p->x0, H = fabs(p->h) * dir;
+    double work[GBS_MAX_ROWS], hopt[GBS_MAX_ROWS], cost[GBS_MAX_ROWS];
+    u32 k = GBS_FIXED_COLUMN;
+    memcpy(y, p->y0, sizeof(y));
+
+    cost[0] = gbs__seq[0];
+    for (u32 j = 1; j < GBS_MAX_ROWS; j ++)
+        cost[j] = cost[j - 1] + gbs__seq[j] - 1;
+
+    if (emit && !emit(user, x, y, g->dim))
+        return 0;
+    while ((p->x1 - x) * dir > 0)
+    {
+        if (stats->steps + stats->rejected >= p->max_steps)
+            return 0;
+        if ((x + H - p->x1) * dir > 0)
+            H = p->x1 - x;
+
+        g->x = x;
+        g->H = H;
+        g->y = y;
+        ode_eval(&g->odes[0], x, y, g->f0);
+
+        u32 done = 0, accepted = 0;
+        if (g->pool)
+        {
+            gbs__compute_rows(g, 0, k + 1);
+            done = k + 2;
+        }
+        for (u32 j = 0; j <= k + 1; j ++)
+        {
+            if (j >= done)
+            {
+                gbs__compute_rows(g, j, j);
+                done = j + 1;
+            }
+            if (j == 0)
+                continue;
+            gbs__extrapolate(g, j);
+            double e = gbs__error(g, j, p);
+            double scale = e > 0 ? GBS_SAFETY * pow(GBS_SAFETY_EXP / e, 1.0 / (2 * j + 1)) : GBS_MAX_SCALE;
+            if (!isfinite(scale)) scale = GBS_MIN_SCALE;
+            hopt[j] = H * fmin(GBS_MAX_SCALE, fmax(GBS_MIN_SCALE, scale));
+            work[j] = cost[j] / fabs(hopt[j]);
+            if (j + 1 >= k && e <= 1)
+            {
+                accepted = j;
+                break;
+            }
+        }
+
+        if (!accepted)
+        {
+            stats->rejected ++;
+            // column k missed the tolerance, so hopt[k] is below H
+            H = hopt[k];
+            if (fabs(H) < 1e-14 * fmax(1, fabs(x)))
+                return 0;
+            continue;
+        }
+
+        u32 j = accepted;
+        x += H;
+        memcpy(y, g->T[j][j], g->dim * sizeof(*y));
+        stats->steps ++;
+        if (emit && !emit(user, x, y, g->dim))
+            return 0;
+
+        // move the target column toward the cheapest work per unit step
+        if (j > 1 && work[j - 1] < 0.8 * work[j])
+        {
+            k = j - 1 > 1 ? j - 1 : 2;
+            H = hopt[k];
+        }
+        else if (j + 1 < GBS_MAX_ROWS - 1 && (j == 1 || work[j] < 0.9 * work[j - 1]))
+        {
+            k = j + 1;
+            H = hopt[j] * cost[k] / cost[j];
+        }
+        else
+        {
+            k = j > 1 ? j : 2;
+            H = hopt[j];
+        }
+        // row k + 1 has to exist
+        if (k > GBS_MAX_ROWS - 2)
+        {
+            k = GBS_MAX_ROWS - 2;
+            H = hopt[k];
+        }
+    }
+    return 1;
+}
+
+static int gbs__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    gbs_t *g = (gbs_t *)malloc(sizeof(*g));
+    (void)solver;
+    if (!g)
+        return 0;
+    int ok = gbs__init(g, ode, p->pool);
+    if (ok)
+        ok = p->rtol > 0 ? gbs__adaptive(g, p, emit, user, stats) : gbs__fixed(g, p, emit, user, stats);
+    gbs__destroy(g, ode);
+    free(g);
+    return ok;
+}
+
+u32 gbs_solver_count(void)
+{
+    return 1;
+}
+
+void gbs_solver(u32 index, solver_t *solver)
+{
+    (void)index;
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), "GBS");
+    solver->order    = 2 * GBS_FIXED_COLUMN + 2;
+    solver->adaptive = 1;
+    solver->run      = gbs__solve;
+}
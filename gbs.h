@@ -0,0 +1,14 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+#define GBS_MAX_ROWS 10
+#define GBS_FIXED_COLUMN 4
+
+// gragg-bulirsch-stoer: modified midpoint runs with n = 2, 4, 6, ... substeps
+// over one macro step are extrapolated to h = 0 in powers of h^2, column k
+// of the tableau has order 2k + 2. adaptive runs pick the column and the
+// macro step from the work per unit step, fixed ones stop at GBS_FIXED_COLUMN
+u32  gbs_solver_count(void);
+void gbs_solver(u32 index, solver_t *solver);
@@ -236,6 +236,32 @@ void draw_line(graphics_t *graphics, world_t *world, float sx, float sy, float e
     SDL_RenderDrawLineF(graphics->renderer, sx, sy, ex, ey);
 }
 
+void draw_lines(graphics_t *graphics, world_t *world, const vec2f *pts, u32 count, u32 color)
+{
+    int w, h;
+    SDL_FPoint run[256];
+    u32 len = 0;
+    SDL_RenderGetLogicalSize(graphics->renderer, &w, &h);
+    SDL_SetRenderDrawColor(graphics->renderer, ARGB(color));
+    for (u32 i = 1; i < count; i ++)
+    {
+        float sx, sy, ex, ey;
+        world_to_screenf(world, pts[i - 1].x, pts[i - 1].y, &sx, &sy);
+        world_to_screenf(world, pts[i].x, pts[i].y, &ex, &ey);
+        int clipped = liang_barsky(0, 0, w, h, sx, sy, ex, ey, &sx, &sy, &ex, &ey);
+        // flush the current strip whenever it gets cut or full
+        if (len && (clipped || len == sizeof(run) / sizeof(run[0]) || run[len - 1].x != sx || run[len - 1].y != sy))
+        {
+            if (len > 1) SDL_RenderDrawLinesF(graphics->renderer, run, len);
+            len = 0;
+        }
+        if (clipped) continue;
+        if (len == 0) run[len ++] = (SDL_FPoint){sx, sy};
+        run[len ++] = (SDL_FPoint){ex, ey};
+    }
+    if (len > 1) SDL_RenderDrawLinesF(graphics->renderer, run, len);
+}
+
 void draw_text(graphics_t *graphics, world_t *world, float x, float y, float scale, const string_t *text, u32 color)
 {
     world_to_screenf(world, x, y, &x, &y);
@@ -35,6 +35,7 @@ void fill_rect(graphics_t *graphics, world_t *world, float x, float y, float w,
 void draw_rounded_rect(graphics_t *graphics, world_t *world, float x, float y, float w, float h, float r, u32 color);
 void fill_rounded_rect(graphics_t *graphics, world_t *world, float x, float y, float w, float h, float r, u32 color);
 void draw_line(graphics_t *graphics, world_t *world, float sx, float sy, float ex, float ey, u32 color);
+void draw_lines(graphics_t *graphics, world_t *world, const vec2f *pts, u32 count, u32 color);
 
 #define draw_rectr(G, W, R, C) draw_rect((G), (W), (R).x, (R).y, (R).w, (R).h, (C))
 #define fill_rectr(G, W, R, C) fill_rect((G), (W), (R).x, (R).y, (R).w, (R).h, (C))
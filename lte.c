@@ -0,0 +1,294 @@
+#include "lte.h"
+#include <math.h>
+#include <stdlib.h>
+
+// the reference runs rk4 through 2 and 4 substeps
+#define LTE_REF_COARSE 2
+#define LTE_REF_FINE 4
+
+typedef struct
+{
+    lte_map_t *map;
+    u32 first; // into order
+    volatile u32 failed;
+} lte_job_t;
+
+typedef struct
+{
+    double x[MEXP_BATCH_SIZE];
+    double y[MEXP_BATCH_SIZE];
+    double xs[MEXP_BATCH_SIZE]; // stage points
+    double ys[MEXP_BATCH_SIZE];
+    double xq[MEXP_BATCH_SIZE]; // substep starts
+    double out[MEXP_BATCH_SIZE];
+    double coarse[MEXP_BATCH_SIZE];
+    double fine[MEXP_BATCH_SIZE];
+    double k[RK_MAX_STAGES][MEXP_BATCH_SIZE];
+} lte_lanes_t;
+
+// one step of the tableau for n lanes, each at its own x, y1 may be y0
+static int lte__step(mexp_tree_t *tree, const rk_tableau_t *t, lte_lanes_t *l, const double *x, const double *y0,
+                     double h, double *y1, u32 n)
+{
+    const double *v[2] = {l->xs, l->ys};
+    int ok = 1;
+    for (u32 s = 0; s < t->stages; s ++)
+    {
+        for (u32 i = 0; i < n; i ++)
+        {
+            double acc = 0;
+            for (u32 j = 0; j < s; j ++)
+                acc += t->a[s][j] * l->k[j][i];
+            l->xs[i] = x[i] + t->c[s] * h;
+            l->ys[i] = y0[i] + h * acc;
+        }
+        ok &= mexp_eval_tree_batch(tree, v, l->k[s], n);
+    }
+    for (u32 i = 0; i < n; i ++)
+    {
+        double acc = 0;
+        for (u32 s = 0; s < t->stages; s ++)
+            acc += t->b[s] * l->k[s][i];
+        y1[i] = y0[i] + h * acc;
+    }
+    return ok;
+}
+
+static int lte__substeps(mexp_tree_t *tree, const rk_tableau_t *t, lte_lanes_t *l, double h, u32 m, double *y1, u32 n)
+{
+    int ok = 1;
+    memcpy(y1, l->y, n * sizeof(*y1));
+    for (u32 q = 0; q < m; q ++)
+    {
+        for (u32 i = 0; i < n; i ++)
+            l->xq[i] = l->x[i] + q * h / m;
+        ok &= lte__step(tree, t, l, l->xq, y1, h / m, y1, n);
+    }
+    return ok;
+}
+
+static void lte__worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    lte_job_t *job = (lte_job_t *)user;
+    lte_map_t *map = job->map;
+    mexp_tree_t *tree = &map->trees[worker];
+    const rk_tableau_t *ref = map->reference;
+    const double scale = (double)(LTE_REF_FINE * LTE_REF_FINE * LTE_REF_FINE * LTE_REF_FINE) /
+                         (LTE_REF_COARSE * LTE_REF_COARSE * LTE_REF_COARSE * LTE_REF_COARSE);
+    lte_lanes_t lanes, *l = &lanes;
+
+    for (u32 o = begin; o < end; o ++)
+    {
+        rect_t r;
+        lte_tile_rect(map, map->order[job->first + o], &r);
+        for (i32 row = r.y; row < r.y + r.h; row ++)
+        {
+            for (i32 col = r.x; col < r.x + r.w; col += MEXP_BATCH_SIZE)
+            {
+                u32 n = r.x + r.w - col < MEXP_BATCH_SIZE ? (u32)(r.x + r.w - col) : MEXP_BATCH_SIZE;
+                for (u32 i = 0; i < n; i ++)
+                {
+                    l->x[i] = map->left + (col + i) * map->pixel;
+                    l->y[i] = -(map->top + row * map->pixel);
+                }
+
+                // richardson on the fourth order substeps
+                int ok = lte__substeps(tree, ref, l, map->step, LTE_REF_COARSE, l->coarse, n);
+                ok &= lte__substeps(tree, ref, l, map->step, LTE_REF_FINE, l->fine, n);
+                for (u32 i = 0; i < n; i ++)
+                    l->fine[i] += (l->fine[i] - l->coarse[i]) / (scale - 1);
+
+                for (u32 m = 0; m < map->method_count; m ++)
+                {
+                    float *e = map->error + (size_t)m * map->w * map->h + (size_t)row * map->w + col;
+                    ok &= lte__step(tree, map->methods[m], l, l->x, l->y, map->step, l->out, n);
+                    for (u32 i = 0; i < n; i ++)
+                    {
+                        double d = fabs(l->out[i] - l->fine[i]);
+                        e[i] = isfinite(d) ? (float)log10(fmax(d, 1e-300)) : NAN;
+                    }
+                }
+                if (!ok)
+                    pf_atomic_store(&job->failed, 1);
+            }
+        }
+    }
+}
+
+int init_lte_map(lte_map_t *map, pool_t *pool, const rk_tableau_t *const *methods, u32 method_count)
+{
+    memset(map, 0, sizeof(*map));
+    if (method_count == 0 || method_count > LTE_MAX_METHODS)
+        return 0;
+    memcpy(map->methods, methods, method_count * sizeof(*methods));
+    map->method_count = method_count;
+    map->reference = rk_find_method("rk4")->tableau;
+    map->tree_count = pool_worker_count(pool);
+    map->trees = (mexp_tree_t *)calloc(map->tree_count, sizeof(*map->trees));
+    if (!map->trees)
+        return 0;
+    for (u32 i = 0; i < map->tree_count; i ++)
+        if (!mexp_init_tree(&map->trees[i]))
+            return 0;
+    return 1;
+}
+
+void destroy_lte_map(lte_map_t *map)
+{
+    for (u32 i = 0; map->trees && i < map->tree_count; i ++)
+        mexp_free_tree(&map->trees[i]);
+    free(map->trees);
+    free(map->error);
+    free(map->order);
+    map->trees = NULL;
+    map->error = NULL;
+    map->order = NULL;
+}
+
+int lte_set_tree(lte_map_t *map, const mexp_tree_t *tree)
+{
+    map->have_tree = 0;
+    map->next = 0;
+    for (u32 i = 0; i < map->tree_count; i ++)
+        if (!mexp_copy_tree(&map->trees[i], tree))
+            return 0;
+    map->have_tree = 1;
+    return 1;
+}
+
+static int lte__compare(const void *a, const void *b)
+{
+    u64 ka = *(const u64 *)a, kb = *(const u64 *)b;
+    return (ka > kb) - (ka < kb);
+}
+
+// squared distance to the centre in doubled tile units above the tile index
+static int lte__order_tiles(lte_map_t *map)
+{
+    const u32 total = map->tiles_x * map->tiles_y;
+    u64 *keys = (u64 *)malloc(total * sizeof(u64));
+    if (!keys)
+        return 0;
+    for (u32 i = 0; i < total; i ++)
+    {
+        i64 dx = 2 * (i64)(i % map->tiles_x) - (map->tiles_x - 1);
+        i64 dy = 2 * (i64)(i / map->tiles_x) - (map->tiles_y - 1);
+        keys[i] = ((u64)(dx * dx + dy * dy) << 32) | i;
+    }
+    qsort(keys, total, sizeof(u64), lte__compare);
+    for (u32 i = 0; i < total; i ++)
+        map->order[i] = (u32)keys[i];
+    free(keys);
+    return 1;
+}
+
+int lte_reset(lte_map_t *map, u32 w, u32 h, double left, double top, double pixel, double step)
+{
+    if (w != map->w || h != map->h || !map->error)
+    {
+        u32 tiles_x = (w + LTE_TILE_SIZE - 1) / LTE_TILE_SIZE, tiles_y = (h + LTE_TILE_SIZE - 1) / LTE_TILE_SIZE;
+        float *error = (float *)malloc((size_t)map->method_count * w * h * sizeof(float));
+        u32 *order = (u32 *)malloc((size_t)tiles_x * tiles_y * sizeof(u32));
+        if (!error || !order)
+        {
+            free(error);
+            free(order);
+            return 0;
+        }
+        free(map->error);
+        free(map->order);
+        map->error = error;
+        map->order = order;
+        map->w = w;
+        map->h = h;
+        map->tiles_x = tiles_x;
+        map->tiles_y = tiles_y;
+        if (!lte__order_tiles(map))
+        {
+            map->w = map->h = 0;
+            return 0;
+        }
+    }
+    map->left = left;
+    map->top = top;
+    map->pixel = pixel;
+    map->step = step;
+    map->next = 0;
+    return 1;
+}
+
+u32 lte_advance(lte_map_t *map, pool_t *pool, double budget)
+{
+    const u32 total = map->tiles_x * map->tiles_y, workers = pool_worker_count(pool);
+    lte_job_t job = {map, 0, 0};
+    double begin = pf_time();
+    u32 done = 0;
+
+    if (!map->have_tree)
+        return 0;
+    while (map->next < total)
+    {
+        // a round is one tile per worker, the next one only starts when it should fit
+        u32 round = total - map->next < workers ? total - map->next : workers;
+        double elapsed = pf_time() - begin;
+        if (done && elapsed + map->round_seconds > budget)
+            break;
+
+        double start = pf_time();
+        job.first = map->next;
+        pool_for(pool, round, 1, lte__worker, &job);
+        double cost = pf_time() - start;
+        map->round_seconds = map->round_seconds > 0 ? 0.75 * map->round_seconds + 0.25 * cost : cost;
+        map->next += round;
+        done += round;
+        if (pf_atomic_load(&job.failed))
+        {
+            // out of scratch memory, the map stays as far as it got
+            map->have_tree = 0;
+            break;
+        }
+    }
+    return done;
+}
+
+void lte_tile_rect(const lte_map_t *map, u32 tile, rect_t *rect)
+{
+    rect->x = (tile % map->tiles_x) * LTE_TILE_SIZE;
+    rect->y = (tile / map->tiles_x) * LTE_TILE_SIZE;
+    rect->w = map->w - rect->x < LTE_TILE_SIZE ? (int)map->w - rect->x : LTE_TILE_SIZE;
+    rect->h = map->h - rect->y < LTE_TILE_SIZE ? (int)map->h - rect->y : LTE_TILE_SIZE;
+}
+
+// blue, aqua, green, yellow, red at equal steps over the scale
+u32 lte_ramp(float t, u32 alpha)
+{
+    static const float stops[5][3] =
+    {
+        {0x45, 0x85, 0x88}, {0x89, 0xb4, 0x82}, {0xa9, 0xb6, 0x65}, {0xd8, 0xa6, 0x57}, {0xea, 0x69, 0x62},
+    };
+    t *= 4;
+    t = t < 0 ? 0 : t > 4 ? 4 : t;
+    u32 i = t >= 4 ? 3 : (u32)t;
+    float f = t - i;
+    u32 c = alpha << 24;
+    for (u32 k = 0; k < 3; k ++)
+        c |= (u32)(stops[i][k] + f * (stops[i + 1][k] - stops[i][k])) << (16 - 8 * k);
+    return c;
+}
+
+static u32 lte__color(float v, u32 alpha)
+{
+    if (isnan(v))
+        return 0;
+    return lte_ramp((v - LTE_LOG_MIN) / (LTE_LOG_MAX - LTE_LOG_MIN), alpha);
+}
+
+void lte_paint(const lte_map_t *map, u32 method, u32 tile, u32 *pixels, u32 alpha)
+{
+    rect_t r;
+    lte_tile_rect(map, tile, &r);
+    const float *plane = map->error + (size_t)method * map->w * map->h;
+    for (i32 row = r.y; row < r.y + r.h; row ++)
+        for (i32 col = r.x; col < r.x + r.w; col ++)
+            pixels[(size_t)row * map->w + col] = lte__color(plane[(size_t)row * map->w + col], alpha);
+}
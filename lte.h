@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "mexp.h"
+#include "rk.h"
+
+#define LTE_TILE_SIZE 64
+#define LTE_MAX_METHODS 4
+// the colour scale of lte_paint in log10 of the error
+#define LTE_LOG_MIN -14.0f
+#define LTE_LOG_MAX -2.0f
+
+// one-step local error of a few explicit methods at every pixel of a view
+// of the (x, y) plane, for a scalar dy/dx = f(x, y). each pixel starts a
+// step of size h at its own (x, y) and is compared against two and four
+// rk4 substeps extrapolated by richardson. a pixel row is one batch of
+// lanes, the view is cut into tiles that are computed nearest the centre
+// first, a few per call, so the map fills in while the view stays usable
+typedef struct lte_map_t
+{
+    const rk_tableau_t *methods[LTE_MAX_METHODS];
+    u32 method_count;
+    const rk_tableau_t *reference;
+    mexp_tree_t *trees; // one per pool worker
+    u32 tree_count;
+    int have_tree;
+
+    u32 w, h;
+    u32 tiles_x, tiles_y;
+    double left, top, pixel; // world position of the first pixel centre, world units per pixel
+    double step;
+    float *error; // log10 of the error, one plane of w * h per method, NaN where f is not finite
+
+    u32 *order; // tiles by distance to the centre
+    u32 next;   // tiles of order before it are done
+    double round_seconds; // smoothed cost of a round, one tile per worker
+} lte_map_t;
+
+int  init_lte_map(lte_map_t *map, pool_t *pool, const rk_tableau_t *const *methods, u32 method_count);
+void destroy_lte_map(lte_map_t *map);
+// a new equation, the view starts over
+int  lte_set_tree(lte_map_t *map, const mexp_tree_t *tree);
+// a new view: pixel (i, j) sits at world (left + i * pixel, top + j * pixel),
+// the plotted y being -world y. returns 0 when out of memory
+int  lte_reset(lte_map_t *map, u32 w, u32 h, double left, double top, double pixel, double step);
+// computes tiles on the pool for about budget seconds, always at least one
+// round of them, and returns how many. the new ones are order[next - count .. next)
+u32  lte_advance(lte_map_t *map, pool_t *pool, double budget);
+// colours one tile of method into pixels (w * h, 0xaarrggbb), blue for
+// errors at LTE_LOG_MIN and below through to red at LTE_LOG_MAX
+void lte_paint(const lte_map_t *map, u32 method, u32 tile, u32 *pixels, u32 alpha);
+// the colour of t in [0, 1] on the same scale, clamped outside it
+u32  lte_ramp(float t, u32 alpha);
+void lte_tile_rect(const lte_map_t *map, u32 tile, rect_t *rect);
+
+static inline int lte_done(const lte_map_t *map)
+{ return map->next >= map->tiles_x * map->tiles_y; }
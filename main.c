@@ -2,6 +2,23 @@
 #include "graphics.h"
 #include "events.h"
 #include "mexp.h"
+#include "pool.h"
+#include "ensemble.h"
+#include "rk.h"
+#include "solve.h"
+#include "traj.h"
+#include "bench.h"
+#include "event.h"
+#include "system.h"
+#include "task.h"
+#include "march.h"
+#include "series.h"
+#include "sde.h"
+#include "sens.h"
+#include "lte.h"
+#include "sweep.h"
+#include "diverge.h"
+#include <math.h>
 
 #ifdef PF_WINDOWS
 #define WIN32_LEAN_AND_MEAN
@@ -11,51 +28,795 @@
 #define MAX_LENGTH 256
 #define DEFAULT_WINDOW_WIDTH 1280
 #define DEFAULT_WINDOW_HEIGHT 720
+#define ENSEMBLE_COUNT 1024
+#define ENSEMBLE_DRAW_STRIDE 8
+#define MAX_CUSTOM_METHODS 8
+#define MAX_PLOTS 40
+#define TRAJ_MAX_COLUMNS 8192
+#define BENCH_LEVELS 10
+#define PLOT_MAX_HITS 64
+#define SCRUB_COARSE 8
+#define SLIDER_LABEL_WIDTH 130
+#define SLIDER_WIDTH 240
+#define SLIDER_MIN -5.0
+#define SLIDER_MAX 5.0
+#define FRAME_SECONDS 0.016
+#define SLICE_MIN_POINTS 16
+#define SDE_PATHS 2048
+#define SDE_BAND_COUNT 5
+#define SPREAD_SIGMA 0.1
+#define LTE_ALPHA 0x90
+#define LTE_FRAME_SECONDS 0.008
+#define SWEEP_ALPHA 0xd0
+// |y| past which a curve stops unless -limit says otherwise
+#define DIVERGE_LIMIT 1e9
 #define WHITE  0xffd4be98
 #define RED    0xffea6962
 #define GREEN  0xffa9b665
 #define YELLOW 0xffd8a657
 #define BLUE   0xff7daea3
+#define GREY   0x60928374
+#define PURPLE 0xffd3869b
+#define AQUA   0xff89b482
+#define ORANGE 0xffe78a4e
 static const u32 eul_color = BLUE;
 static const u32 rk2_color = GREEN;
 static const u32 rk4_color = YELLOW;
+static const u32 ensemble_color = GREY;
+static const u32 traj_color = ORANGE;
+static const u32 extra_colors[] = {RED, PURPLE, AQUA, ORANGE, WHITE};
+static const double band_quantiles[SDE_BAND_COUNT] = {0.05, 0.25, 0.5, 0.75, 0.95};
+static const u32 band_colors[SDE_BAND_COUNT] = {GREY, 0xb0928374, PURPLE, 0xb0928374, GREY};
 
-static void redraw_static_texture(graphics_t *graphics, SDL_Texture *static_texture, vec2i *geometry, const string_t *prompt, const rect_t *prompt_rect);
+// one integrated run, the scrub worker fills these and hands them over whole
+typedef struct curve_t
+{
+    series_t series; // fewer points after a coarse pass or a blow-up
+    vec2d hits[PLOT_MAX_HITS];
+    vec2d phase_hits[PLOT_MAX_HITS];
+    u32 hit_count;
+    diverge_guard_t guard; // where the run stopped if it diverged
+} curve_t;
+
+typedef struct plot_t
+{
+    solver_t solver;
+    curve_t curve;
+    u32 color;
+    int enabled;
+}
+plot_t;
+
+static void redraw_static_texture(graphics_t *graphics, SDL_Texture *static_texture, vec2i *geometry, const string_t *prompt, const rect_t *prompt_rect,
+                                  const plot_t *plots, u32 plot_count, const string_t *status, u32 status_color);
+
+static rect_t legend_rect(const graphics_t *graphics, const vec2i *geometry, const plot_t *plots, u32 index)
+{
+    string_t name = {plots[index].solver.name, strlen(plots[index].solver.name)};
+    rect_t rect = get_text_rect(graphics, &name);
+    rect.x = geometry->x - rect.w - 20;
+    rect.y = rect.h * index + 20;
+    return rect;
+}
+
+static void init_curve(curve_t *curve)
+{
+    memset(curve, 0, sizeof(*curve));
+    init_series(&curve->series);
+}
+
+static int add_plot(plot_t *plots, u32 *plot_count, const solver_t *solver)
+{
+    if (*plot_count >= MAX_PLOTS)
+        return 0;
+    plot_t *plot = &plots[*plot_count];
+    init_curve(&plot->curve);
+    plot->solver  = *solver;
+    plot->enabled = 0;
+    plot->color   = extra_colors[*plot_count % (sizeof(extra_colors) / sizeof(extra_colors[0]))];
+    *plot_count += 1;
+    return 1;
+}
+
+typedef struct
+{
+    series_t *series;
+    task_t *task;  // a newer job stops the run
+    u32 generation;
+    diverge_guard_t *guard;
+} plot_sink_t;
+
+// a diverged point ends the run before it reaches the series
+static int plot_point(void *user, double x, const double *y, u32 dim)
+{
+    plot_sink_t *sink = (plot_sink_t *)user;
+    if (sink->task && task_cancelled(sink->task, sink->generation))
+        return 0;
+    if (!diverge_point(sink->guard, x, y, dim))
+        return 0;
+    return series_push(sink->series, x, y);
+}
+
+// n points from x0 with step h
+static void curve_params(solve_params_t *params, double x0, const double *y0, u32 dim, double h, size_t n)
+{
+    init_solve_params(params);
+    params->x0 = x0;
+    params->x1 = x0 + (n - 1) * h;
+    params->h  = h;
+    memcpy(params->y0, y0, dim * sizeof(*y0));
+}
+
+static void copy_hits(curve_t *curve, const event_monitor_t *monitor, u32 dim)
+{
+    curve->hit_count = 0;
+    for (u32 i = 0; i < monitor->hit_count && curve->hit_count < PLOT_MAX_HITS; i ++)
+    {
+        const event_hit_t *hit = &monitor->hits[i];
+        curve->hits[curve->hit_count].x = hit->x;
+        curve->hits[curve->hit_count].y = -hit->y[0];
+        curve->phase_hits[curve->hit_count].x = hit->y[0];
+        curve->phase_hits[curve->hit_count].y = dim > 1 ? -hit->y[1] : 0;
+        curve->hit_count ++;
+    }
+}
+
+// events come from the part of the prompt after '|' and are marked on the
+// plot. every stride-th point is computed with a stride times larger step,
+// returns 0 when the job was superseded on the way
+static int integrate_curve(curve_t *curve, const solver_t *solver, ode_t *ode, event_monitor_t *monitor, const diverge_t *diverge,
+                           double x0, const double *y0, double h, size_t pt_count, u32 stride, task_t *task, u32 generation)
+{
+    const size_t n = (pt_count - 1) / stride + 1;
+    plot_sink_t sink = {&curve->series, task, generation, &curve->guard};
+    solve_params_t params;
+    curve_params(&params, x0, y0, ode->dim, h * stride, n);
+    curve->hit_count = 0;
+    reset_diverge_guard(&curve->guard, diverge);
+    if (!reset_series(&curve->series, ode->dim, n, x0, h * stride))
+        return 0;
+    reset_event_monitor(monitor, ode, plot_point, &sink);
+    solve(solver, ode, &params, monitor->count ? event_emit : plot_point, monitor->count ? (void *)monitor : &sink, NULL);
+    if (task_cancelled(task, generation))
+        return 0;
+    copy_hits(curve, monitor, ode->dim);
+    return 1;
+}
+
+// "f ~ g | e" is the system f with noise g dW and events on e, noise may be
+// NULL when only the deterministic part is wanted
+static int parse_prompt(system_t *sys, mexp_parser_t *parser, event_monitor_t *monitor, mexp_tree_t *noise, int *noisy,
+                        const char *text, u32 length, const char **error)
+{
+    u32 split = 0, tilde = 0;
+    while (split < length && text[split] != '|') split ++;
+    while (tilde < split && text[tilde] != '~') tilde ++;
+    destroy_event_monitor(monitor);
+    if (noisy)
+        *noisy = tilde < split;
+    *error = sys->error;
+    if (!parse_system(sys, parser, text, tilde))
+        return 0;
+    *error = mexp_get_error(parser);
+    if (noise && tilde < split && !mexp_generate_tree(noise, parser, text + tilde + 1, split - tilde - 1))
+        return 0;
+    return split == length || add_event(monitor, parser, text + split + 1, length - split - 1, 0, EVENT_ANY);
+}
+
+// everything the worker needs to redo the plots, posted whole on every change
+typedef struct scrub_job_t
+{
+    char text[MAX_LENGTH + 1];
+    u32 length;
+    double param_values[128];
+    solver_t solvers[MAX_PLOTS];
+    int enabled[MAX_PLOTS];
+    u32 plot_count;
+    double x0, h;
+    double y0[ODE_MAX_DIM];
+    size_t pt_count;
+    diverge_t diverge;
+} scrub_job_t;
+
+// re-integrates the enabled plots off the main thread: a coarse pass is
+// published first, then the full one, and a newer job cancels both. the
+// worker parses the prompt itself since trees are not shared between threads
+typedef struct scrub_t
+{
+    task_t task;
+    mexp_parser_t parser;
+    system_t sys;
+    event_monitor_t monitor;
+    char parsed[MAX_LENGTH + 1];
+    u32 parsed_length;
+    int parsed_ok;
+    curve_t work[MAX_PLOTS];
+
+    // handed to the main thread under lock
+    pf_mutex_t lock;
+    curve_t ready[MAX_PLOTS];
+    int ready_valid[MAX_PLOTS];
+    u32 serial; // bumped on every publish
+    double seconds; // of the last full pass
+} scrub_t;
+
+static void scrub__publish(scrub_t *scrub, const scrub_job_t *job, double seconds)
+{
+    pf_lock(&scrub->lock);
+    for (u32 i = 0; i < job->plot_count; i ++)
+    {
+        scrub->ready_valid[i] = job->enabled[i];
+        if (!job->enabled[i]) continue;
+        curve_t temp = scrub->ready[i];
+        scrub->ready[i] = scrub->work[i];
+        scrub->work[i] = temp;
+    }
+    scrub->serial ++;
+    if (seconds > 0)
+        scrub->seconds = seconds;
+    pf_unlock(&scrub->lock);
+}
+
+static void scrub__run(void *user, const void *data, u32 generation)
+{
+    scrub_t *scrub = (scrub_t *)user;
+    const scrub_job_t *job = (const scrub_job_t *)data;
+    const char *error;
+    ode_t ode;
+
+    if (job->length != scrub->parsed_length || memcmp(job->text, scrub->parsed, job->length))
+    {
+        memcpy(scrub->parsed, job->text, job->length);
+        scrub->parsed_length = job->length;
+        scrub->parsed_ok = parse_prompt(&scrub->sys, &scrub->parser, &scrub->monitor, NULL, NULL, job->text, job->length, &error);
+    }
+    if (!scrub->parsed_ok)
+        return;
+    init_ode(&ode, &scrub->sys.prog);
+    system_bind(&scrub->sys, &ode, job->param_values);
+
+    for (u32 stride = SCRUB_COARSE; stride >= 1; stride /= SCRUB_COARSE)
+    {
+        double begin = pf_time();
+        for (u32 i = 0; i < job->plot_count; i ++)
+            if (job->enabled[i] && !integrate_curve(&scrub->work[i], &job->solvers[i], &ode, &scrub->monitor, &job->diverge,
+                                                    job->x0, job->y0, job->h, job->pt_count, stride, &scrub->task, generation))
+                return;
+        scrub__publish(scrub, job, stride == 1 ? pf_time() - begin : 0);
+    }
+}
+
+static int init_scrub(scrub_t *scrub)
+{
+    memset(scrub, 0, sizeof(*scrub));
+    if (!mexp_init_parser(&scrub->parser) || !init_system(&scrub->sys)) return 0;
+    init_event_monitor(&scrub->monitor);
+    for (u32 i = 0; i < MAX_PLOTS; i ++)
+    {
+        init_curve(&scrub->work[i]);
+        init_curve(&scrub->ready[i]);
+    }
+    if (!pf_init_mutex(&scrub->lock)) return 0;
+    return init_task(&scrub->task, scrub__run, scrub, sizeof(scrub_job_t));
+}
+
+static void destroy_scrub(scrub_t *scrub)
+{
+    destroy_task(&scrub->task);
+    pf_destroy_mutex(&scrub->lock);
+    for (u32 i = 0; i < MAX_PLOTS; i ++)
+    {
+        destroy_series(&scrub->work[i].series);
+        destroy_series(&scrub->ready[i].series);
+    }
+    destroy_event_monitor(&scrub->monitor);
+    destroy_system(&scrub->sys);
+    mexp_free_parser(&scrub->parser);
+}
+
+// swaps finished curves into the plots, returns 1 when something changed
+static int take_scrub(scrub_t *scrub, plot_t *plots, u32 plot_count, u32 *seen)
+{
+    int changed = 0;
+    pf_lock(&scrub->lock);
+    if (scrub->serial != *seen)
+    {
+        *seen = scrub->serial;
+        for (u32 i = 0; i < plot_count; i ++)
+        {
+            if (!scrub->ready_valid[i]) continue;
+            curve_t temp = plots[i].curve;
+            plots[i].curve = scrub->ready[i];
+            scrub->ready[i] = temp;
+            scrub->ready_valid[i] = 0;
+        }
+        changed = 1;
+    }
+    pf_unlock(&scrub->lock);
+    return changed;
+}
+
+// the single threaded alternative to the scrub worker: plots are integrated
+// one after another on the main thread, each frame running as many points
+// as fit in what is left of it, and the partial curves are drawn as they grow
+typedef struct slicer_t
+{
+    u32 plot; // being integrated, MAX_PLOTS when idle
+    ode_t ode;
+    march_t march;
+    plot_sink_t sink;
+    double x0, h;
+    double y0[ODE_MAX_DIM];
+    size_t pt_count;
+    diverge_t diverge;
+    double point_cost; // seconds per point, smoothed over slices
+} slicer_t;
+
+static void slicer__begin(slicer_t *sl, plot_t *plots, u32 plot_count, event_monitor_t *monitor, u32 from)
+{
+    sl->plot = MAX_PLOTS;
+    for (u32 i = from; i < plot_count && sl->plot == MAX_PLOTS; i ++)
+        if (plots[i].enabled)
+            sl->plot = i;
+    if (sl->plot == MAX_PLOTS)
+        return;
+
+    curve_t *curve = &plots[sl->plot].curve;
+    solve_params_t params;
+    curve_params(&params, sl->x0, sl->y0, sl->ode.dim, sl->h, sl->pt_count);
+    sl->sink = (plot_sink_t){&curve->series, NULL, 0, &curve->guard};
+    curve->hit_count = 0;
+    reset_diverge_guard(&curve->guard, &sl->diverge);
+    if (!reset_series(&curve->series, sl->ode.dim, sl->pt_count, sl->x0, sl->h))
+    {
+        sl->plot = MAX_PLOTS;
+        return;
+    }
+    reset_event_monitor(monitor, &sl->ode, plot_point, &sl->sink);
+    init_march(&sl->march, &plots[sl->plot].solver, &sl->ode, &params,
+               monitor->count ? event_emit : plot_point, monitor->count ? (void *)monitor : &sl->sink);
+}
+
+static void start_slicer(slicer_t *sl, plot_t *plots, u32 plot_count, system_t *sys, const double *param_values,
+                         event_monitor_t *monitor, const diverge_t *diverge, double x0, const double *y0, double h, size_t pt_count)
+{
+    init_ode(&sl->ode, &sys->prog);
+    system_bind(sys, &sl->ode, param_values);
+    sl->diverge = *diverge;
+    sl->x0 = x0;
+    sl->h = h;
+    memcpy(sl->y0, y0, sizeof(sl->y0));
+    sl->pt_count = pt_count;
+    // plots that are waiting for their turn start out empty
+    for (u32 i = 0; i < plot_count; i ++)
+        if (plots[i].enabled)
+            plots[i].curve.series.count = 0;
+    slicer__begin(sl, plots, plot_count, monitor, 0);
+}
+
+// spends up to budget seconds, the quota of each slice follows the measured
+// cost per point so that one slice does not overrun the frame
+static void run_slicer(slicer_t *sl, plot_t *plots, u32 plot_count, event_monitor_t *monitor, double budget)
+{
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    const u64 begin = SDL_GetPerformanceCounter();
+    int first = 1;
+    while (sl->plot < plot_count)
+    {
+        // one slice always runs, so a frame that spent its budget on
+        // rendering still makes progress
+        double left = budget - (SDL_GetPerformanceCounter() - begin) / freq;
+        if (left <= 0 && !first)
+            break;
+        first = 0;
+        double quota = sl->point_cost > 0 ? left / sl->point_cost : SLICE_MIN_POINTS;
+        quota = fmax(SLICE_MIN_POINTS, fmin(quota, (double)sl->pt_count));
+
+        curve_t *curve = &plots[sl->plot].curve;
+        u64 before = sl->march.points, start = SDL_GetPerformanceCounter();
+        int more = advance_march(&sl->march, (u32)quota);
+        double seconds = (SDL_GetPerformanceCounter() - start) / freq;
+        if (sl->march.points > before)
+        {
+            double cost = seconds / (sl->march.points - before);
+            sl->point_cost = sl->point_cost > 0 ? 0.75 * sl->point_cost + 0.25 * cost : cost;
+        }
+
+        copy_hits(curve, monitor, sl->ode.dim);
+        if (!more)
+            slicer__begin(sl, plots, plot_count, monitor, sl->plot + 1);
+    }
+}
+
+// parameter sliders sit under the status line, one row per parameter
+static rect_t slider_rect(const rect_t *prompt_rect, u32 index)
+{
+    rect_t rect;
+    rect.x = prompt_rect->x + SLIDER_LABEL_WIDTH;
+    rect.y = prompt_rect->y + 2 * prompt_rect->h + 10 + index * (prompt_rect->h + 6);
+    rect.w = SLIDER_WIDTH;
+    rect.h = prompt_rect->h;
+    return rect;
+}
+
+static void draw_sliders(graphics_t *graphics, const rect_t *prompt_rect, const system_t *sys, const double *values, int active)
+{
+    char buf[64];
+    for (u32 i = 0; i < sys->param_count; i ++)
+    {
+        const char name = sys->params[i];
+        const double v = values[(u8)name];
+        rect_t rect = slider_rect(prompt_rect, i);
+        string_t str = {buf, (u32)snprintf(buf, sizeof(buf), "%c = %.4g", name, v)};
+        i32 knob = rect.x + (i32)((fmin(SLIDER_MAX, fmax(SLIDER_MIN, v)) - SLIDER_MIN) / (SLIDER_MAX - SLIDER_MIN) * rect.w);
+        sdraw_text(graphics, prompt_rect->x, rect.y, &str, WHITE);
+        sfill_rect(graphics, rect.x, rect.y + rect.h / 2 - 1, rect.w, 3, GREY);
+        sfill_rect(graphics, knob - 4, rect.y + 2, 9, rect.h - 4, (i32)i == active ? YELLOW : WHITE);
+    }
+}
+
+static int open_trajectory(traj_reader_t *reader, const char *file_name, char *status_buffer, u32 *status_color)
+{
+    char error[MAX_LENGTH];
+    traj_reader_t next;
+    if (!traj_open_reader(&next, file_name, error, MAX_LENGTH))
+    {
+        *status_color = RED;
+        return snprintf(status_buffer, MAX_LENGTH, "%s", error);
+    }
+    if (reader->header)
+        traj_close_reader(reader);
+    *reader = next;
+    *status_color = WHITE;
+    return snprintf(status_buffer, MAX_LENGTH, "%s: dy/dx = %.*s, %s, %llu points", file_name,
+            (int)reader->header->expr_length, reader->expr, reader->header->method, (unsigned long long)reader->header->point_count);
+}
+
+// reduces the visible part of a trajectory file to a min/max pair per screen
+// column, blocks narrower than a column are drawn from the index alone so
+// their pages are never touched
+static void draw_trajectory(graphics_t *graphics, world_t *world, const traj_reader_t *reader, float left, float right, vec2f *pts, u32 color)
+{
+    const traj_header_t *hd = reader->header;
+    u32 count = 0;
+    i64 column = INT64_MIN;
+    float lo = 0, hi = 0;
+
+#define FLUSH_COLUMN() do { \
+        if (column != INT64_MIN && count + 2 <= 2 * TRAJ_MAX_COLUMNS) { \
+            float cx = (column + 0.5f) / world->scale + world->offset.x; \
+            pts[count ++] = (vec2f){cx, -lo}; \
+            pts[count ++] = (vec2f){cx, -hi}; \
+        } } while (0)
+#define ADD_SAMPLE(X, YLO, YHI) do { \
+        i64 c = (i64)floor(((X) - world->offset.x) * world->scale); \
+        if (c != column) { FLUSH_COLUMN(); column = c; lo = (YLO); hi = (YHI); } \
+        else { lo = lo < (YLO) ? lo : (YLO); hi = hi > (YHI) ? hi : (YHI); } \
+    } while (0)
+
+    for (u64 b = traj_find_block(reader, left); b < hd->block_count && reader->index[b].x_min <= right; b ++)
+    {
+        const traj_index_t *block = &reader->index[b];
+        double span = (block->x_max - block->x_min) * world->scale;
+        if (span < 1)
+        {
+            ADD_SAMPLE(block->x_min, block->y_min, block->y_max);
+            continue;
+        }
+
+        const double *x = traj_block_x(reader, b);
+        const double *y = traj_block_y(reader, b, 0);
+        // runs of about a quarter column go in as their min/max, so spikes
+        // between the run starts still reach the column
+        u32 stride = (u32)(block->count / (4 * span)) + 1;
+        for (u32 i = 0; i < block->count; i += stride)
+        {
+            const u32 end = block->count - i < stride ? block->count : i + stride;
+            float run_lo = INFINITY, run_hi = -INFINITY;
+            for (u32 j = i; j < end; j ++)
+            {
+                run_lo = y[j] < run_lo ? (float)y[j] : run_lo;
+                run_hi = y[j] > run_hi ? (float)y[j] : run_hi;
+            }
+            if (run_lo <= run_hi)
+                ADD_SAMPLE(x[i], run_lo, run_hi);
+        }
+    }
+    FLUSH_COLUMN();
+#undef ADD_SAMPLE
+#undef FLUSH_COLUMN
+
+    draw_lines(graphics, world, pts, count, color);
+}
+
+// log-log work-precision panel in the lower left corner, error at x1 against
+// f evaluations, one polyline per benchmarked method with its fitted order
+static void draw_bench(graphics_t *graphics, const vec2i *geometry, const bench_t *bench, const u32 *colors)
+{
+    const i32 w = 420, h = 300, pad = 40;
+    const i32 left = 20, top = geometry->y - h - 20;
+    const i32 px = left + pad, py = top + 10, pw = w - pad - 10, ph = h - pad - 10;
+    double lo_e = INFINITY, hi_e = -INFINITY, lo_n = INFINITY, hi_n = -INFINITY;
+    char buf[64];
+
+    for (u32 i = 0; i < bench->method_count * bench->levels; i ++)
+    {
+        const bench_point_t *pt = &bench->points[i];
+        if (!(pt->error > 0) || !isfinite(pt->error)) continue;
+        lo_e = fmin(lo_e, floor(log10(pt->error)));
+        hi_e = fmax(hi_e, ceil(log10(pt->error)));
+        lo_n = fmin(lo_n, floor(log10((double)pt->evals)));
+        hi_n = fmax(hi_n, ceil(log10((double)pt->evals)));
+    }
+    if (lo_e >= hi_e) hi_e = lo_e + 1;
+    if (lo_n >= hi_n) hi_n = lo_n + 1;
+
+    SDL_SetRenderDrawBlendMode(graphics->renderer, SDL_BLENDMODE_BLEND);
+    sfill_rect(graphics, left, top, w, h, 0xe0282828);
+    SDL_SetRenderDrawBlendMode(graphics->renderer, SDL_BLENDMODE_NONE);
+    sdraw_rect(graphics, px, py, pw, ph, GREY);
+
+    for (double d = lo_n; d <= hi_n; d ++)
+    {
+        i32 x = px + (i32)((d - lo_n) / (hi_n - lo_n) * pw);
+        string_t str = {buf, (u32)snprintf(buf, sizeof(buf), "1e%d", (int)d)};
+        sdraw_line(graphics, x, py + ph, x, py + ph + 4, GREY);
+        sdraw_text(graphics, x - 10, py + ph + 6, &str, GREY);
+    }
+    for (double d = lo_e; d <= hi_e; d += fmax(1, floor((hi_e - lo_e) / 6)))
+    {
+        i32 y = py + ph - (i32)((d - lo_e) / (hi_e - lo_e) * ph);
+        string_t str = {buf, (u32)snprintf(buf, sizeof(buf), "1e%d", (int)d)};
+        sdraw_line(graphics, px - 4, y, px, y, GREY);
+        sdraw_text(graphics, left + 2, y - 8, &str, GREY);
+    }
+
+    for (u32 m = 0; m < bench->method_count; m ++)
+    {
+        i32 last_x = 0, last_y = 0;
+        int have_last = 0;
+        for (u32 l = 0; l < bench->levels; l ++)
+        {
+            const bench_point_t *pt = bench_point(bench, m, l);
+            if (!(pt->error > 0) || !isfinite(pt->error)) { have_last = 0; continue; }
+            i32 x = px + (i32)((log10((double)pt->evals) - lo_n) / (hi_n - lo_n) * pw);
+            i32 y = py + ph - (i32)((log10(pt->error) - lo_e) / (hi_e - lo_e) * ph);
+            if (have_last)
+                sdraw_line(graphics, last_x, last_y, x, y, colors[m]);
+            last_x = x;
+            last_y = y;
+            have_last = 1;
+        }
+        string_t str = {buf, (u32)snprintf(buf, sizeof(buf), "%s %.2f", bench->methods[m].name, bench->eoc[m])};
+        rect_t rect = get_text_rect(graphics, &str);
+        sdraw_text(graphics, px + pw - rect.w - 4, py + 4 + rect.h * m, &str, colors[m]);
+    }
+}
+
+// paths of the noisy prompt reduced to quantile bands, like the ensemble
+// this takes scalar equations of x and y only
+static int run_bands(sde_t *sde, pool_t *pool, const system_t *sys, const mexp_tree_t *noise, u32 scheme,
+                     double x0, double h, double y0, double *bands, char *status_buffer, u32 *status_length, u32 *status_color)
+{
+    *status_color = RED;
+    if (sys->dim != 1 || sys->param_count)
+    {
+        *status_length = snprintf(status_buffer, MAX_LENGTH, "noise needs a scalar equation of x and y");
+        return 0;
+    }
+    if (!run_sde(sde, pool, &sys->trees[0], noise, scheme, x0, h, y0, 1) ||
+        !sde_quantiles(sde, pool, band_quantiles, SDE_BAND_COUNT, bands))
+    {
+        *status_length = snprintf(status_buffer, MAX_LENGTH, "sde run failed");
+        return 0;
+    }
+    *status_color = WHITE;
+    *status_length = snprintf(status_buffer, MAX_LENGTH, "%s: %u paths x %u steps in %.3fs, %.3g path-steps/s",
+            sde_scheme_name(scheme), sde->count, sde->steps - 1, sde->seconds, sde->rate);
+    return 1;
+}
+
+// rk4 curve with a band of one standard deviation around every component,
+// taken to first order from the sensitivities when y0 and each parameter
+// are off by SPREAD_SIGMA independently
+typedef struct spread_t
+{
+    double *y;     // ODE_MAX_DIM per point
+    double *sigma;
+    u32 dim;
+    size_t count, cap;
+} spread_t;
+
+static int spread_point(void *user, double x, const double *y, const double *s, u32 dim, u32 count)
+{
+    spread_t *sp = (spread_t *)user;
+    (void)x;
+    if (sp->count >= sp->cap)
+        return 0;
+    for (u32 c = 0; c < dim; c ++)
+    {
+        double v = 0;
+        for (u32 d = 0; d < count; d ++)
+            v += s[c * count + d] * s[c * count + d];
+        sp->y[sp->count * ODE_MAX_DIM + c] = y[c];
+        sp->sigma[sp->count * ODE_MAX_DIM + c] = SPREAD_SIGMA * sqrt(v);
+    }
+    sp->count ++;
+    return 1;
+}
+
+static int run_spread(spread_t *sp, system_t *sys, const double *param_values, double x0, double h, const double *y0)
+{
+    u32 slots[SENS_MAX_DIRECTIONS], count = 0;
+    solve_params_t params;
+    sens_t sens;
+    ode_t ode;
+
+    for (u32 i = 0; i < sys->dim; i ++)
+        slots[count ++] = 1 + i;
+    for (u32 p = 0; p < sys->param_count; p ++)
+        slots[count ++] = system_param_slot(sys, p);
+    init_ode(&ode, &sys->prog);
+    system_bind(sys, &ode, param_values);
+    if (!init_sens(&sens, &ode, slots, count))
+        return 0;
+    curve_params(&params, x0, y0, sys->dim, h, sp->cap);
+    sp->dim = sys->dim;
+    sp->count = 0;
+    int ok = run_sens(&sens, rk_find_method("rk4")->tableau, &ode, &params, spread_point, sp, NULL);
+    destroy_sens(&sens);
+    return ok;
+}
+
+static const char *const lte_method_names[] = {"euler", "rk2", "rk4"};
+
+// keeps the local error map on the view, fills in what fits the frame and
+// uploads the new tiles. restart drops the whole map, repaint the colours
+static void update_lte(lte_map_t *map, pool_t *pool, SDL_Texture *texture, u32 *pixels, const world_t *world, const vec2i *geometry,
+                       double h, u32 method, int restart, int repaint)
+{
+    const double pixel = 1 / world->scale;
+    const double left = world->offset.x + 0.5 * pixel, top = world->offset.y + 0.5 * pixel;
+    if (restart || map->w != (u32)geometry->x || map->h != (u32)geometry->y ||
+        map->left != left || map->top != top || map->pixel != pixel || map->step != h)
+    {
+        if (!lte_reset(map, geometry->x, geometry->y, left, top, pixel, h))
+            return;
+        memset(pixels, 0, (size_t)geometry->x * geometry->y * sizeof(u32));
+        SDL_UpdateTexture(texture, NULL, pixels, geometry->x * sizeof(u32));
+    }
+    else if (repaint)
+    {
+        for (u32 i = 0; i < map->next; i ++)
+            lte_paint(map, method, map->order[i], pixels, LTE_ALPHA);
+        SDL_UpdateTexture(texture, NULL, pixels, geometry->x * sizeof(u32));
+    }
+
+    u32 count = lte_advance(map, pool, LTE_FRAME_SECONDS);
+    for (u32 i = map->next - count; i < map->next; i ++)
+    {
+        rect_t r;
+        lte_tile_rect(map, map->order[i], &r);
+        lte_paint(map, method, map->order[i], pixels, LTE_ALPHA);
+        SDL_Rect rect = {r.x, r.y, r.w, r.h};
+        SDL_UpdateTexture(texture, &rect, pixels + (size_t)r.y * geometry->x + r.x, geometry->x * sizeof(u32));
+    }
+}
+
+static const char *const sweep_field_names[SWEEP_FIELD_COUNT] = {"final y", "max |y|", "end x", "events"};
 
-static mexp_tree_t *expr;
-static double f(double x, double y)
+static int open_sweep(sweep_reader_t *reader, const char *file_name, char *status_buffer, u32 *status_color)
 {
-    double v[2] = {x, y};
-    return mexp_eval_tree(expr, v);
+    char error[MAX_LENGTH];
+    sweep_reader_t next;
+    if (!sweep_open_reader(&next, file_name, error, MAX_LENGTH))
+    {
+        *status_color = RED;
+        return snprintf(status_buffer, MAX_LENGTH, "%s", error);
+    }
+    if (reader->header)
+        sweep_close_reader(reader);
+    *reader = next;
+    *status_color = WHITE;
+    return 0;
 }
 
-double euler(double x0, double y0, double h)
+// one texel per run coloured by one of its summaries, max |y| on a log
+// scale, the first axis growing to the right and the second upward
+static SDL_Texture *paint_sweep(SDL_Renderer *renderer, const sweep_reader_t *reader, u32 field, double *lo, double *hi)
 {
-    return y0 + h * f(x0, y0);
+    const sweep_header_t *hd = reader->header;
+    const u32 n0 = hd->axes[0].count, n1 = hd->axes[1].count;
+    const int flip0 = hd->axes[0].hi < hd->axes[0].lo, flip1 = hd->axes[1].hi < hd->axes[1].lo;
+    u32 *pixels = (u32 *)malloc((size_t)n0 * n1 * sizeof(u32));
+    if (!pixels)
+        return NULL;
+
+    *lo = INFINITY;
+    *hi = -INFINITY;
+    for (size_t k = 0; k < (size_t)n0 * n1; k ++)
+    {
+        const sweep_record_t *r = &reader->records[k];
+        double v = field == SWEEP_MAX_ABS ? log10(r->max_abs) : sweep_field(r, field);
+        if (r->flags & SWEEP_FAILED || !isfinite(v))
+            continue;
+        *lo = fmin(*lo, v);
+        *hi = fmax(*hi, v);
+    }
+    for (u32 row = 0; row < n1; row ++)
+    {
+        const u32 j = flip1 ? row : n1 - 1 - row;
+        for (u32 col = 0; col < n0; col ++)
+        {
+            const sweep_record_t *r = &reader->records[(size_t)j * n0 + (flip0 ? n0 - 1 - col : col)];
+            double v = field == SWEEP_MAX_ABS ? log10(r->max_abs) : sweep_field(r, field);
+            u32 c = 0;
+            if (!(r->flags & SWEEP_FAILED) && isfinite(v))
+                c = lte_ramp(*hi > *lo ? (float)((v - *lo) / (*hi - *lo)) : 0.5f, SWEEP_ALPHA);
+            pixels[(size_t)row * n0 + col] = c;
+        }
+    }
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, n0, n1);
+    if (texture)
+    {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_UpdateTexture(texture, NULL, pixels, n0 * sizeof(u32));
+    }
+    free(pixels);
+    return texture;
 }
 
-double rk2(double x0, double y0, double h)
+// the runs as cells centred on their grid points in the (first axis,
+// second axis) plane, a lone row or column takes the other axis' spacing
+static void draw_sweep(SDL_Renderer *renderer, const world_t *world, const sweep_reader_t *reader, SDL_Texture *texture)
 {
-    double k1 = h * f(x0, y0);
-    double k2 = h * f(x0 + h, y0 + k1);
-    double k  = (k1 + k2) / 2;
-    return y0 + k;
+    const sweep_axis_t *a = reader->header->axes;
+    double cell[2], lo[2], hi[2];
+    for (u32 k = 0; k < 2; k ++)
+        cell[k] = a[k].count > 1 ? fabs(a[k].hi - a[k].lo) / (a[k].count - 1) : 0;
+    for (u32 k = 0; k < 2; k ++)
+    {
+        if (cell[k] == 0)
+            cell[k] = cell[1 - k] > 0 ? cell[1 - k] : 1;
+        lo[k] = fmin(a[k].lo, a[k].hi) - 0.5 * cell[k];
+        hi[k] = fmax(a[k].lo, a[k].hi) + 0.5 * cell[k];
+    }
+    float left, top, right, bottom;
+    world_to_screenf(world, (float)lo[0], (float)-hi[1], &left, &top);
+    world_to_screenf(world, (float)hi[0], (float)-lo[1], &right, &bottom);
+    SDL_Rect rect = {(int)left, (int)top, (int)(right - left) + 1, (int)(bottom - top) + 1};
+    SDL_RenderCopy(renderer, texture, NULL, &rect);
 }
 
-double rk4(double x0, double y0, double h)
+// shows field of the open sweep, or hides the map past the last one
+static int show_sweep(SDL_Renderer *renderer, const sweep_reader_t *reader, SDL_Texture **texture, u32 shown, char *status_buffer, u32 *status_color)
 {
-    double k1 = h * f(x0, y0);
-    double k2 = h * f(x0 + h / 2, y0 + k1 / 2);
-    double k3 = h * f(x0 + h / 2, y0 + k2 / 2);
-    double k4 = h * f(x0 + h, y0 + k3);
-    double k  = (k1 + 2 * k2 + 2 * k3 + k4) / 6;
-    return y0 + k;
+    const sweep_header_t *hd = reader->header;
+    double lo, hi;
+    if (*texture)
+        SDL_DestroyTexture(*texture);
+    *texture = NULL;
+    *status_color = WHITE;
+    if (!shown)
+        return snprintf(status_buffer, MAX_LENGTH, "sweep map off");
+    *texture = paint_sweep(renderer, reader, shown - 1, &lo, &hi);
+    if (!*texture)
+    {
+        *status_color = RED;
+        return snprintf(status_buffer, MAX_LENGTH, "could not show the sweep");
+    }
+    return snprintf(status_buffer, MAX_LENGTH, "%.*s by %s, %s over %s x %s (%u x %u runs), %s%s from %g (blue) to %g (red)",
+            (int)hd->expr_length, reader->expr, hd->method, sweep_field_names[shown - 1], hd->axes[0].name, hd->axes[1].count > 1 ? hd->axes[1].name : "-",
+            hd->axes[0].count, hd->axes[1].count, shown - 1 == SWEEP_MAX_ABS ? "log10 " : "", sweep_field_names[shown - 1], lo, hi);
 }
 
-int main()
+int main(int argc, char **argv)
 {
     const double h = 0.01;
-    const double x0 = 0, y0 = 1, x1 = 10;
+    const double x0 = 0, x1 = 10;
+    // the first component starts at 1, derivatives and other components at 0
+    const double y0[ODE_MAX_DIM] = {1};
     const size_t pt_count = (size_t)((x1 - x0) / h);
 
     vec2i geometry = {DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT};
@@ -77,19 +838,75 @@ int main()
     static const string_t prompt = {"dy/dx = ", 8};
     rect_t prompt_rect;
 
+    char status_buffer[MAX_LENGTH];
+    string_t status = {status_buffer, 0};
+    u32 status_color = WHITE;
+
     mexp_parser_t parser;
-    mexp_tree_t tree;
+    system_t sys;
+    ode_t ode;
+    event_monitor_t monitor;
+    char plot_text[MAX_LENGTH + 1];
+    u32 plot_text_length = 0;
+
+    // parameter values by letter, kept across expressions
+    double param_values[128];
+    int dragging = -1;
+    static scrub_t scrub;
+    scrub_job_t job;
+    u32 scrub_seen = 0;
+    slicer_t slicer = {MAX_PLOTS};
+    int use_slicer = 0;
+    double render_seconds = 0;
 
-    // apparently const is not constant expression
-    // why windows why ;-;
-    // vec2d eul_pts[pt_count], rk2_pts[pt_count], rk4_pts[pt_count];
+    plot_t plots[MAX_PLOTS];
+    u32 plot_count = 0;
+    rk_tableau_t custom_tableaus[MAX_CUSTOM_METHODS];
+    rk_method_t custom_methods[MAX_CUSTOM_METHODS];
+    u32 custom_count = 0;
 
-    vec2d* eul_pts = calloc(pt_count, sizeof(vec2d));
-    vec2d* rk2_pts = calloc(pt_count, sizeof(vec2d));
-    vec2d* rk4_pts = calloc(pt_count, sizeof(vec2d));
+    pool_t pool;
+    ensemble_t ensemble;
+    double *ensemble_y0 = calloc(ENSEMBLE_COUNT, sizeof(double));
+    vec2f  *ensemble_pts = calloc(pt_count, sizeof(vec2f));
+
+    traj_reader_t trajectory = {0};
+    vec2f *traj_pts = calloc(2 * TRAJ_MAX_COLUMNS, sizeof(vec2f));
 
     int run = 0;
     int draw_plot = 0;
+    int integrate = 0;
+    int use_ensemble = 0;
+    int draw_ensemble = 0;
+    int draw_phase = 0;
+
+    sde_t sde;
+    mexp_tree_t noise;
+    double *sde_bands = calloc(pt_count * SDE_BAND_COUNT, sizeof(double));
+    u32 sde_scheme = SDE_EULER_MARUYAMA;
+    int noisy = 0;
+    int draw_bands = 0;
+
+    spread_t spread = {calloc(pt_count * ODE_MAX_DIM, sizeof(double)), calloc(pt_count * ODE_MAX_DIM, sizeof(double)), 0, 0, pt_count};
+    int use_spread = 0;
+    int draw_spread = 0;
+
+    lte_map_t lte;
+    u32 *lte_pixels = calloc((size_t)geometry.x * geometry.y, sizeof(u32));
+    SDL_Texture *lte_texture;
+    u32 lte_method = 0; // 1 + the shown method, 0 for none
+    int lte_restart = 0, lte_repaint = 0;
+
+    sweep_reader_t sweep_map = {0};
+    SDL_Texture *sweep_texture = NULL;
+    u32 sweep_shown = 0; // 1 + the shown summary, 0 for none
+
+    diverge_t diverge;
+    const char *file_name = NULL;
+
+    bench_t bench = {0};
+    u32 bench_colors[MAX_PLOTS];
+    int draw_bench_panel = 0;
 
     struct { float top, bottom, left, right; } world_bounds;
 
@@ -97,6 +914,19 @@ int main()
     SetProcessDPIAware();
 #endif
 
+    // [-limit v] [-growth r] [file.traj | file.sweep]
+    init_diverge(&diverge);
+    diverge.limit = DIVERGE_LIMIT;
+    for (int i = 1; i < argc; i ++)
+    {
+        if (!strcmp(argv[i], "-limit") && i + 1 < argc)
+            diverge.limit = atof(argv[++ i]);
+        else if (!strcmp(argv[i], "-growth") && i + 1 < argc)
+            diverge.growth = atof(argv[++ i]);
+        else
+            file_name = argv[i];
+    }
+
     if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_EVENTS))
         return 1;
 
@@ -104,10 +934,35 @@ int main()
     if (!window) return 1;
     if (!init_graphics(window, &graphics) || !init_events(&events)) return 1;
     if (!mexp_init_parser(&parser)) return 1;
-    if (!mexp_init_tree(&tree)) return 1;
+    if (!init_system(&sys)) return 1;
+    init_event_monitor(&monitor);
+    if (!init_pool(&pool, 0)) return 1;
+    if (!init_ensemble(&ensemble, ENSEMBLE_COUNT, pt_count)) return 1;
+    if (!init_scrub(&scrub)) return 1;
+    if (!init_sde(&sde, SDE_PATHS, pt_count) || !mexp_init_tree(&noise)) return 1;
+    for (u32 i = 0; i < 128; i ++)
+        param_values[i] = SYSTEM_PARAM_DEFAULT;
+    if (!ensemble_y0 || !ensemble_pts || !traj_pts || !sde_bands || !spread.y || !spread.sigma || !lte_pixels) return 1;
+    {
+        const rk_tableau_t *methods[3];
+        for (u32 i = 0; i < 3; i ++)
+            methods[i] = rk_find_method(lte_method_names[i])->tableau;
+        if (!init_lte_map(&lte, &pool, methods, 3)) return 1;
+    }
 
-    mexp_add_variable(&parser, 'x');
-    mexp_add_variable(&parser, 'y');
+    for (u32 i = 0; i < solver_builtin_count(); i ++)
+    {
+        solver_t solver;
+        solver_builtin(i, &solver);
+        if (!add_plot(plots, &plot_count, &solver)) return 1;
+    }
+    for (u32 i = 0; i < plot_count; i ++)
+    {
+        const char *name = plots[i].solver.name;
+        if (!strcmp(name, "EULER")) { plots[i].enabled = 1; plots[i].color = eul_color; }
+        if (!strcmp(name, "RK2"))   { plots[i].enabled = 1; plots[i].color = rk2_color; }
+        if (!strcmp(name, "RK4"))   { plots[i].enabled = 1; plots[i].color = rk4_color; }
+    }
 
     renderer = graphics.renderer;
     SDL_RenderSetLogicalSize(renderer, geometry.x, geometry.y);
@@ -120,6 +975,10 @@ int main()
     SDL_SetTextureBlendMode(static_texture, SDL_BLENDMODE_BLEND);
     if (!static_texture) {return 1;}
 
+    lte_texture = SDL_CreateTexture(graphics.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, geometry.x, geometry.y);
+    SDL_SetTextureBlendMode(lte_texture, SDL_BLENDMODE_BLEND);
+    if (!lte_texture) {return 1;}
+
     prompt_rect = get_text_rect(&graphics, &prompt);
     prompt_rect.x = 20;
     prompt_rect.y = 20;
@@ -140,7 +999,20 @@ int main()
     input_dst_rect.w = input_src_rect.w;
     input_dst_rect.h = input_src_rect.h;
 
-    redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect);
+    if (file_name)
+    {
+        size_t name_length = strlen(file_name);
+        if (name_length > 6 && !strcmp(file_name + name_length - 6, ".sweep"))
+        {
+            status.length = open_sweep(&sweep_map, file_name, status_buffer, &status_color);
+            if (sweep_map.header)
+                status.length = show_sweep(renderer, &sweep_map, &sweep_texture, sweep_shown = 1, status_buffer, &status_color);
+        }
+        else
+            status.length = open_trajectory(&trajectory, file_name, status_buffer, &status_color);
+    }
+
+    redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
     screen_to_worldf(&world, 0, 0, &world_bounds.left, &world_bounds.top);
     screen_to_worldf(&world, geometry.x, geometry.y, &world_bounds.right, &world_bounds.bottom);
 
@@ -148,6 +1020,8 @@ int main()
     while (run)
     {
         u32 begin = SDL_GetTicks();
+        const double freq = (double)SDL_GetPerformanceFrequency();
+        const u64 frame_begin = SDL_GetPerformanceCounter();
         int render_text = 0;
         advance_events(&events);
         while (SDL_PollEvent(&event))
@@ -176,13 +1050,104 @@ int main()
                 if (!static_texture) {return 1;}
                 static_tex_rect.w = geometry.x;
                 static_tex_rect.h = geometry.y;
-                redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect);
+                SDL_DestroyTexture(lte_texture);
+                lte_texture = SDL_CreateTexture(graphics.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, geometry.x, geometry.y);
+                SDL_SetTextureBlendMode(lte_texture, SDL_BLENDMODE_BLEND);
+                free(lte_pixels);
+                lte_pixels = calloc((size_t)geometry.x * geometry.y, sizeof(u32));
+                if (!lte_texture || !lte_pixels) {return 1;}
+                lte_restart = 1;
+                redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
                 screen_to_worldf(&world, 0, 0, &world_bounds.left, &world_bounds.top);
                 screen_to_worldf(&world, geometry.x, geometry.y, &world_bounds.right, &world_bounds.bottom);
             }
+            if (event.type == SDL_DROPFILE)
+            {
+                // dropped files are trajectories, sweeps or butcher tableaus
+                char error[MAX_LENGTH];
+                rk_tableau_t *tableau = custom_count < MAX_CUSTOM_METHODS ? &custom_tableaus[custom_count] : NULL;
+                size_t name_length = strlen(event.drop.file);
+                if (name_length > 5 && !strcmp(event.drop.file + name_length - 5, ".traj"))
+                    status.length = open_trajectory(&trajectory, event.drop.file, status_buffer, &status_color);
+                else if (name_length > 6 && !strcmp(event.drop.file + name_length - 6, ".sweep"))
+                {
+                    status.length = open_sweep(&sweep_map, event.drop.file, status_buffer, &status_color);
+                    if (status_color != RED)
+                        status.length = show_sweep(renderer, &sweep_map, &sweep_texture, sweep_shown = 1, status_buffer, &status_color);
+                }
+                else if (!tableau || plot_count >= MAX_PLOTS)
+                {
+                    status_color = RED;
+                    status.length = snprintf(status_buffer, MAX_LENGTH, "too many methods");
+                }
+                else if (!rk_load_tableau(tableau, event.drop.file, error, MAX_LENGTH))
+                {
+                    status_color = RED;
+                    status.length = snprintf(status_buffer, MAX_LENGTH, "%s", error);
+                }
+                else
+                {
+                    custom_methods[custom_count].tableau = tableau;
+                    custom_methods[custom_count].kernel  = rk_step_generic;
+                    solver_t solver;
+                    init_rk_solver(&solver, &custom_methods[custom_count]);
+                    if (add_plot(plots, &plot_count, &solver))
+                    {
+                        plots[plot_count - 1].enabled = 1;
+                        custom_count ++;
+                        integrate = draw_plot;
+                    }
+                    status_color = WHITE;
+                    status.length = snprintf(status_buffer, MAX_LENGTH, "loaded %s (%u stages, order %u)",
+                            tableau->name, tableau->stages, tableau->order);
+                }
+                SDL_free(event.drop.file);
+                redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+            }
+        }
+
+        // a slider grabbed with the left button follows the cursor until release
+        if (btn_pressed(&events, BTN_LEFT) && draw_plot)
+        {
+            for (u32 i = 0; i < sys.param_count; i ++)
+            {
+                rect_t rect = slider_rect(&prompt_rect, i);
+                rect.x -= 6;
+                rect.w += 12;
+                if (point_in_rect(events.cursor_screen, &rect))
+                    dragging = (int)i;
+            }
+        }
+        if (dragging >= 0 && !events.cbtns[BTN_LEFT])
+            dragging = -1;
+        if (dragging >= 0)
+        {
+            rect_t rect = slider_rect(&prompt_rect, (u32)dragging);
+            double t = (double)(events.cursor_screen.x - rect.x) / rect.w;
+            double v = SLIDER_MIN + fmin(1, fmax(0, t)) * (SLIDER_MAX - SLIDER_MIN);
+            double *value = &param_values[(u8)sys.params[dragging]];
+            if (v != *value)
+            {
+                *value = v;
+                integrate = 1;
+            }
+        }
+
+        if (btn_pressed(&events, BTN_LEFT) && dragging < 0)
+        {
+            for (u32 i = 0; i < plot_count; i ++)
+            {
+                rect_t rect = legend_rect(&graphics, &geometry, plots, i);
+                if (point_in_rect(events.cursor_screen, &rect))
+                {
+                    plots[i].enabled = !plots[i].enabled;
+                    integrate = draw_plot && plots[i].enabled;
+                    redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+                }
+            }
         }
 
-        if (handle_zoom_and_pan(&world, &events))
+        if (dragging < 0 && handle_zoom_and_pan(&world, &events))
         {
             screen_to_worldf(&world, 0, 0, &world_bounds.left, &world_bounds.top);
             screen_to_worldf(&world, geometry.x, geometry.y, &world_bounds.right, &world_bounds.bottom);
@@ -197,40 +1162,192 @@ int main()
             screen_to_worldf(&world, geometry.x, geometry.y, &world_bounds.right, &world_bounds.bottom);
         }
 
+        if (key_pressed(&events, SDL_SCANCODE_E) && (events.mods & MOD_CTRL))
+            use_ensemble = !use_ensemble;
+
+        // ctrl+t integrates in time slices on this thread instead of the worker
+        if (key_pressed(&events, SDL_SCANCODE_T) && (events.mods & MOD_CTRL))
+        {
+            use_slicer = !use_slicer;
+            slicer.plot = MAX_PLOTS;
+            integrate = draw_plot;
+            status_color = WHITE;
+            status.length = snprintf(status_buffer, MAX_LENGTH, "%s integration", use_slicer ? "time-sliced" : "background");
+            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+        }
+
+        // ctrl+m switches the noise between euler-maruyama and milstein
+        if (key_pressed(&events, SDL_SCANCODE_M) && (events.mods & MOD_CTRL))
+        {
+            sde_scheme = (sde_scheme + 1) % SDE_SCHEME_COUNT;
+            if (draw_plot && noisy)
+            {
+                draw_bands = run_bands(&sde, &pool, &sys, &noise, sde_scheme, x0, h, y0[0], sde_bands, status_buffer, &status.length, &status_color);
+                redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+            }
+        }
+
+        // ctrl+u bands the rk4 curve by its first order uncertainty
+        if (key_pressed(&events, SDL_SCANCODE_U) && (events.mods & MOD_CTRL))
+        {
+            use_spread = !use_spread;
+            draw_spread = use_spread && draw_plot && run_spread(&spread, &sys, param_values, x0, h, y0);
+            status_color = use_spread && draw_plot && !draw_spread ? RED : WHITE;
+            if (!use_spread)
+                status.length = snprintf(status_buffer, MAX_LENGTH, "uncertainty off");
+            else if (status_color == RED)
+                status.length = snprintf(status_buffer, MAX_LENGTH, "could not differentiate the expression");
+            else
+                status.length = snprintf(status_buffer, MAX_LENGTH, "uncertainty: y0 and every parameter off by %g", SPREAD_SIGMA);
+            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+        }
+
+        // ctrl+l cycles the local error map through euler, rk2, rk4 and off
+        if (key_pressed(&events, SDL_SCANCODE_L) && (events.mods & MOD_CTRL))
+        {
+            lte_method = (lte_method + 1) % (lte.method_count + 1);
+            lte_repaint = 1;
+            status_color = WHITE;
+            if (!lte_method)
+                status.length = snprintf(status_buffer, MAX_LENGTH, "local error off");
+            else if (!lte.have_tree)
+            {
+                status_color = RED;
+                status.length = snprintf(status_buffer, MAX_LENGTH, "local error needs a scalar dy/dx = f(x, y)");
+            }
+            else
+                status.length = snprintf(status_buffer, MAX_LENGTH, "local error of %s at h = %g, log10 from %g (blue) to %g (red)",
+                        lte_method_names[lte_method - 1], h, LTE_LOG_MIN, LTE_LOG_MAX);
+            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+        }
+
+        // ctrl+g cycles the sweep map through its summaries and off
+        if (key_pressed(&events, SDL_SCANCODE_G) && (events.mods & MOD_CTRL) && sweep_map.header)
+        {
+            sweep_shown = (sweep_shown + 1) % (SWEEP_FIELD_COUNT + 1);
+            status.length = show_sweep(renderer, &sweep_map, &sweep_texture, sweep_shown, status_buffer, &status_color);
+            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+        }
+
+        // ctrl+p swaps the plots over x for the phase portrait of the first two components
+        if (key_pressed(&events, SDL_SCANCODE_P) && (events.mods & MOD_CTRL))
+            draw_phase = !draw_phase;
+
+        // ctrl+b benchmarks the enabled methods on the current expression, again to hide
+        if (key_pressed(&events, SDL_SCANCODE_B) && (events.mods & MOD_CTRL))
+        {
+            if (draw_bench_panel)
+                draw_bench_panel = 0;
+            else if (draw_plot)
+            {
+                solver_t methods[MAX_PLOTS];
+                u32 method_count = 0;
+                for (u32 i = 0; i < plot_count; i ++)
+                {
+                    if (!plots[i].enabled) continue;
+                    bench_colors[method_count] = plots[i].color;
+                    methods[method_count ++] = plots[i].solver;
+                }
+                destroy_bench(&bench);
+                init_ode(&ode, &sys.prog);
+                system_bind(&sys, &ode, param_values);
+                double begin = pf_time();
+                draw_bench_panel = method_count > 0 &&
+                    run_bench(&bench, &pool, &ode, NULL, methods, method_count, x0, y0, x1, (x1 - x0) / 8, 1e-3, BENCH_LEVELS);
+                status_color = draw_bench_panel ? WHITE : RED;
+                status.length = snprintf(status_buffer, MAX_LENGTH, draw_bench_panel ? "benchmark: %u runs in %.3fs" : "benchmark failed",
+                        method_count * BENCH_LEVELS, pf_time() - begin);
+                redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+            }
+        }
+
         if (key_pressed(&events, SDL_SCANCODE_RETURN))
         {
-            draw_plot = mexp_generate_tree(&tree, &parser, input_text.data, input_text.length);
-            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect);
+            // "f | g" plots dy/dx = f and marks where g(x, y) changes sign,
+            // f may also be a system like "y' = z; z' = -y" or "y'' = -y"
+            // and any other lone letter becomes a parameter slider.
+            // "f ~ g" adds quantile bands of dy = f dx + g dW
+            const char *error;
+            draw_plot = parse_prompt(&sys, &parser, &monitor, &noise, &noisy, input_text.data, input_text.length, &error);
+            integrate = draw_plot;
+            dragging = -1;
+            slicer.plot = MAX_PLOTS;
+            status.length = 0;
             if (draw_plot)
             {
-                double x = x0, yeul = y0, yrk2 = y0, yrk4 = y0;
-                expr = &tree;
-                for (int i = 0; i < pt_count; i ++)
+                memcpy(plot_text, input_text.data, input_text.length);
+                plot_text_length = input_text.length;
+
+                // fan the initial conditions over the visible part of the y axis,
+                // the ensemble kernel integrates scalar equations of x and y only
+                draw_ensemble = 0;
+                if (use_ensemble && sys.dim == 1 && sys.param_count == 0)
                 {
-                    eul_pts[i].x = x;
-                    rk2_pts[i].x = x;
-                    rk4_pts[i].x = x;
-                    eul_pts[i].y = -yeul;
-                    rk2_pts[i].y = -yrk2;
-                    rk4_pts[i].y = -yrk4;
-                    yeul = euler(x, yeul, h);
-                    yrk2 = rk2(x, yrk2, h);
-                    yrk4 = rk4(x, yrk4, h);
-                    x += h;
+                    for (int i = 0; i < ENSEMBLE_COUNT; i ++)
+                        ensemble_y0[i] = -(world_bounds.top + (world_bounds.bottom - world_bounds.top) * i / (ENSEMBLE_COUNT - 1));
+                    draw_ensemble = run_ensemble(&ensemble, &pool, &sys.trees[0], &diverge, x0, h, ensemble_y0);
+                    status_color = WHITE;
+                    status.length = snprintf(status_buffer, MAX_LENGTH, "ensemble: %d x %d steps in %.3fs, %.3g steps/s, %u diverged",
+                            ENSEMBLE_COUNT, (int)pt_count, ensemble.seconds, ensemble.rate, ensemble.diverged);
                 }
+                // the error map batches the tree over x and y like the ensemble
+                lte.have_tree = 0;
+                if (sys.dim == 1 && sys.param_count == 0)
+                    lte_set_tree(&lte, &sys.trees[0]);
+                lte_restart = 1;
+                draw_bands = noisy && run_bands(&sde, &pool, &sys, &noise, sde_scheme, x0, h, y0[0], sde_bands, status_buffer, &status.length, &status_color);
             }
             else
             {
-                string_t error;
-                error.data   = mexp_get_error(&parser);
-                error.length = strlen(error.data);
-                SDL_SetRenderTarget(graphics.renderer, static_texture);
-                SDL_SetRenderDrawBlendMode(graphics.renderer, SDL_BLENDMODE_BLEND);
-                sdraw_text(&graphics, prompt_rect.x, prompt_rect.y + prompt_rect.h, &error, RED);
-                SDL_SetRenderDrawBlendMode(graphics.renderer, SDL_BLENDMODE_NONE);
-                SDL_SetRenderTarget(graphics.renderer, NULL);
+                status_color = RED;
+                status.length = snprintf(status_buffer, MAX_LENGTH, "%s", error);
+            }
+            redraw_static_texture(&graphics, static_texture, &geometry, &prompt, &prompt_rect, plots, plot_count, &status, status_color);
+        }
+
+        // the spread is cheap enough to follow the sliders on this thread
+        if (integrate && use_spread)
+            draw_spread = run_spread(&spread, &sys, param_values, x0, h, y0);
+
+        // the worker picks up the newest job, older ones are dropped or cancelled
+        if (integrate && use_slicer)
+        {
+            start_slicer(&slicer, plots, plot_count, &sys, param_values, &monitor, &diverge, x0, y0, h, pt_count);
+            integrate = 0;
+        }
+        if (integrate)
+        {
+            memcpy(job.text, plot_text, plot_text_length);
+            job.length = plot_text_length;
+            memcpy(job.param_values, param_values, sizeof(param_values));
+            job.plot_count = plot_count;
+            for (u32 i = 0; i < plot_count; i ++)
+            {
+                job.solvers[i] = plots[i].solver;
+                job.enabled[i] = plots[i].enabled;
             }
+            job.x0 = x0;
+            job.h = h;
+            memcpy(job.y0, y0, sizeof(y0));
+            job.pt_count = pt_count;
+            job.diverge = diverge;
+            post_task(&scrub.task, &job);
+            integrate = 0;
+        }
+        if (use_slicer)
+        {
+            // whatever the frame has left after the input, minus what drawing took last time
+            double spent = (SDL_GetPerformanceCounter() - frame_begin) / freq;
+            run_slicer(&slicer, plots, plot_count, &monitor, FRAME_SECONDS - spent - render_seconds);
+        }
+        else
+            take_scrub(&scrub, plots, plot_count, &scrub_seen);
+        if (draw_plot && lte_method && lte.have_tree && !draw_phase)
+        {
+            update_lte(&lte, &pool, lte_texture, lte_pixels, &world, &geometry, h, lte_method - 1, lte_restart, lte_repaint);
+            lte_restart = lte_repaint = 0;
         }
+        const u64 render_begin = SDL_GetPerformanceCounter();
 
         if (key_pressed(&events, SDL_SCANCODE_BACKSPACE))
         {
@@ -253,22 +1370,115 @@ int main()
         SDL_SetRenderDrawColor(renderer, 0x28, 0x28, 0x28, 0);
         SDL_RenderClear(renderer);
 
+        if (draw_plot && lte_method && lte.have_tree && !draw_phase)
+            SDL_RenderCopy(renderer, lte_texture, NULL, NULL);
+        if (sweep_texture && !draw_phase)
+            draw_sweep(renderer, &world, &sweep_map, sweep_texture);
+
         draw_line(&graphics, &world, world_bounds.left, 0, world_bounds.right, 0, WHITE);
         draw_line(&graphics, &world, 0, world_bounds.top, 0, world_bounds.bottom, WHITE);
 
+        if (trajectory.header)
+            draw_trajectory(&graphics, &world, &trajectory, world_bounds.left, world_bounds.right, traj_pts, traj_color);
+
+        if (draw_plot && draw_ensemble && !draw_phase)
+        {
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            for (int t = 0; t < ENSEMBLE_COUNT; t += ENSEMBLE_DRAW_STRIDE)
+            {
+                const u32 alive = ensemble.alive[t];
+                for (u32 i = 0; i < alive; i ++)
+                {
+                    ensemble_pts[i].x = ensemble.x0 + i * ensemble.h;
+                    ensemble_pts[i].y = -ensemble_row(&ensemble, i)[t];
+                }
+                draw_lines(&graphics, &world, ensemble_pts, alive, ensemble_color);
+            }
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        }
+
+        // the deterministic curves go on top of the bands
+        if (draw_plot && draw_bands && !draw_phase)
+        {
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            for (u32 k = 0; k < SDE_BAND_COUNT; k ++)
+            {
+                for (int i = 0; i < pt_count; i ++)
+                {
+                    ensemble_pts[i].x = sde.x0 + i * sde.h;
+                    ensemble_pts[i].y = -sde_bands[(size_t)i * SDE_BAND_COUNT + k];
+                }
+                draw_lines(&graphics, &world, ensemble_pts, pt_count, band_colors[k]);
+            }
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        }
+
+        if (draw_plot && draw_spread && !draw_phase)
+        {
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            for (u32 c = 0; c < spread.dim; c ++)
+            {
+                for (int side = -1; side <= 1; side += 2)
+                {
+                    for (size_t i = 0; i < spread.count; i ++)
+                    {
+                        const size_t at = i * ODE_MAX_DIM + c;
+                        ensemble_pts[i].x = x0 + i * h;
+                        ensemble_pts[i].y = -(spread.y[at] + side * spread.sigma[at]);
+                    }
+                    draw_lines(&graphics, &world, ensemble_pts, (u32)spread.count, GREY);
+                }
+            }
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        }
+
         if (draw_plot)
         {
-            for (int i = 1; i < pt_count; i ++)
+            for (u32 p = 0; p < plot_count; p ++)
             {
-                draw_line(&graphics, &world, eul_pts[i - 1].x, eul_pts[i - 1].y, eul_pts[i].x, eul_pts[i].y, eul_color);
-                draw_line(&graphics, &world, rk2_pts[i - 1].x, rk2_pts[i - 1].y, rk2_pts[i].x, rk2_pts[i].y, rk2_color);
-                draw_line(&graphics, &world, rk4_pts[i - 1].x, rk4_pts[i - 1].y, rk4_pts[i].x, rk4_pts[i].y, rk4_color);
+                curve_t *curve = &plots[p].curve;
+                series_t *series = &curve->series;
+                const vec2d *hits = curve->hits;
+                if (!plots[p].enabled || !series_render(series)) continue;
+                if (draw_phase && series->dim > 1)
+                {
+                    draw_lines(&graphics, &world, series_render_phase(series), (u32)series->count, plots[p].color);
+                    hits = curve->phase_hits;
+                }
+                else
+                {
+                    for (u32 c = 0; c < series->dim; c ++)
+                        draw_lines(&graphics, &world, series_render_column(series, c), (u32)series->count, plots[p].color);
+                }
+                for (u32 i = 0; i < curve->hit_count; i ++)
+                {
+                    float sx, sy;
+                    world_to_screenf(&world, hits[i].x, hits[i].y, &sx, &sy);
+                    sdraw_rect(&graphics, (i32)sx - 3, (i32)sy - 3, 7, 7, plots[p].color);
+                }
+                // a diverged curve ends where it was last fine, marked with where it failed
+                if (curve->guard.reason && series->count && !draw_phase)
+                {
+                    char buf[96];
+                    float sx, sy;
+                    const size_t last = series->count - 1;
+                    world_to_screenf(&world, (float)series_x(series, last), (float)-series_y(series, 0)[last], &sx, &sy);
+                    string_t str = {buf, (u32)snprintf(buf, sizeof(buf), "%s: %s at x = %.6g", plots[p].solver.name,
+                                                       diverge_reason(curve->guard.reason), curve->guard.at)};
+                    sdraw_text(&graphics, (i32)sx + 6, (i32)sy - 6, &str, plots[p].color);
+                }
             }
         }
 
+        if (draw_bench_panel)
+            draw_bench(&graphics, &geometry, &bench, bench_colors);
+
         SDL_RenderCopy(renderer, static_texture, &static_tex_rect, &static_tex_rect);
         SDL_RenderCopy(renderer, input_texture , &input_src_rect, &input_dst_rect);
 
+        if (draw_plot)
+            draw_sliders(&graphics, &prompt_rect, &sys, param_values, dragging);
+
         {
             char buf[256];
             int len = snprintf(buf, 256, "%f, %f", events.cursor_world.x, -events.cursor_world.y);
@@ -278,41 +1488,61 @@ int main()
         }
 
         SDL_RenderPresent(renderer);
+        render_seconds = (SDL_GetPerformanceCounter() - render_begin) / freq;
         const u32 delay = 16;
         u32 diff = SDL_GetTicks() - begin;
         if (diff < delay) SDL_Delay(delay - diff);
     }
 
-    free(eul_pts);
-    free(rk2_pts);
-    free(rk4_pts);
+    destroy_scrub(&scrub);
+    for (u32 i = 0; i < plot_count; i ++)
+        destroy_series(&plots[i].curve.series);
+    free(ensemble_y0);
+    free(ensemble_pts);
+    destroy_ensemble(&ensemble);
+    destroy_sde(&sde);
+    mexp_free_tree(&noise);
+    free(sde_bands);
+    free(spread.y);
+    free(spread.sigma);
+    destroy_lte_map(&lte);
+    free(lte_pixels);
+    destroy_bench(&bench);
+    destroy_event_monitor(&monitor);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+    destroy_pool(&pool);
+    if (trajectory.header)
+        traj_close_reader(&trajectory);
+    if (sweep_map.header)
+        sweep_close_reader(&sweep_map);
+    free(traj_pts);
 
     SDL_DestroyTexture(static_texture);
     SDL_DestroyTexture(input_texture);
+    SDL_DestroyTexture(lte_texture);
+    if (sweep_texture)
+        SDL_DestroyTexture(sweep_texture);
     destroy_graphics(&graphics);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
-void redraw_static_texture(graphics_t *graphics, SDL_Texture *static_texture, vec2i *geometry, const string_t *prompt, const rect_t *prompt_rect)
+void redraw_static_texture(graphics_t *graphics, SDL_Texture *static_texture, vec2i *geometry, const string_t *prompt, const rect_t *prompt_rect,
+                           const plot_t *plots, u32 plot_count, const string_t *status, u32 status_color)
 {
-    static const string_t eul_text = {"EULER", 5};
-    static const string_t rk2_text = {"RK2", 3};
-    static const string_t rk4_text = {"RK4", 3};
-
-    rect_t eul_rect = get_text_rect(graphics, &eul_text);
-    rect_t rk2_rect = get_text_rect(graphics, &rk2_text);
-    rect_t rk4_rect = get_text_rect(graphics, &rk4_text);
-
-    int yoffs = eul_rect.h;
     SDL_SetRenderTarget(graphics->renderer, static_texture);
     SDL_SetRenderDrawBlendMode(graphics->renderer, SDL_BLENDMODE_BLEND);
     SDL_SetRenderDrawColor(graphics->renderer, 0, 0, 0, 0);
     SDL_RenderClear(graphics->renderer);
     sdraw_text(graphics, prompt_rect->x, prompt_rect->y, prompt, WHITE);
-    sdraw_text(graphics, geometry->x - eul_rect.w - 20, yoffs * 0 + 20, &eul_text, eul_color);
-    sdraw_text(graphics, geometry->x - rk2_rect.w - 20, yoffs * 1 + 20, &rk2_text, rk2_color);
-    sdraw_text(graphics, geometry->x - rk4_rect.w - 20, yoffs * 2 + 20, &rk4_text, rk4_color);
+    sdraw_text(graphics, prompt_rect->x, prompt_rect->y + prompt_rect->h, status, status_color);
+    for (u32 i = 0; i < plot_count; i ++)
+    {
+        string_t name = {plots[i].solver.name, strlen(plots[i].solver.name)};
+        rect_t rect = legend_rect(graphics, geometry, plots, i);
+        sdraw_text(graphics, rect.x, rect.y, &name, plots[i].enabled ? plots[i].color : GREY);
+    }
     SDL_SetRenderDrawBlendMode(graphics->renderer, SDL_BLENDMODE_NONE);
     SDL_SetRenderTarget(graphics->renderer, NULL);
 }
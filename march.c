@@ -0,0 +1,70 @@
+#include "march.h"
+#include <math.h>
+
+void init_march(march_t *m, const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user)
+{
+    memset(m, 0, sizeof(*m));
+    m->solver = *solver;
+    m->ode = ode;
+    m->params = *params;
+    m->emit = emit;
+    m->user = user;
+    m->x = params->x0;
+    m->h = params->h;
+    m->ok = 1;
+    memcpy(m->y, params->y0, sizeof(m->y));
+}
+
+static int march__emit(void *user, double x, const double *y, u32 dim)
+{
+    march_t *m = (march_t *)user;
+    // a resumed slice starts on the point the previous one ended with
+    if (m->points > 0 && x == m->x)
+        return 1;
+    if (m->points > 0 && x != m->x)
+        m->h = x - m->x;
+    m->x = x;
+    memcpy(m->y, y, dim * sizeof(*y));
+    m->points ++;
+    m->emitted ++;
+    if (m->emit && !m->emit(m->user, x, y, dim))
+    {
+        m->downstream_stopped = 1;
+        return 0;
+    }
+    return m->emitted < m->quota;
+}
+
+int advance_march(march_t *m, u32 max_points)
+{
+    if (m->done)
+        return 0;
+    if (max_points == 0)
+        return 1;
+
+    solve_params_t p = m->params;
+    solve_stats_t stats;
+    p.x0 = m->x;
+    p.h  = m->solver.adaptive && p.rtol > 0 ? m->h : m->params.h;
+    memcpy(p.y0, m->y, sizeof(p.y0));
+    m->quota = max_points;
+    m->emitted = 0;
+
+    int finished = solve(&m->solver, m->ode, &p, march__emit, m, &stats);
+    m->stats.steps    += stats.steps;
+    m->stats.rejected += stats.rejected;
+    m->stats.evals    += stats.evals;
+    m->stats.seconds  += stats.seconds;
+
+    // a slice cut short by its quota is the only way to carry on, unless
+    // the quota ran out right on x1
+    if (!finished && !m->downstream_stopped && m->emitted >= m->quota)
+    {
+        if ((m->params.x1 - m->x) * (m->params.x1 - m->params.x0) > 0)
+            return 1;
+        finished = 1;
+    }
+    m->ok = finished;
+    m->done = 1;
+    return 0;
+}
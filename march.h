@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+// a solve that can be advanced a few points at a time. each slice restarts
+// the solver from the last accepted point, with the last step size for
+// adaptive methods, and stops it through the emit callback once its quota
+// is used up. one-step methods continue exactly, multistep methods rebuild
+// their history at every slice boundary
+typedef struct march_t
+{
+    solver_t solver;
+    ode_t *ode;
+    solve_params_t params;
+    solve_emit_fn emit;
+    void *user;
+
+    double x, h;
+    double y[ODE_MAX_DIM];
+    u64 points;   // emitted so far, the initial one included
+    int done;     // reached x1, failed or stopped by emit
+    int ok;       // the run so far matches what solve would have returned
+    solve_stats_t stats;
+
+    // the slice in flight
+    u32 quota, emitted;
+    int downstream_stopped;
+} march_t;
+
+void init_march(march_t *march, const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user);
+
+// emits at most max_points more points, returns 0 once the run is over
+int  advance_march(march_t *march, u32 max_points);
@@ -14,6 +14,7 @@ static int  mexp__precedence(char t);
 static int  mexp__match_builtin(const char name[8]);
 static void mexp__print_node(const mexp_tree_t *tree, int32_t index, int level);
 static double mexp__eval_node(mexp_tree_t *tree, int32_t index);
+static const double *mexp__eval_node_batch(mexp_tree_t *tree, int32_t index, const double *const *v, uint32_t base, uint32_t count);
 
 static double mexp__builtin_sin(mexp_node_t *n) {return sin(n[0].value);}
 static double mexp__builtin_cos(mexp_node_t *n) {return cos(n[0].value);}
@@ -21,15 +22,25 @@ static double mexp__builtin_tan(mexp_node_t *n) {return tan(n[0].value);}
 static double mexp__builtin_log(mexp_node_t *n) {return log(n[0].value);}
 static double mexp__builtin_exp(mexp_node_t *n) {return exp(n[0].value);}
 static double mexp__builtin_sqrt(mexp_node_t *n) {return sqrt(n[0].value);}
+#define BATCHFUNC(f) static void mexp__batch_##f(double *o, const double **a, uint32_t n) {for (uint32_t i = 0; i < n; i ++) o[i] = f(a[0][i]);}
+BATCHFUNC(sin)
+BATCHFUNC(cos)
+BATCHFUNC(tan)
+BATCHFUNC(log)
+BATCHFUNC(exp)
+BATCHFUNC(sqrt)
+#undef BATCHFUNC
 static const struct
 {
     const char name[8];
     mexp_func_t func;
+    mexp_batch_func_t batch;
     uint32_t nargs;
+    double (*math)(double);
 }
 mexp__builtin_funcs[] =
 {
-#define NEWFUNC(f, n) {#f, mexp__builtin_##f, n}
+#define NEWFUNC(f, n) {#f, mexp__builtin_##f, mexp__batch_##f, n, f}
     NEWFUNC(sin, 1),
     NEWFUNC(cos, 1),
     NEWFUNC(tan, 1),
@@ -97,6 +108,8 @@ int mexp_init_tree(mexp_tree_t *tree)
     if (!tree->pool.pool)
         return 0;
     tree->pool.cap  = 16;
+    tree->batch = NULL;
+    tree->batch_cap = 0;
     return 1;
 }
 
@@ -190,6 +203,7 @@ int mexp_generate_tree(mexp_tree_t *tree, mexp_parser_t *parser, const char *exp
             }
             node.type = NODE_FUNCTION;
             node.func.ptr = mexp__builtin_funcs[index].func;
+            node.func.bptr = mexp__builtin_funcs[index].batch;
             node.func.nargs = mexp__builtin_funcs[index].nargs;
             for (int i = 0; i < sizeof(node.func.name); i ++)
                 node.func.name[i] = mexp__builtin_funcs[index].name[i];
@@ -226,6 +240,7 @@ int mexp_generate_tree(mexp_tree_t *tree, mexp_parser_t *parser, const char *exp
                 token->type = TOKEN_ERROR;
                 return 0;
             }
+            int32_t prev_operator = state.last_operator;
             state.last_operator = tree->pool.count - 1;
             mexp_node_t *self = &tree->pool.pool[state.last_operator];
 
@@ -262,7 +277,9 @@ int mexp_generate_tree(mexp_tree_t *tree, mexp_parser_t *parser, const char *exp
                 int ph = mexp__precedence(head->oper.type);
                 if (ps <= ph)
                 {
-                    head->oper.right = state.last_operand;
+                    // the operand closes the innermost pending operator, which
+                    // is only the head when nothing of higher precedence followed it
+                    tree->pool.pool[prev_operator].oper.right = state.last_operand;
                     self->oper.left  = state.head;
                     state.head = state.last_operator;
                 }
@@ -282,7 +299,8 @@ int mexp_generate_tree(mexp_tree_t *tree, mexp_parser_t *parser, const char *exp
                         {
                             self->oper.left   = head->oper.right;
                             head->oper.right  = state.last_operator;
-                            right->oper.right = state.last_operand;
+                            // the operand again closes the innermost pending operator
+                            tree->pool.pool[prev_operator].oper.right = state.last_operand;
                             break;
                         }
                         head = right;
@@ -417,6 +435,11 @@ void mexp_free_parser(mexp_parser_t *parser)
     parser->stack.buf   = NULL;
     parser->stack.cap   = 0;
     parser->stack.count = 0;
+    if (parser->variables)
+        free(parser->variables);
+    parser->variables = NULL;
+    parser->var_count = 0;
+    parser->var_max   = 0;
     parser->at    = NULL;
     parser->last  = NULL;
     parser->start = NULL;
@@ -431,6 +454,26 @@ void mexp_free_tree(mexp_tree_t *tree)
     tree->pool.cap   = 0;
     tree->pool.count = 0;
     tree->head = -1;
+    if (tree->batch)
+        free(tree->batch);
+    tree->batch = NULL;
+    tree->batch_cap = 0;
+}
+
+int mexp_copy_tree(mexp_tree_t *dst, const mexp_tree_t *src)
+{
+    if (dst->pool.cap < src->pool.count)
+    {
+        mexp_node_t *pool = (mexp_node_t*)realloc(dst->pool.pool, src->pool.cap * sizeof(*pool));
+        if (!pool)
+            return 0;
+        dst->pool.pool = pool;
+        dst->pool.cap  = src->pool.cap;
+    }
+    memcpy(dst->pool.pool, src->pool.pool, src->pool.count * sizeof(*src->pool.pool));
+    dst->pool.count = src->pool.count;
+    dst->head = src->head;
+    return 1;
 }
 
 void mexp_print_tree(const mexp_tree_t *tree)
@@ -455,6 +498,34 @@ double mexp_eval_tree(mexp_tree_t *tree, double *v)
     return mexp__eval_node(tree, tree->head);
 }
 
+int mexp_eval_tree_batch(mexp_tree_t *tree, const double *const *v, double *out, uint32_t count)
+{
+    if (!tree || tree->head == -1)
+    {
+        for (uint32_t i = 0; i < count; i ++)
+            out[i] = 0;
+        return 1;
+    }
+
+    // one MEXP_BATCH_SIZE wide scratch row per node
+    if (tree->batch_cap < tree->pool.count)
+    {
+        double *batch = (double*)realloc(tree->batch, tree->pool.cap * MEXP_BATCH_SIZE * sizeof(*batch));
+        if (!batch)
+            return 0;
+        tree->batch = batch;
+        tree->batch_cap = tree->pool.cap;
+    }
+
+    for (uint32_t base = 0; base < count; base += MEXP_BATCH_SIZE)
+    {
+        uint32_t n = count - base < MEXP_BATCH_SIZE ? count - base : MEXP_BATCH_SIZE;
+        const double *r = mexp__eval_node_batch(tree, tree->head, v, base, n);
+        memcpy(out + base, r, n * sizeof(*out));
+    }
+    return 1;
+}
+
 int mexp_add_variable(mexp_parser_t *parser, char var)
 {
     if (parser->var_count >= parser->var_max)
@@ -469,6 +540,299 @@ int mexp_add_variable(mexp_parser_t *parser, char var)
     return 1;
 }
 
+void mexp_clear_variables(mexp_parser_t *parser)
+{
+    parser->var_count = 0;
+}
+
+int mexp_init_program(mexp_program_t *prog)
+{
+    memset(prog, 0, sizeof(*prog));
+    return 1;
+}
+
+void mexp_free_program(mexp_program_t *prog)
+{
+    free(prog->code);
+    free(prog->outputs);
+    free(prog->regs);
+    memset(prog, 0, sizeof(*prog));
+}
+
+typedef struct
+{
+    mexp_program_t *prog;
+    int32_t *table;
+    uint32_t table_cap;
+} mexp_compiler_t;
+
+static uint32_t mexp__hash_instr(const mexp_instr_t *in)
+{
+    uint64_t bits;
+    memcpy(&bits, &in->value, sizeof(bits));
+    uint64_t h = in->op * 0x9e3779b97f4a7c15ull;
+    h ^= (uint64_t)(uint32_t)in->a * 0xc2b2ae3d27d4eb4full + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uint32_t)in->b * 0x165667b19e3779f9ull + (h << 6) + (h >> 2);
+    h ^= bits + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)in->fn;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static int mexp__same_instr(const mexp_instr_t *x, const mexp_instr_t *y)
+{
+    return x->op == y->op && x->a == y->a && x->b == y->b && x->fn == y->fn &&
+           memcmp(&x->value, &y->value, sizeof(x->value)) == 0;
+}
+
+// returns the register of an identical instruction or appends this one
+static int32_t mexp__emit(mexp_compiler_t *c, mexp_instr_t in)
+{
+    mexp_program_t *prog = c->prog;
+    if (prog->count * 2 >= c->table_cap)
+    {
+        uint32_t cap = c->table_cap ? c->table_cap * 2 : 64;
+        int32_t *table = (int32_t *)malloc(cap * sizeof(*table));
+        if (!table)
+            return -1;
+        for (uint32_t i = 0; i < cap; i ++)
+            table[i] = -1;
+        for (uint32_t i = 0; i < prog->count; i ++)
+        {
+            uint32_t slot = mexp__hash_instr(&prog->code[i]) & (cap - 1);
+            while (table[slot] != -1) slot = (slot + 1) & (cap - 1);
+            table[slot] = i;
+        }
+        free(c->table);
+        c->table = table;
+        c->table_cap = cap;
+    }
+
+    uint32_t slot = mexp__hash_instr(&in) & (c->table_cap - 1);
+    while (c->table[slot] != -1)
+    {
+        if (mexp__same_instr(&prog->code[c->table[slot]], &in))
+            return c->table[slot];
+        slot = (slot + 1) & (c->table_cap - 1);
+    }
+
+    if (prog->count >= prog->cap)
+    {
+        uint32_t cap = prog->cap ? prog->cap * 2 : 32;
+        mexp_instr_t *code = (mexp_instr_t *)realloc(prog->code, cap * sizeof(*code));
+        if (!code)
+            return -1;
+        prog->code = code;
+        prog->cap = cap;
+    }
+    c->table[slot] = prog->count;
+    prog->code[prog->count] = in;
+    return prog->count ++;
+}
+
+static int32_t mexp__emit_number(mexp_compiler_t *c, double value)
+{
+    mexp_instr_t in;
+    memset(&in, 0, sizeof(in));
+    in.op = MEXP_OP_NUMBER;
+    in.value = value;
+    return mexp__emit(c, in);
+}
+
+static int32_t mexp__compile_node(mexp_compiler_t *c, const mexp_tree_t *tree, int32_t index)
+{
+    const mexp_node_t *node = &tree->pool.pool[index];
+    mexp_instr_t in;
+    memset(&in, 0, sizeof(in));
+    switch (node->type)
+    {
+        case NODE_DUMMY:
+            return mexp__compile_node(c, tree, node->index);
+        case NODE_NUMBER:
+            return mexp__emit_number(c, node->value);
+        case NODE_VARIABLE:
+            in.op = MEXP_OP_VARIABLE;
+            in.a  = node->var.index;
+            return mexp__emit(c, in);
+        case NODE_FUNCTION:
+        {
+            int builtin = mexp__match_builtin(node->func.name);
+            if (builtin == -1 || node->func.nargs != 1)
+                return -1;
+            in.a = mexp__compile_node(c, tree, index + 1);
+            if (in.a == -1)
+                return -1;
+            if (c->prog->code[in.a].op == MEXP_OP_NUMBER)
+                return mexp__emit_number(c, mexp__builtin_funcs[builtin].math(c->prog->code[in.a].value));
+            in.op = MEXP_OP_CALL;
+            in.fn = mexp__builtin_funcs[builtin].math;
+            memcpy(in.name, node->func.name, sizeof(in.name));
+            return mexp__emit(c, in);
+        }
+        case NODE_OPERATOR:
+        {
+            in.a = mexp__compile_node(c, tree, node->oper.left);
+            in.b = in.a == -1 ? -1 : mexp__compile_node(c, tree, node->oper.right);
+            if (in.b == -1)
+                return -1;
+            switch (node->oper.type)
+            {
+                case '+' : in.op = MEXP_OP_ADD; break;
+                case '-' : in.op = MEXP_OP_SUB; break;
+                case '*' : in.op = MEXP_OP_MUL; break;
+                case '/' : in.op = MEXP_OP_DIV; break;
+                case '^' : in.op = MEXP_OP_POW; break;
+                default  : return -1;
+            }
+            const mexp_instr_t *l = &c->prog->code[in.a], *r = &c->prog->code[in.b];
+            if (l->op == MEXP_OP_NUMBER && r->op == MEXP_OP_NUMBER)
+            {
+                double lv = l->value, rv = r->value;
+                switch (in.op)
+                {
+                    case MEXP_OP_ADD : return mexp__emit_number(c, lv + rv);
+                    case MEXP_OP_SUB : return mexp__emit_number(c, lv - rv);
+                    case MEXP_OP_MUL : return mexp__emit_number(c, lv * rv);
+                    case MEXP_OP_DIV : return mexp__emit_number(c, lv / rv);
+                    case MEXP_OP_POW : return mexp__emit_number(c, pow(lv, rv));
+                }
+            }
+            // commutative operands in a fixed order so a*b and b*a share a register
+            if ((in.op == MEXP_OP_ADD || in.op == MEXP_OP_MUL) && in.a > in.b)
+            {
+                int32_t t = in.a;
+                in.a = in.b;
+                in.b = t;
+            }
+            return mexp__emit(c, in);
+        }
+    }
+    return -1;
+}
+
+int mexp_compile_program(mexp_program_t *prog, const mexp_tree_t *trees, uint32_t count)
+{
+    mexp_compiler_t c = {prog, NULL, 0};
+    int ok = 1;
+
+    prog->count = 0;
+    prog->output_count = 0;
+    free(prog->outputs);
+    prog->outputs = (int32_t *)malloc(count * sizeof(*prog->outputs));
+    if (!prog->outputs)
+        return 0;
+    for (uint32_t i = 0; ok && i < count; i ++)
+    {
+        ok = trees[i].head != -1;
+        if (ok) prog->outputs[i] = mexp__compile_node(&c, &trees[i], trees[i].head);
+        ok = ok && prog->outputs[i] != -1;
+    }
+    free(c.table);
+    if (!ok)
+        return 0;
+    prog->output_count = count;
+
+    free(prog->regs);
+    prog->regs = (double *)calloc(prog->count ? prog->count : 1, sizeof(*prog->regs));
+    return prog->regs != NULL;
+}
+
+int mexp_copy_program(mexp_program_t *dst, const mexp_program_t *src)
+{
+    mexp_free_program(dst);
+    dst->code    = (mexp_instr_t *)malloc((src->count ? src->count : 1) * sizeof(*dst->code));
+    dst->outputs = (int32_t *)malloc((src->output_count ? src->output_count : 1) * sizeof(*dst->outputs));
+    dst->regs    = (double *)calloc(src->count ? src->count : 1, sizeof(*dst->regs));
+    if (!dst->code || !dst->outputs || !dst->regs)
+    {
+        mexp_free_program(dst);
+        return 0;
+    }
+    memcpy(dst->code, src->code, src->count * sizeof(*dst->code));
+    memcpy(dst->outputs, src->outputs, src->output_count * sizeof(*dst->outputs));
+    dst->count = dst->cap = src->count;
+    dst->output_count = src->output_count;
+    return 1;
+}
+
+void mexp_eval_program(mexp_program_t *prog, const double *v, double *out)
+{
+    const mexp_instr_t *code = prog->code;
+    double *r = prog->regs;
+    for (uint32_t i = 0; i < prog->count; i ++)
+    {
+        const mexp_instr_t *in = &code[i];
+        switch (in->op)
+        {
+            case MEXP_OP_NUMBER   : r[i] = in->value; break;
+            case MEXP_OP_VARIABLE : r[i] = v[in->a]; break;
+            case MEXP_OP_ADD      : r[i] = r[in->a] + r[in->b]; break;
+            case MEXP_OP_SUB      : r[i] = r[in->a] - r[in->b]; break;
+            case MEXP_OP_MUL      : r[i] = r[in->a] * r[in->b]; break;
+            case MEXP_OP_DIV      : r[i] = r[in->a] / r[in->b]; break;
+            case MEXP_OP_POW      : r[i] = pow(r[in->a], r[in->b]); break;
+            case MEXP_OP_CALL     : r[i] = in->fn(r[in->a]); break;
+        }
+    }
+    for (uint32_t i = 0; i < prog->output_count; i ++)
+        out[i] = r[prog->outputs[i]];
+}
+
+int mexp_program_linear(const mexp_program_t *prog, uint32_t output, uint32_t slot, uint32_t varying, double *coef)
+{
+    const uint32_t end = prog->outputs[output] + 1;
+    const double *r = prog->regs;
+    double *lin = (double *)malloc(end * sizeof(*lin));
+    uint8_t *vary = (uint8_t *)malloc(end);
+    if (!lin || !vary)
+    {
+        free(lin);
+        free(vary);
+        return 0;
+    }
+    for (uint32_t i = 0; i < end; i ++)
+    {
+        const mexp_instr_t *in = &prog->code[i];
+        lin[i] = 0;
+        switch (in->op)
+        {
+            case MEXP_OP_NUMBER:
+                vary[i] = 0;
+                break;
+            case MEXP_OP_VARIABLE:
+                vary[i] = (uint32_t)in->a < varying;
+                lin[i] = (uint32_t)in->a == slot;
+                break;
+            case MEXP_OP_ADD:
+            case MEXP_OP_SUB:
+                vary[i] = vary[in->a] | vary[in->b];
+                lin[i] = in->op == MEXP_OP_ADD ? lin[in->a] + lin[in->b] : lin[in->a] - lin[in->b];
+                break;
+            case MEXP_OP_MUL:
+                vary[i] = vary[in->a] | vary[in->b];
+                if (!vary[in->a])
+                    lin[i] = r[in->a] * lin[in->b];
+                else if (!vary[in->b])
+                    lin[i] = lin[in->a] * r[in->b];
+                break;
+            case MEXP_OP_DIV:
+                vary[i] = vary[in->a] | vary[in->b];
+                if (!vary[in->b])
+                    lin[i] = lin[in->a] / r[in->b];
+                break;
+            case MEXP_OP_POW:
+                vary[i] = vary[in->a] | vary[in->b];
+                break;
+            case MEXP_OP_CALL:
+                vary[i] = vary[in->a];
+                break;
+        }
+    }
+    *coef = isfinite(lin[end - 1]) ? lin[end - 1] : 0;
+    free(lin);
+    free(vary);
+    return 1;
+}
+
 static void mexp__advance_whitespace(mexp_parser_t *parser)
 {
 #define ISSPACE(ch) ((ch) == '\t' || (ch) == '\n' || (ch) == '\v' || (ch) == '\f' || (ch) == '\r' || (ch) == ' ')
@@ -748,3 +1112,43 @@ static double mexp__eval_node(mexp_tree_t *tree, int32_t index)
     }
     return node->value;
 }
+
+static const double *mexp__eval_node_batch(mexp_tree_t *tree, int32_t index, const double *const *v, uint32_t base, uint32_t count)
+{
+    mexp_node_t *node = &tree->pool.pool[index];
+    double *o = tree->batch + (size_t)index * MEXP_BATCH_SIZE;
+    switch (node->type)
+    {
+        case NODE_DUMMY:
+            return mexp__eval_node_batch(tree, node->index, v, base, count);
+        case NODE_NUMBER:
+            for (uint32_t i = 0; i < count; i ++)
+                o[i] = node->value;
+            return o;
+        case NODE_VARIABLE:
+            return v[node->var.index] + base;
+        case NODE_FUNCTION:
+        {
+            const double *args[8];
+            for (int i = 0; i < node->func.nargs; i ++)
+                args[i] = mexp__eval_node_batch(tree, index + i + 1, v, base, count);
+            node->func.bptr(o, args, count);
+            return o;
+        }
+        case NODE_OPERATOR:
+        {
+            const double *l = mexp__eval_node_batch(tree, node->oper.left, v, base, count);
+            const double *r = mexp__eval_node_batch(tree, node->oper.right, v, base, count);
+            switch (node->oper.type)
+            {
+                case '+' : for (uint32_t i = 0; i < count; i ++) o[i] = l[i] + r[i]; break;
+                case '-' : for (uint32_t i = 0; i < count; i ++) o[i] = l[i] - r[i]; break;
+                case '*' : for (uint32_t i = 0; i < count; i ++) o[i] = l[i] * r[i]; break;
+                case '/' : for (uint32_t i = 0; i < count; i ++) o[i] = l[i] / r[i]; break;
+                case '^' : for (uint32_t i = 0; i < count; i ++) o[i] = pow(l[i], r[i]); break;
+            }
+            return o;
+        }
+    }
+    return o;
+}
@@ -2,6 +2,7 @@
 #include <stdint.h>
 
 #define MEXP_ERROR_LENGTH 256
+#define MEXP_BATCH_SIZE 64
 
 typedef struct mexp_token_t   mexp_token_t;
 typedef struct mexp_node_t    mexp_node_t;
@@ -10,7 +11,10 @@ typedef struct mexp_state_t   mexp_state_t;
 typedef struct mexp_stack_t   mexp_stack_t;
 typedef struct mexp_parser_t  mexp_parser_t;
 typedef struct mexp_tree_t    mexp_tree_t;
+typedef struct mexp_instr_t   mexp_instr_t;
+typedef struct mexp_program_t mexp_program_t;
 typedef double (*mexp_func_t) (mexp_node_t *);
+typedef void (*mexp_batch_func_t) (double *out, const double **args, uint32_t count);
 
 int  mexp_init_parser(mexp_parser_t *parser);
 int  mexp_init_tree(mexp_tree_t *tree);
@@ -18,10 +22,40 @@ int  mexp_generate_tree(mexp_tree_t *tree, mexp_parser_t *parser, const char *ex
 void mexp_free_parser(mexp_parser_t *parser);
 void mexp_free_tree(mexp_tree_t *tree);
 void mexp_print_tree(const mexp_tree_t *tree);
+int  mexp_copy_tree(mexp_tree_t *dst, const mexp_tree_t *src);
 double mexp_eval_tree(mexp_tree_t *tree, double *v);
+// v[i] points to count values of variable i, results are written to out
+int  mexp_eval_tree_batch(mexp_tree_t *tree, const double *const *v, double *out, uint32_t count);
 int mexp_add_variable(mexp_parser_t *parser, char var);
+void mexp_clear_variables(mexp_parser_t *parser);
 const char *mexp_get_error(mexp_parser_t *parser);
 
+// several trees flattened into one straight-line program, identical
+// subexpressions are evaluated once and constant ones are folded
+int  mexp_init_program(mexp_program_t *prog);
+void mexp_free_program(mexp_program_t *prog);
+int  mexp_compile_program(mexp_program_t *prog, const mexp_tree_t *trees, uint32_t count);
+int  mexp_copy_program(mexp_program_t *dst, const mexp_program_t *src);
+void mexp_eval_program(mexp_program_t *prog, const double *v, double *out);
+// the coefficient of v[slot] in the part of an output that is linear in it
+// by structure: sums and differences are followed, products and quotients
+// by constant subexpressions scale it and anything else belongs to the
+// rest. variables from slot varying on count as constants and are read
+// from the registers, so the program must have been evaluated with them
+int  mexp_program_linear(const mexp_program_t *prog, uint32_t output, uint32_t slot, uint32_t varying, double *coef);
+
+enum
+{
+    MEXP_OP_NUMBER = 0,
+    MEXP_OP_VARIABLE,
+    MEXP_OP_ADD,
+    MEXP_OP_SUB,
+    MEXP_OP_MUL,
+    MEXP_OP_DIV,
+    MEXP_OP_POW,
+    MEXP_OP_CALL,
+};
+
 struct mexp_token_t
 {
     uint32_t type;
@@ -62,6 +96,7 @@ struct mexp_node_t
             int nargs;
             char name[8];
             mexp_func_t ptr;
+            mexp_batch_func_t bptr;
         } func;
     };
 };
@@ -105,4 +140,26 @@ struct mexp_tree_t
 {
     mexp_pool_t pool;
     int32_t head;
+    double *batch;
+    uint32_t batch_cap;
+};
+
+// writes register index, operands are earlier registers, variables read v[a]
+struct mexp_instr_t
+{
+    uint32_t op;
+    int32_t a, b;
+    double value;
+    double (*fn)(double);
+    char name[8];
+};
+
+struct mexp_program_t
+{
+    mexp_instr_t *code;
+    uint32_t count;
+    uint32_t cap;
+    int32_t *outputs;
+    uint32_t output_count;
+    double *regs;
 };
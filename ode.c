@@ -0,0 +1,10 @@
+#include "ode.h"
+
+void init_ode(ode_t *ode, mexp_program_t *prog)
+{
+    assert(prog->output_count >= 1 && prog->output_count <= ODE_MAX_DIM);
+    ode->prog  = prog;
+    ode->dim   = prog->output_count;
+    ode->evals = 0;
+    memset(ode->vars, 0, sizeof(ode->vars));
+}
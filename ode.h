@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common.h"
+#include "mexp.h"
+
+#define ODE_MAX_DIM  16
+#define ODE_MAX_VARS 32
+
+// dy/dx = f(x, y) for a vector y, all components come out of one program,
+// variable slot 0 is x and slots 1..dim hold y
+typedef struct ode_t
+{
+    mexp_program_t *prog;
+    u32 dim;
+    u64 evals;
+    double vars[ODE_MAX_VARS];
+} ode_t;
+
+void init_ode(ode_t *ode, mexp_program_t *prog);
+
+static inline void ode_eval(ode_t *ode, double x, const double *y, double *dydx)
+{
+    ode->vars[0] = x;
+    for (u32 i = 0; i < ode->dim; i ++)
+        ode->vars[i + 1] = y[i];
+    mexp_eval_program(ode->prog, ode->vars, dydx);
+    ode->evals ++;
+}
@@ -0,0 +1,300 @@
+#include "pack.h"
+#include <math.h>
+#include <stdlib.h>
+
+// quantized values stay far enough from the i64 range that the predictions
+// and residuals below cannot overflow
+#define PACK_MAX_STEPS ((double)((i64)1 << 60))
+// worst case bytes per value, 2 control bits + 12 window bits + 64 bits
+#define PACK_VALUE_BYTES 10
+
+typedef struct
+{
+    const u8 *data;
+    size_t at; // in bits
+} pack_reader_t;
+
+static inline u64 pack__bits(double v)
+{
+    u64 u;
+    memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+static inline double pack__double(u64 u)
+{
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+// written without a multiply so that it cannot be contracted differently on
+// the encoding and the decoding side
+static inline double pack__predict(const double *v, u32 i)
+{
+    return i == 0 ? 0 : i == 1 ? v[0] : v[i - 1] + (v[i - 1] - v[i - 2]);
+}
+
+static inline i64 pack__predict_steps(const i64 *q, u32 i)
+{
+    return i == 0 ? 0 : i == 1 ? q[0] : 2 * q[i - 1] - q[i - 2];
+}
+
+static int pack__reserve(pack_t *p, size_t n)
+{
+    // 8 bytes of slack let the reader load whole words at the end
+    if (p->bytes + n + 8 <= p->cap)
+        return 1;
+    size_t cap = p->cap ? p->cap : 1 << 16;
+    while (cap < p->bytes + n + 8) cap *= 2;
+    u8 *data = (u8 *)realloc(p->data, cap);
+    if (!data) return 0;
+    memset(data + p->cap, 0, cap - p->cap);
+    p->data = data;
+    p->cap = cap;
+    return 1;
+}
+
+// most significant bit first, room has been reserved for the whole block
+static void pack__put(pack_t *p, u64 bits, u32 n)
+{
+    if (n > 32)
+    {
+        pack__put(p, bits >> 32, n - 32);
+        n = 32;
+    }
+    p->acc = (p->acc << n) | (bits & (((u64)1 << n) - 1));
+    p->acc_bits += n;
+    while (p->acc_bits >= 8)
+    {
+        p->acc_bits -= 8;
+        p->data[p->bytes ++] = (u8)(p->acc >> p->acc_bits);
+    }
+}
+
+static void pack__align(pack_t *p)
+{
+    if (p->acc_bits)
+        p->data[p->bytes ++] = (u8)(p->acc << (8 - p->acc_bits));
+    p->acc_bits = 0;
+}
+
+static inline u64 pack__get(pack_reader_t *r, u32 n)
+{
+    if (n > 32)
+    {
+        u64 hi = pack__get(r, n - 32);
+        return (hi << 32) | pack__get(r, 32);
+    }
+    if (n == 0)
+        return 0;
+    const u8 *b = r->data + (r->at >> 3);
+    u64 w = 0;
+    for (u32 i = 0; i < 8; i ++)
+        w = (w << 8) | b[i];
+    w <<= r->at & 7;
+    r->at += n;
+    return w >> (64 - n);
+}
+
+static void pack__put_xor(pack_t *p, const double *v, u32 count)
+{
+    u32 lead = 0, trail = 0;
+    int window = 0;
+    for (u32 i = 0; i < count; i ++)
+    {
+        u64 x = pack__bits(v[i]) ^ pack__bits(pack__predict(v, i));
+        if (!x)
+        {
+            pack__put(p, 0, 1);
+            continue;
+        }
+        u32 l = (u32)__builtin_clzll(x), t = (u32)__builtin_ctzll(x);
+        // the window is kept while it wastes less than a new header costs
+        if (window && l >= lead && t >= trail && (l - lead) + (t - trail) <= 12)
+        {
+            pack__put(p, 2, 2);
+            pack__put(p, x >> trail, 64 - lead - trail);
+            continue;
+        }
+        lead = l;
+        trail = t;
+        window = 1;
+        pack__put(p, 3, 2);
+        pack__put(p, lead, 6);
+        pack__put(p, 64 - lead - trail - 1, 6);
+        pack__put(p, x >> trail, 64 - lead - trail);
+    }
+}
+
+static void pack__get_xor(pack_reader_t *r, double *v, u32 count)
+{
+    u32 len = 0, trail = 0;
+    for (u32 i = 0; i < count; i ++)
+    {
+        u64 x = 0;
+        if (pack__get(r, 1))
+        {
+            if (pack__get(r, 1))
+            {
+                u32 lead = (u32)pack__get(r, 6);
+                len = (u32)pack__get(r, 6) + 1;
+                trail = 64 - lead - len;
+            }
+            x = pack__get(r, len) << trail;
+        }
+        v[i] = pack__double(pack__bits(pack__predict(v, i)) ^ x);
+    }
+}
+
+static int pack__quantizable(const double *v, u32 count, double quantum)
+{
+    for (u32 i = 0; i < count; i ++)
+        if (!(fabs(v[i] / quantum) < PACK_MAX_STEPS))
+            return 0;
+    return 1;
+}
+
+static void pack__put_steps(pack_t *p, const double *v, u32 count, double quantum, i64 *q)
+{
+    for (u32 i = 0; i < count; i ++)
+    {
+        q[i] = llround(v[i] / quantum);
+        p->max_error = fmax(p->max_error, fabs(q[i] * quantum - v[i]));
+        i64 r = q[i] - pack__predict_steps(q, i);
+        u64 z = ((u64)r << 1) ^ (u64)(r >> 63);
+        if (z == 0)               pack__put(p, 0, 1);
+        else if (z < (1u << 2))  { pack__put(p, 2, 2);  pack__put(p, z, 2); }
+        else if (z < (1u << 6))  { pack__put(p, 6, 3);  pack__put(p, z, 6); }
+        else if (z < (1u << 13)) { pack__put(p, 14, 4); pack__put(p, z, 13); }
+        else if (z < (1u << 20)) { pack__put(p, 30, 5); pack__put(p, z, 20); }
+        else                     { pack__put(p, 31, 5); pack__put(p, z, 64); }
+    }
+}
+
+static void pack__get_steps(pack_reader_t *r, double *v, u32 count, double quantum, i64 *q)
+{
+    for (u32 i = 0; i < count; i ++)
+    {
+        u64 z;
+        if (!pack__get(r, 1))      z = 0;
+        else if (!pack__get(r, 1)) z = pack__get(r, 2);
+        else if (!pack__get(r, 1)) z = pack__get(r, 6);
+        else if (!pack__get(r, 1)) z = pack__get(r, 13);
+        else if (!pack__get(r, 1)) z = pack__get(r, 20);
+        else                       z = pack__get(r, 64);
+        i64 d = (i64)(z >> 1) ^ -(i64)(z & 1);
+        q[i] = pack__predict_steps(q, i) + d;
+        v[i] = q[i] * quantum;
+    }
+}
+
+static int pack__seal(pack_t *p)
+{
+    const u32 n = p->pending_count;
+    if (p->block_count >= p->block_cap)
+    {
+        u64 cap = p->block_cap ? p->block_cap * 2 : 64;
+        pack_block_t *blocks = (pack_block_t *)realloc(p->blocks, cap * sizeof(*blocks));
+        if (!blocks) return 0;
+        p->blocks = blocks;
+        p->block_cap = cap;
+    }
+    if (!pack__reserve(p, (size_t)n * (p->dim + 1) * PACK_VALUE_BYTES + p->dim + 1))
+        return 0;
+
+    pack_block_t *b = &p->blocks[p->block_count ++];
+    b->offset = p->bytes;
+    b->count = n;
+    b->x_min = INFINITY;
+    b->x_max = -INFINITY;
+    for (u32 i = 0; i < n; i ++)
+    {
+        b->x_min = fmin(b->x_min, p->pending[i]);
+        b->x_max = fmax(b->x_max, p->pending[i]);
+    }
+
+    // the steps scratch sits behind the pending columns
+    i64 *q = (i64 *)(p->pending + (size_t)(p->dim + 1) * PACK_BLOCK_SIZE);
+    const double quantum = 2 * p->tolerance;
+    pack__put_xor(p, p->pending, n);
+    for (u32 c = 0; c < p->dim; c ++)
+    {
+        const double *v = p->pending + (size_t)(c + 1) * PACK_BLOCK_SIZE;
+        int steps = p->tolerance > 0 && pack__quantizable(v, n, quantum);
+        pack__put(p, steps, 1);
+        if (steps)
+            pack__put_steps(p, v, n, quantum, q);
+        else
+            pack__put_xor(p, v, n);
+    }
+    pack__align(p);
+    p->pending_count = 0;
+    return 1;
+}
+
+int init_pack(pack_t *p, u32 dim, double tolerance)
+{
+    memset(p, 0, sizeof(*p));
+    p->dim = dim;
+    p->tolerance = tolerance > 0 ? tolerance : 0;
+    p->pending = (double *)malloc((size_t)(dim + 2) * PACK_BLOCK_SIZE * sizeof(double));
+    return p->pending != NULL;
+}
+
+void destroy_pack(pack_t *p)
+{
+    free(p->data);
+    free(p->blocks);
+    free(p->pending);
+    memset(p, 0, sizeof(*p));
+}
+
+int pack_push(pack_t *p, double x, const double *y)
+{
+    const u32 i = p->pending_count;
+    p->pending[i] = x;
+    for (u32 c = 0; c < p->dim; c ++)
+        p->pending[(size_t)(c + 1) * PACK_BLOCK_SIZE + i] = y[c];
+    p->pending_count ++;
+    p->count ++;
+    return p->pending_count < PACK_BLOCK_SIZE || pack__seal(p);
+}
+
+int pack_flush(pack_t *p)
+{
+    return p->pending_count == 0 || pack__seal(p);
+}
+
+u64 pack_find_block(const pack_t *p, double x)
+{
+    u64 lo = 0, hi = p->block_count;
+    // a run from x0 > x1 stores its blocks with x going down
+    const int down = hi > 1 && p->blocks[hi - 1].x_max < p->blocks[0].x_max;
+    while (lo < hi)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+        if (down ? p->blocks[mid].x_min > x : p->blocks[mid].x_max < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+u32 pack_decode_block(const pack_t *p, u64 block, double *out)
+{
+    const pack_block_t *b = &p->blocks[block];
+    const u32 n = b->count;
+    const double quantum = 2 * p->tolerance;
+    pack_reader_t r = {p->data, b->offset * 8};
+    i64 q[PACK_BLOCK_SIZE];
+    pack__get_xor(&r, out, n);
+    for (u32 c = 0; c < p->dim; c ++)
+    {
+        double *v = out + (size_t)(c + 1) * n;
+        if (pack__get(&r, 1))
+            pack__get_steps(&r, v, n, quantum, q);
+        else
+            pack__get_xor(&r, v, n);
+    }
+    return n;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common.h"
+
+// compressed in-memory trajectory. points are gathered into blocks of
+// PACK_BLOCK_SIZE and every block is encoded on its own, column by column
+// (x, then y_0 ... y_dim-1), so that any block decodes without the others.
+// each value is predicted by extrapolating the two before it:
+//   lossless columns xor the value with the prediction and store the
+//   meaningful bits Gorilla style, reusing the last leading/trailing zero
+//   window when it fits closely enough
+//   with a tolerance y is rounded to a multiple of 2 * tolerance and the
+//   difference to the predicted multiple is stored in a variable length code
+// x is always lossless. a y column falls back to xor when it holds values
+// the quantizer cannot represent (not finite or too large)
+#define PACK_BLOCK_SIZE 1024
+
+typedef struct pack_block_t
+{
+    size_t offset; // in bytes, blocks start byte aligned
+    u32 count;
+    double x_min, x_max;
+} pack_block_t;
+
+typedef struct pack_t
+{
+    u32 dim;
+    double tolerance; // 0 is lossless
+    u64 count;
+
+    u8 *data;
+    size_t bytes, cap;
+    pack_block_t *blocks;
+    u64 block_count, block_cap;
+
+    // the block being filled, laid out like a decoded one
+    double *pending;
+    u32 pending_count;
+    double max_error; // over the sealed blocks
+
+    // bit writer
+    u64 acc;
+    u32 acc_bits;
+} pack_t;
+
+int  init_pack(pack_t *pack, u32 dim, double tolerance);
+void destroy_pack(pack_t *pack);
+// returns 0 when out of memory
+int  pack_push(pack_t *pack, double x, const double *y);
+// seals the partly filled block so that every point can be decoded
+int  pack_flush(pack_t *pack);
+
+// first block whose x range reaches x going in the direction of the run,
+// x has to be monotonic
+u64  pack_find_block(const pack_t *pack, double x);
+// out holds x[count] then y_0[count] ... y_dim-1[count], count is returned.
+// room for PACK_BLOCK_SIZE * (dim + 1) values is enough for any block
+u32  pack_decode_block(const pack_t *pack, u64 block, double *out);
+
+static inline size_t pack_raw_bytes(const pack_t *pack)
+{ return (size_t)pack->count * (pack->dim + 1) * sizeof(double); }
@@ -0,0 +1,239 @@
+#include "parareal.h"
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    double *x, *y; // points of one slice, y has dim entries per point
+    u64 count, cap;
+    u32 dim;
+} parareal_buffer_t;
+
+typedef struct
+{
+    parareal_t *pr;
+    const parareal_params_t *pp;
+    const solve_params_t *params;
+    ode_t *odes;
+    const double *from;     // boundaries the fine pass starts on
+    double *fine;           // fine end states per slice
+    double *slice_seconds;
+    u32 first;              // slices before this one have converged
+    parareal_buffer_t *out; // set on the final pass
+    volatile u32 failed;    // some fine slice did not reach its end
+} parareal_job_t;
+
+static int parareal__keep_last(void *user, double x, const double *y, u32 dim)
+{
+    (void)x;
+    memcpy(user, y, dim * sizeof(*y));
+    return 1;
+}
+
+static int parareal__buffer(void *user, double x, const double *y, u32 dim)
+{
+    parareal_buffer_t *b = (parareal_buffer_t *)user;
+    if (b->count >= b->cap)
+    {
+        u64 cap = b->cap ? b->cap * 2 : 1024;
+        double *nx = (double *)realloc(b->x, cap * sizeof(*nx));
+        if (!nx) return 0;
+        b->x = nx;
+        double *ny = (double *)realloc(b->y, cap * dim * sizeof(*ny));
+        if (!ny) return 0;
+        b->y = ny;
+        b->cap = cap;
+    }
+    b->x[b->count] = x;
+    memcpy(b->y + b->count * dim, y, dim * sizeof(*y));
+    b->count ++;
+    return 1;
+}
+
+static inline double parareal__x(const solve_params_t *p, u32 slices, u32 n)
+{
+    return n == slices ? p->x1 : p->x0 + (p->x1 - p->x0) * n / slices;
+}
+
+// the step is rounded so that a whole number of them covers the slice
+static int parareal__propagate(const solver_t *solver, ode_t *ode, const solve_params_t *p, double xa, double xb,
+                               double h, const double *y, double *out, solve_emit_fn emit, void *user)
+{
+    solve_params_t sp = *p;
+    double steps = fmax(1, floor(fabs(xb - xa) / fabs(h) + 0.5));
+    sp.x0 = xa;
+    sp.x1 = xb;
+    sp.h = (xb - xa) / steps;
+    sp.rtol = 0;
+    sp.pool = NULL;
+    memcpy(sp.y0, y, ode->dim * sizeof(*y));
+    if (emit)
+    {
+        // the last point of one slice is the first of the next, so it is kept
+        // once and the final state is read back from the buffer
+        parareal_buffer_t *b = (parareal_buffer_t *)user;
+        if (!solve(solver, ode, &sp, emit, user, NULL) || !b->count)
+            return 0;
+        memcpy(out, b->y + (b->count - 1) * ode->dim, ode->dim * sizeof(*out));
+        return 1;
+    }
+    return solve(solver, ode, &sp, parareal__keep_last, out, NULL);
+}
+
+static void parareal__fine(void *user, u32 begin, u32 end, u32 worker)
+{
+    parareal_job_t *job = (parareal_job_t *)user;
+    const u32 dim = job->pr->dim, slices = job->pr->slices;
+    for (u32 i = begin; i < end; i ++)
+    {
+        u32 n = job->first + i;
+        double start = pf_time();
+        if (!parareal__propagate(&job->pp->fine, &job->odes[worker], job->params,
+                                 parareal__x(job->params, slices, n), parareal__x(job->params, slices, n + 1), job->params->h,
+                                 job->from + n * dim, job->fine + n * dim,
+                                 job->out ? parareal__buffer : NULL, job->out ? &job->out[n] : NULL))
+            pf_atomic_store(&job->failed, 1);
+        job->slice_seconds[n] = pf_time() - start;
+    }
+}
+
+void init_parareal_params(parareal_params_t *pp, u32 slices)
+{
+    memset(pp, 0, sizeof(*pp));
+    find_solver(&pp->coarse, "euler");
+    find_solver(&pp->fine, "rk4");
+    pp->coarse_h = 0;
+    pp->slices = slices;
+    pp->max_iterations = slices;
+}
+
+int run_parareal(parareal_t *pr, pool_t *pool, const ode_t *ode, const solve_params_t *p,
+                 const parareal_params_t *pp, solve_emit_fn emit, void *user)
+{
+    const u32 slices = pp->slices, workers = pool_worker_count(pool);
+    u32 dim = ode->dim;
+    double begin = pf_time();
+
+    memset(pr, 0, sizeof(*pr));
+    if (!slices || p->h == 0)
+        return 0;
+    pr->slices = slices;
+    pr->dim = dim;
+
+    size_t size = (size_t)(slices + 1) * dim;
+    double *old_u  = (double *)calloc(size, sizeof(double));
+    double *coarse = (double *)calloc(size, sizeof(double));
+    double *fine   = (double *)calloc(size, sizeof(double));
+    double *g      = (double *)calloc(dim, sizeof(double));
+    double *slice_seconds = (double *)calloc(slices, sizeof(double));
+    mexp_program_t *progs = (mexp_program_t *)calloc(workers, sizeof(*progs));
+    ode_t *odes = (ode_t *)calloc(workers, sizeof(*odes));
+    pr->u      = (double *)calloc(size, sizeof(double));
+    pr->change = (double *)calloc(pp->max_iterations + 1, sizeof(double));
+
+    int ok = old_u && coarse && fine && g && slice_seconds && progs && odes && pr->u && pr->change;
+    for (u32 w = 0; ok && w < workers; w ++)
+    {
+        ok = mexp_init_program(&progs[w]) && mexp_copy_program(&progs[w], ode->prog);
+        if (!ok) break;
+        init_ode(&odes[w], &progs[w]);
+        memcpy(odes[w].vars, ode->vars, sizeof(ode->vars));
+    }
+
+    const double coarse_h = pp->coarse_h > 0 ? pp->coarse_h : (p->x1 - p->x0) / slices;
+    parareal_job_t job = {pr, pp, p, odes, old_u, fine, slice_seconds, 0, NULL, 0};
+
+    // iteration 0 is the coarse sweep alone
+    if (ok)
+    {
+        memcpy(pr->u, p->y0, dim * sizeof(double));
+        for (u32 n = 0; ok && n < slices; n ++)
+        {
+            ok = parareal__propagate(&pp->coarse, &odes[0], p, parareal__x(p, slices, n), parareal__x(p, slices, n + 1),
+                                     coarse_h, pr->u + n * dim, coarse + n * dim, NULL, NULL);
+            memcpy(pr->u + (n + 1) * dim, coarse + n * dim, dim * sizeof(double));
+        }
+    }
+
+    // after k iterations the first k slices hold the exact fine solution
+    while (ok && pr->iterations < pp->max_iterations && !pr->converged)
+    {
+        memcpy(old_u, pr->u, size * sizeof(double));
+        job.first = pr->iterations;
+        pool_for(pool, slices - job.first, 1, parareal__fine, &job);
+        // the correction needs every fine end state
+        ok = !job.failed;
+        if (pr->iterations == 0)
+            for (u32 n = 0; n < slices; n ++)
+                pr->fine_seconds += slice_seconds[n];
+
+        double change = 0;
+        for (u32 n = job.first; ok && n < slices; n ++)
+        {
+            ok = parareal__propagate(&pp->coarse, &odes[0], p, parareal__x(p, slices, n), parareal__x(p, slices, n + 1),
+                                     coarse_h, pr->u + n * dim, g, NULL, NULL);
+            for (u32 i = 0; i < dim; i ++)
+            {
+                double *u = pr->u + (n + 1) * dim + i;
+                *u = g[i] + fine[n * dim + i] - coarse[n * dim + i];
+                coarse[n * dim + i] = g[i];
+                double r = fabs(*u - old_u[(n + 1) * dim + i]) / (p->atol + p->rtol * fabs(*u));
+                change = r > change ? r : change;
+            }
+        }
+        pr->change[pr->iterations ++] = change;
+        pr->converged = change <= 1 || pr->iterations >= slices;
+    }
+
+    // one more fine pass from the final boundaries produces the trajectory
+    if (ok && emit)
+    {
+        parareal_buffer_t *out = (parareal_buffer_t *)calloc(slices, sizeof(*out));
+        ok = out != NULL;
+        if (ok)
+        {
+            memcpy(old_u, pr->u, size * sizeof(double));
+            job.first = 0;
+            job.out = out;
+            pool_for(pool, slices, 1, parareal__fine, &job);
+            ok = !job.failed;
+            for (u32 n = 0; ok && n < slices; n ++)
+            {
+                ok = out[n].count > 0;
+                for (u64 i = n ? 1 : 0; ok && i < out[n].count; i ++)
+                    ok = emit(user, out[n].x[i], out[n].y + i * dim, dim);
+            }
+        }
+        for (u32 n = 0; out && n < slices; n ++)
+        {
+            free(out[n].x);
+            free(out[n].y);
+        }
+        free(out);
+    }
+
+    for (u32 w = 0; progs && w < workers; w ++)
+    {
+        pr->evals += odes ? odes[w].evals : 0;
+        mexp_free_program(&progs[w]);
+    }
+    free(progs);
+    free(odes);
+    free(old_u);
+    free(coarse);
+    free(fine);
+    free(g);
+    free(slice_seconds);
+    pr->seconds = pf_time() - begin;
+    if (!ok)
+        destroy_parareal(pr);
+    return ok;
+}
+
+void destroy_parareal(parareal_t *pr)
+{
+    free(pr->u);
+    free(pr->change);
+    pr->u = NULL;
+    pr->change = NULL;
+}
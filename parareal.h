@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "solve.h"
+
+// parareal: [x0, x1] is cut into slices, a cheap coarse propagator sweeps
+// them serially while the fine one runs on every slice at once, and
+//   U[n+1] = G(U[n]) + F(U_old[n]) - G(U_old[n])
+// is iterated until the slice boundaries stop moving by more than atol/rtol
+typedef struct parareal_params_t
+{
+    solver_t coarse, fine;
+    double coarse_h;
+    u32 slices;
+    u32 max_iterations;
+} parareal_params_t;
+
+typedef struct parareal_t
+{
+    u32 slices, dim;
+    double *u;       // converged slice boundaries, (slices + 1) * dim
+    u32 iterations;
+    int converged;
+    double *change;  // largest scaled boundary change per iteration
+    double seconds;
+    double fine_seconds; // the first fine sweep run back to back, about a serial fine run
+    u64 evals;
+} parareal_t;
+
+void init_parareal_params(parareal_params_t *pp, u32 slices);
+
+// params->h is the fine step, the fine pass over the converged boundaries is
+// emitted in order when emit is set
+int  run_parareal(parareal_t *pr, pool_t *pool, const ode_t *ode, const solve_params_t *params,
+                  const parareal_params_t *pp, solve_emit_fn emit, void *user);
+void destroy_parareal(parareal_t *pr);
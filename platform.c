@@ -0,0 +1,194 @@
+#include "platform.h"
+
+#ifdef PF_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+static DWORD WINAPI pf__thread_entry(LPVOID param)
+{
+    pf_thread_t *thread = (pf_thread_t *)param;
+    thread->fn(thread->user);
+    return 0;
+}
+
+int pf_create_thread(pf_thread_t *thread, pf_thread_fn fn, void *user)
+{
+    thread->fn = fn;
+    thread->user = user;
+    thread->handle = CreateThread(NULL, 0, pf__thread_entry, thread, 0, NULL);
+    return thread->handle != NULL;
+}
+
+void pf_join_thread(pf_thread_t *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    thread->handle = NULL;
+}
+
+int  pf_init_mutex(pf_mutex_t *mutex)    { InitializeSRWLock((PSRWLOCK)&mutex->ptr); return 1; }
+void pf_destroy_mutex(pf_mutex_t *mutex) { (void)mutex; }
+void pf_lock(pf_mutex_t *mutex)          { AcquireSRWLockExclusive((PSRWLOCK)&mutex->ptr); }
+void pf_unlock(pf_mutex_t *mutex)        { ReleaseSRWLockExclusive((PSRWLOCK)&mutex->ptr); }
+
+int  pf_init_cond(pf_cond_t *cond)       { InitializeConditionVariable((PCONDITION_VARIABLE)&cond->ptr); return 1; }
+void pf_destroy_cond(pf_cond_t *cond)    { (void)cond; }
+void pf_wait(pf_cond_t *cond, pf_mutex_t *mutex)
+{ SleepConditionVariableSRW((PCONDITION_VARIABLE)&cond->ptr, (PSRWLOCK)&mutex->ptr, INFINITE, 0); }
+void pf_signal(pf_cond_t *cond)          { WakeConditionVariable((PCONDITION_VARIABLE)&cond->ptr); }
+void pf_broadcast(pf_cond_t *cond)       { WakeAllConditionVariable((PCONDITION_VARIABLE)&cond->ptr); }
+
+u32 pf_atomic_add(volatile u32 *value, u32 add) { return (u32)InterlockedExchangeAdd((volatile LONG *)value, (LONG)add); }
+u32 pf_atomic_load(volatile u32 *value)         { return (u32)InterlockedCompareExchange((volatile LONG *)value, 0, 0); }
+void pf_atomic_store(volatile u32 *value, u32 v) { InterlockedExchange((volatile LONG *)value, (LONG)v); }
+
+int pf_map_file(pf_mapping_t *mapping, const char *file_name)
+{
+    LARGE_INTEGER size;
+    memset(mapping, 0, sizeof(*mapping));
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+    mapping->data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (!mapping->data)
+    {
+        CloseHandle(map);
+        CloseHandle(file);
+        return 0;
+    }
+    mapping->size = (u64)size.QuadPart;
+    mapping->file = file;
+    mapping->map  = map;
+    return 1;
+}
+
+void pf_unmap_file(pf_mapping_t *mapping)
+{
+    if (mapping->data) UnmapViewOfFile(mapping->data);
+    if (mapping->map)  CloseHandle(mapping->map);
+    if (mapping->file) CloseHandle(mapping->file);
+    memset(mapping, 0, sizeof(*mapping));
+}
+
+u32 pf_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+int pf_replace_file(const char *from, const char *to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+double pf_time(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+}
+
+#else
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void *pf__thread_entry(void *param)
+{
+    pf_thread_t *thread = (pf_thread_t *)param;
+    thread->fn(thread->user);
+    return NULL;
+}
+
+int pf_create_thread(pf_thread_t *thread, pf_thread_fn fn, void *user)
+{
+    thread->fn = fn;
+    thread->user = user;
+    return pthread_create(&thread->handle, NULL, pf__thread_entry, thread) == 0;
+}
+
+void pf_join_thread(pf_thread_t *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+int  pf_init_mutex(pf_mutex_t *mutex)    { return pthread_mutex_init(&mutex->m, NULL) == 0; }
+void pf_destroy_mutex(pf_mutex_t *mutex) { pthread_mutex_destroy(&mutex->m); }
+void pf_lock(pf_mutex_t *mutex)          { pthread_mutex_lock(&mutex->m); }
+void pf_unlock(pf_mutex_t *mutex)        { pthread_mutex_unlock(&mutex->m); }
+
+int  pf_init_cond(pf_cond_t *cond)       { return pthread_cond_init(&cond->c, NULL) == 0; }
+void pf_destroy_cond(pf_cond_t *cond)    { pthread_cond_destroy(&cond->c); }
+void pf_wait(pf_cond_t *cond, pf_mutex_t *mutex) { pthread_cond_wait(&cond->c, &mutex->m); }
+void pf_signal(pf_cond_t *cond)          { pthread_cond_signal(&cond->c); }
+void pf_broadcast(pf_cond_t *cond)       { pthread_cond_broadcast(&cond->c); }
+
+u32 pf_atomic_add(volatile u32 *value, u32 add)  { return __atomic_fetch_add(value, add, __ATOMIC_ACQ_REL); }
+u32 pf_atomic_load(volatile u32 *value)          { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+void pf_atomic_store(volatile u32 *value, u32 v) { __atomic_store_n(value, v, __ATOMIC_RELEASE); }
+
+int pf_map_file(pf_mapping_t *mapping, const char *file_name)
+{
+    struct stat st;
+    memset(mapping, 0, sizeof(*mapping));
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+    mapping->data = data;
+    mapping->size = (u64)st.st_size;
+    return 1;
+}
+
+void pf_unmap_file(pf_mapping_t *mapping)
+{
+    if (mapping->data)
+        munmap((void *)mapping->data, (size_t)mapping->size);
+    memset(mapping, 0, sizeof(*mapping));
+}
+
+u32 pf_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (u32)n : 1;
+}
+
+int pf_replace_file(const char *from, const char *to)
+{
+    return rename(from, to) == 0;
+}
+
+double pf_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
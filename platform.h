@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+
+typedef void (*pf_thread_fn)(void *user);
+
+#ifdef PF_WINDOWS
+typedef struct { void *handle; pf_thread_fn fn; void *user; } pf_thread_t;
+typedef struct { void *ptr; } pf_mutex_t;
+typedef struct { void *ptr; } pf_cond_t;
+#else
+#include <pthread.h>
+typedef struct { pthread_t handle; pf_thread_fn fn; void *user; } pf_thread_t;
+typedef struct { pthread_mutex_t m; } pf_mutex_t;
+typedef struct { pthread_cond_t c; } pf_cond_t;
+#endif
+
+// the thread struct must stay alive until pf_join_thread returns
+int  pf_create_thread(pf_thread_t *thread, pf_thread_fn fn, void *user);
+void pf_join_thread(pf_thread_t *thread);
+
+int  pf_init_mutex(pf_mutex_t *mutex);
+void pf_destroy_mutex(pf_mutex_t *mutex);
+void pf_lock(pf_mutex_t *mutex);
+void pf_unlock(pf_mutex_t *mutex);
+
+int  pf_init_cond(pf_cond_t *cond);
+void pf_destroy_cond(pf_cond_t *cond);
+void pf_wait(pf_cond_t *cond, pf_mutex_t *mutex);
+void pf_signal(pf_cond_t *cond);
+void pf_broadcast(pf_cond_t *cond);
+
+u32 pf_atomic_add(volatile u32 *value, u32 add);
+u32 pf_atomic_load(volatile u32 *value);
+void pf_atomic_store(volatile u32 *value, u32 v);
+
+// read-only view of a whole file, pages are only touched when accessed
+typedef struct pf_mapping_t
+{
+    const void *data;
+    u64 size;
+    void *file;
+    void *map;
+} pf_mapping_t;
+
+int  pf_map_file(pf_mapping_t *mapping, const char *file_name);
+void pf_unmap_file(pf_mapping_t *mapping);
+// moves from over to, replacing to in one step where the system can
+int  pf_replace_file(const char *from, const char *to);
+
+u32 pf_cpu_count(void);
+double pf_time(void);
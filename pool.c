@@ -0,0 +1,130 @@
+#include "pool.h"
+#include <stdlib.h>
+
+struct pool_worker_t
+{
+    pool_t *pool;
+    pf_thread_t thread;
+    u32 index;
+};
+
+static void pool__run_job(pool_t *pool, u32 worker)
+{
+    const u32 grain = pool->job.grain;
+    while (1)
+    {
+        u32 begin = pf_atomic_add(&pool->job.next, grain);
+        if (begin >= pool->job.count) break;
+        u32 end = begin + grain;
+        if (end > pool->job.count) end = pool->job.count;
+        pool->job.fn(pool->job.user, begin, end, worker);
+    }
+}
+
+static void pool__thread(void *user)
+{
+    pool_worker_t *worker = (pool_worker_t *)user;
+    pool_t *pool = worker->pool;
+    u32 seen = 0;
+
+    pf_lock(&pool->lock);
+    while (1)
+    {
+        while (!pool->quit && pool->generation == seen)
+            pf_wait(&pool->wake, &pool->lock);
+        if (pool->quit) break;
+        seen = pool->generation;
+        pf_unlock(&pool->lock);
+
+        pool__run_job(pool, worker->index);
+
+        pf_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pf_signal(&pool->done);
+    }
+    pf_unlock(&pool->lock);
+}
+
+int init_pool(pool_t *pool, u32 worker_count)
+{
+    if (worker_count == 0)
+        worker_count = pf_cpu_count();
+
+    pool->worker_count = worker_count;
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->quit = 0;
+    pool->job.fn = NULL;
+    pool->job.count = 0;
+    pool->job.next = 0;
+
+    if (!pf_init_mutex(&pool->lock)) return 0;
+    if (!pf_init_cond(&pool->wake)) return 0;
+    if (!pf_init_cond(&pool->done)) return 0;
+
+    // worker 0 is whoever calls pool_for
+    pool->workers = (pool_worker_t *)calloc(worker_count, sizeof(*pool->workers));
+    if (!pool->workers) return 0;
+    for (u32 i = 1; i < worker_count; i ++)
+    {
+        pool->workers[i].pool  = pool;
+        pool->workers[i].index = i;
+        if (!pf_create_thread(&pool->workers[i].thread, pool__thread, &pool->workers[i]))
+        {
+            pool->worker_count = i;
+            break;
+        }
+    }
+    return 1;
+}
+
+void destroy_pool(pool_t *pool)
+{
+    if (!pool->workers)
+        return;
+    pf_lock(&pool->lock);
+    pool->quit = 1;
+    pf_broadcast(&pool->wake);
+    pf_unlock(&pool->lock);
+    for (u32 i = 1; i < pool->worker_count; i ++)
+        pf_join_thread(&pool->workers[i].thread);
+    free(pool->workers);
+    pool->workers = NULL;
+    pool->worker_count = 0;
+    pf_destroy_cond(&pool->done);
+    pf_destroy_cond(&pool->wake);
+    pf_destroy_mutex(&pool->lock);
+}
+
+void pool_for(pool_t *pool, u32 count, u32 grain, pool_fn fn, void *user)
+{
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+
+    if (pool->worker_count <= 1 || count <= grain)
+    {
+        for (u32 begin = 0; begin < count; begin += grain)
+            fn(user, begin, begin + grain < count ? begin + grain : count, 0);
+        return;
+    }
+
+    pf_lock(&pool->lock);
+    pool->job.fn    = fn;
+    pool->job.user  = user;
+    pool->job.count = count;
+    pool->job.grain = grain;
+    pf_atomic_store(&pool->job.next, 0);
+    pool->busy = pool->worker_count - 1;
+    pool->generation ++;
+    pf_broadcast(&pool->wake);
+    pf_unlock(&pool->lock);
+
+    pool__run_job(pool, 0);
+
+    pf_lock(&pool->lock);
+    while (pool->busy)
+        pf_wait(&pool->done, &pool->lock);
+    pf_unlock(&pool->lock);
+}
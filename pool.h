@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.h"
+#include "platform.h"
+
+// fn is called with disjoint [begin, end) ranges, worker < pool_worker_count()
+typedef void (*pool_fn)(void *user, u32 begin, u32 end, u32 worker);
+
+typedef struct pool_worker_t pool_worker_t;
+
+typedef struct pool_t
+{
+    pool_worker_t *workers;
+    u32 worker_count;
+    pf_mutex_t lock;
+    pf_cond_t wake, done;
+    u32 generation;
+    u32 busy;
+    int quit;
+
+    struct
+    {
+        pool_fn fn;
+        void *user;
+        u32 count, grain;
+        volatile u32 next;
+    } job;
+} pool_t;
+
+int  init_pool(pool_t *pool, u32 worker_count);
+void destroy_pool(pool_t *pool);
+void pool_for(pool_t *pool, u32 count, u32 grain, pool_fn fn, void *user);
+
+static inline u32 pool_worker_count(const pool_t *pool)
+{ return pool->worker_count; }
@@ -20,9 +20,10 @@ project "euler-rk-graph"
   objdir "bin/%{cfg.buildcfg}/obj"
 
   files { "**.c", "**.h" }
+  removefiles { "batch.c", "tests/**" }
 
   filter "not system:windows"
-    links { "SDL2", "SDL2main", "m" }
+    links { "SDL2", "SDL2main", "m", "pthread" }
 
   filter "system:windows"
     defines "PF_WINDOWS"
@@ -33,3 +34,41 @@ project "euler-rk-graph"
     postbuildcommands { "copy .\\SDL2-2.26.1\\lib\\x64\\SDL2.dll bin\\%{cfg.buildcfg}\\" }
 
   filter {}
+
+-- headless integrator, no SDL needed
+project "euler-rk-batch"
+  kind "ConsoleApp"
+  language "C"
+
+  targetdir "bin/%{cfg.buildcfg}"
+  objdir "bin/%{cfg.buildcfg}/obj-batch"
+
+  files { "**.c", "**.h" }
+  removefiles { "main.c", "graphics.*", "events.*", "png.*", "tests/**" }
+
+  filter "not system:windows"
+    links { "m", "pthread" }
+
+  filter "system:windows"
+    defines "PF_WINDOWS"
+
+  filter {}
+
+-- regression tests, run bin/<config>/euler-rk-test
+project "euler-rk-test"
+  kind "ConsoleApp"
+  language "C"
+
+  targetdir "bin/%{cfg.buildcfg}"
+  objdir "bin/%{cfg.buildcfg}/obj-test"
+
+  files { "**.c", "**.h" }
+  removefiles { "main.c", "batch.c", "graphics.*", "events.*", "png.*" }
+
+  filter "not system:windows"
+    links { "m", "pthread" }
+
+  filter "system:windows"
+    defines "PF_WINDOWS"
+
+  filter {}
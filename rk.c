@@ -0,0 +1,399 @@
+#include "rk.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#define RK_INLINE __forceinline
+#else
+#define RK_INLINE inline __attribute__((always_inline))
+#endif
+
+// once inlined with a constant tableau every loop bound and coefficient is
+// known, so the compiler unrolls the stages and drops the zero terms
+static RK_INLINE void rk__step(const rk_tableau_t *t, ode_t *ode, double x, const double *y, double h, double *out, double *err)
+{
+    double k[RK_MAX_STAGES][ODE_MAX_DIM];
+    double tmp[ODE_MAX_DIM];
+    const u32 n = ode->dim;
+
+    ode_eval(ode, x, y, k[0]);
+    for (u32 i = 1; i < t->stages; i ++)
+    {
+        for (u32 d = 0; d < n; d ++)
+            tmp[d] = y[d];
+        for (u32 j = 0; j < i; j ++)
+        {
+            const double a = t->a[i][j];
+            if (a == 0) continue;
+            for (u32 d = 0; d < n; d ++)
+                tmp[d] += h * a * k[j][d];
+        }
+        ode_eval(ode, x + t->c[i] * h, tmp, k[i]);
+    }
+
+    for (u32 d = 0; d < n; d ++)
+    {
+        double acc = 0;
+        for (u32 i = 0; i < t->stages; i ++)
+            if (t->b[i] != 0) acc += t->b[i] * k[i][d];
+        out[d] = y[d] + h * acc;
+    }
+
+    if (!err)
+        return;
+    for (u32 d = 0; d < n; d ++)
+    {
+        double acc = 0;
+        if (t->embedded)
+            for (u32 i = 0; i < t->stages; i ++)
+                if (t->e[i] != 0) acc += t->e[i] * k[i][d];
+        err[d] = h * acc;
+    }
+}
+
+static const rk_tableau_t rk__euler =
+{
+    "EULER", 1, 1, 0,
+    .b = {1},
+};
+
+static const rk_tableau_t rk__midpoint =
+{
+    "MIDPOINT", 2, 2, 0,
+    .a = {{0}, {1.0/2}},
+    .b = {0, 1},
+    .c = {0, 1.0/2},
+};
+
+// heun's method
+static const rk_tableau_t rk__rk2 =
+{
+    "RK2", 2, 2, 0,
+    .a = {{0}, {1}},
+    .b = {1.0/2, 1.0/2},
+    .c = {0, 1},
+};
+
+static const rk_tableau_t rk__ralston =
+{
+    "RALSTON", 2, 2, 0,
+    .a = {{0}, {2.0/3}},
+    .b = {1.0/4, 3.0/4},
+    .c = {0, 2.0/3},
+};
+
+static const rk_tableau_t rk__rk3 =
+{
+    "RK3", 3, 3, 0,
+    .a = {{0}, {1.0/2}, {-1, 2}},
+    .b = {1.0/6, 2.0/3, 1.0/6},
+    .c = {0, 1.0/2, 1},
+};
+
+static const rk_tableau_t rk__ssprk3 =
+{
+    "SSPRK3", 3, 3, 0,
+    .a = {{0}, {1}, {1.0/4, 1.0/4}},
+    .b = {1.0/6, 1.0/6, 2.0/3},
+    .c = {0, 1, 1.0/2},
+};
+
+static const rk_tableau_t rk__rk4 =
+{
+    "RK4", 4, 4, 0,
+    .a = {{0}, {1.0/2}, {0, 1.0/2}, {0, 0, 1}},
+    .b = {1.0/6, 1.0/3, 1.0/3, 1.0/6},
+    .c = {0, 1.0/2, 1.0/2, 1},
+};
+
+static const rk_tableau_t rk__rk38 =
+{
+    "RK38", 4, 4, 0,
+    .a = {{0}, {1.0/3}, {-1.0/3, 1}, {1, -1, 1}},
+    .b = {1.0/8, 3.0/8, 3.0/8, 1.0/8},
+    .c = {0, 1.0/3, 2.0/3, 1},
+};
+
+static const rk_tableau_t rk__bs23 =
+{
+    "BS23", 4, 3, 1,
+    .a = {{0}, {1.0/2}, {0, 3.0/4}, {2.0/9, 1.0/3, 4.0/9}},
+    .b = {2.0/9, 1.0/3, 4.0/9, 0},
+    .c = {0, 1.0/2, 3.0/4, 1},
+    .e = {2.0/9 - 7.0/24, 1.0/3 - 1.0/4, 4.0/9 - 1.0/3, -1.0/8},
+};
+
+static const rk_tableau_t rk__cashkarp =
+{
+    "CASHKARP", 6, 5, 1,
+    .a =
+    {
+        {0},
+        {1.0/5},
+        {3.0/40, 9.0/40},
+        {3.0/10, -9.0/10, 6.0/5},
+        {-11.0/54, 5.0/2, -70.0/27, 35.0/27},
+        {1631.0/55296, 175.0/512, 575.0/13824, 44275.0/110592, 253.0/4096},
+    },
+    .b = {37.0/378, 0, 250.0/621, 125.0/594, 0, 512.0/1771},
+    .c = {0, 1.0/5, 3.0/10, 3.0/5, 1, 7.0/8},
+    .e =
+    {
+        37.0/378 - 2825.0/27648, 0, 250.0/621 - 18575.0/48384,
+        125.0/594 - 13525.0/55296, -277.0/14336, 512.0/1771 - 1.0/4,
+    },
+};
+
+static const rk_tableau_t rk__dopri5 =
+{
+    "DOPRI5", 7, 5, 1,
+    .a =
+    {
+        {0},
+        {1.0/5},
+        {3.0/40, 9.0/40},
+        {44.0/45, -56.0/15, 32.0/9},
+        {19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729},
+        {9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656},
+        {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84},
+    },
+    .b = {35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84, 0},
+    .c = {0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1, 1},
+    .e =
+    {
+        35.0/384 - 5179.0/57600, 0, 500.0/1113 - 7571.0/16695, 125.0/192 - 393.0/640,
+        -2187.0/6784 + 92097.0/339200, 11.0/84 - 187.0/2100, -1.0/40,
+    },
+};
+
+#define RK_BUILTINS(X) \
+    X(euler)    \
+    X(midpoint) \
+    X(rk2)      \
+    X(ralston)  \
+    X(rk3)      \
+    X(ssprk3)   \
+    X(rk4)      \
+    X(rk38)     \
+    X(bs23)     \
+    X(cashkarp) \
+    X(dopri5)
+
+#define X(N) static void rk__kernel_##N(const rk_tableau_t *t, ode_t *ode, double x, const double *y, double h, double *out, double *err) \
+    { (void)t; rk__step(&rk__##N, ode, x, y, h, out, err); }
+RK_BUILTINS(X)
+#undef X
+
+static const rk_method_t rk__builtins[] =
+{
+#define X(N) {&rk__##N, rk__kernel_##N},
+    RK_BUILTINS(X)
+#undef X
+};
+
+u32 rk_builtin_count(void)
+{
+    return sizeof(rk__builtins) / sizeof(rk__builtins[0]);
+}
+
+const rk_method_t *rk_builtin(u32 index)
+{
+    if (index >= rk_builtin_count())
+        return NULL;
+    return &rk__builtins[index];
+}
+
+const rk_method_t *rk_find_method(const char *name)
+{
+    for (u32 i = 0; i < rk_builtin_count(); i ++)
+    {
+        const char *a = rk__builtins[i].tableau->name, *b = name;
+        while (*a && toupper((u8)*a) == toupper((u8)*b)) { a ++; b ++; }
+        if (!*a && !*b)
+            return &rk__builtins[i];
+    }
+    return NULL;
+}
+
+void rk_step_generic(const rk_tableau_t *tableau, ode_t *ode, double x, const double *y, double h, double *out, double *err)
+{
+    rk__step(tableau, ode, x, y, h, out, err);
+}
+
+//
+// tableau files, one keyword per line followed by its values:
+//   name RALSTON
+//   order 2
+//   a 2/3            (one line per stage after the first)
+//   b 1/4 3/4
+//   c 0 2/3          (optional, defaults to the row sums of a)
+//   bhat ...         (optional, embedded weights)
+// values can be written as fractions, '#' starts a comment
+//
+
+static int rk__parse_number(const char **at, const char *end, double *v)
+{
+    char buf[64];
+    const char *p = *at;
+    while (p < end && (*p == ' ' || *p == '\t')) p ++;
+    int len = 0;
+    while (p < end && len < (int)sizeof(buf) - 1 && !isspace((u8)*p) && *p != '#')
+        buf[len ++] = *p ++;
+    buf[len] = 0;
+    *at = p;
+    if (len == 0)
+        return 0;
+
+    char *slash = strchr(buf, '/');
+    char *tail;
+    if (slash) *slash = 0;
+    *v = strtod(buf, &tail);
+    if (*tail) return -1;
+    if (slash)
+    {
+        double d = strtod(slash + 1, &tail);
+        if (*tail || d == 0) return -1;
+        *v /= d;
+    }
+    return 1;
+}
+
+int rk_parse_tableau(rk_tableau_t *t, const char *text, size_t length, char *error, size_t error_length)
+{
+    const char *at = text, *last = text + length;
+    double bhat[RK_MAX_STAGES];
+    int has_b = 0, has_c = 0, has_bhat = 0;
+    u32 rows = 1, line = 0;
+
+    memset(t, 0, sizeof(*t));
+    snprintf(t->name, sizeof(t->name), "CUSTOM");
+
+    while (at < last)
+    {
+        const char *eol = at;
+        while (eol < last && *eol != '\n') eol ++;
+        line ++;
+
+        char key[16];
+        int klen = 0;
+        while (at < eol && isspace((u8)*at)) at ++;
+        while (at < eol && !isspace((u8)*at) && klen < (int)sizeof(key) - 1)
+            key[klen ++] = *at ++;
+        key[klen] = 0;
+
+        if (klen == 0 || key[0] == '#')
+        {
+            at = eol + 1;
+            continue;
+        }
+
+        if (!strcmp(key, "name"))
+        {
+            while (at < eol && isspace((u8)*at)) at ++;
+            int n = 0;
+            while (at + n < eol && !isspace((u8)at[n]) && n < RK_NAME_LENGTH - 1) n ++;
+            memcpy(t->name, at, n);
+            t->name[n] = 0;
+            for (int i = 0; i < n; i ++)
+                t->name[i] = toupper((u8)t->name[i]);
+            at = eol + 1;
+            continue;
+        }
+
+        double values[RK_MAX_STAGES];
+        u32 count = 0;
+        int r = 0;
+        while (count < RK_MAX_STAGES && (r = rk__parse_number(&at, eol, &values[count])) == 1)
+            count ++;
+        if (r == -1)
+        {
+            snprintf(error, error_length, "line %u: bad number", line);
+            return 0;
+        }
+        // a value past the limit would otherwise be dropped without a word
+        double extra;
+        if (count == RK_MAX_STAGES && rk__parse_number(&at, eol, &extra) != 0)
+        {
+            snprintf(error, error_length, "line %u: more than %u values, at most %u stages", line, RK_MAX_STAGES, RK_MAX_STAGES);
+            return 0;
+        }
+
+        if (!strcmp(key, "order"))
+            t->order = count ? (u32)values[0] : 0;
+        else if (!strcmp(key, "a"))
+        {
+            if (rows >= RK_MAX_STAGES)
+            {
+                snprintf(error, error_length, "line %u: more than %u rows of a, at most %u stages", line, RK_MAX_STAGES - 1, RK_MAX_STAGES);
+                return 0;
+            }
+            if (count > rows)
+            {
+                snprintf(error, error_length, "line %u: row %u of a has %u entries", line, rows, count);
+                return 0;
+            }
+            for (u32 j = 0; j < count; j ++)
+                t->a[rows][j] = values[j];
+            rows ++;
+        }
+        else if (!strcmp(key, "b"))    { memcpy(t->b, values, count * sizeof(double)); t->stages = count; has_b = 1; }
+        else if (!strcmp(key, "c"))    { memcpy(t->c, values, count * sizeof(double)); has_c = count; }
+        else if (!strcmp(key, "bhat")) { memcpy(bhat, values, count * sizeof(double)); has_bhat = count; }
+        else
+        {
+            snprintf(error, error_length, "line %u: unknown key '%s'", line, key);
+            return 0;
+        }
+        at = eol + 1;
+    }
+
+    if (!has_b || t->stages == 0)
+    {
+        snprintf(error, error_length, "missing weights 'b'");
+        return 0;
+    }
+    if (rows != t->stages)
+    {
+        snprintf(error, error_length, "%u stages but %u rows of 'a'", t->stages, rows - 1);
+        return 0;
+    }
+    if (has_c && has_c != (int)t->stages)
+    {
+        snprintf(error, error_length, "'c' needs %u entries", t->stages);
+        return 0;
+    }
+    if (has_bhat && has_bhat != (int)t->stages)
+    {
+        snprintf(error, error_length, "'bhat' needs %u entries", t->stages);
+        return 0;
+    }
+
+    if (!has_c)
+        for (u32 i = 0; i < t->stages; i ++)
+            for (u32 j = 0; j < i; j ++)
+                t->c[i] += t->a[i][j];
+    if (has_bhat)
+    {
+        t->embedded = 1;
+        for (u32 i = 0; i < t->stages; i ++)
+            t->e[i] = t->b[i] - bhat[i];
+    }
+    if (t->order == 0)
+        t->order = 1;
+    return 1;
+}
+
+int rk_load_tableau(rk_tableau_t *tableau, const char *file_name, char *error, size_t error_length)
+{
+    size_t size;
+    u8 *text = read_entire_file(file_name, &size);
+    if (!text)
+    {
+        snprintf(error, error_length, "could not read '%s'", file_name);
+        return 0;
+    }
+    int ok = rk_parse_tableau(tableau, (const char *)text, size, error, error_length);
+    free(text);
+    return ok;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+#include "ode.h"
+
+#define RK_MAX_STAGES 16
+#define RK_NAME_LENGTH 16
+
+// explicit butcher tableau, a is strictly lower triangular,
+// e holds b - bhat when the method carries an embedded error estimate
+typedef struct rk_tableau_t
+{
+    char name[RK_NAME_LENGTH];
+    u32 stages;
+    u32 order;
+    int embedded;
+    double a[RK_MAX_STAGES][RK_MAX_STAGES];
+    double b[RK_MAX_STAGES];
+    double c[RK_MAX_STAGES];
+    double e[RK_MAX_STAGES];
+} rk_tableau_t;
+
+// advances y by one step of size h into out, err may be NULL
+typedef void (*rk_kernel_t)(const rk_tableau_t *tableau, ode_t *ode, double x, const double *y, double h, double *out, double *err);
+
+typedef struct rk_method_t
+{
+    const rk_tableau_t *tableau;
+    rk_kernel_t kernel;
+} rk_method_t;
+
+u32 rk_builtin_count(void);
+const rk_method_t *rk_builtin(u32 index);
+const rk_method_t *rk_find_method(const char *name);
+
+void rk_step_generic(const rk_tableau_t *tableau, ode_t *ode, double x, const double *y, double h, double *out, double *err);
+int  rk_parse_tableau(rk_tableau_t *tableau, const char *text, size_t length, char *error, size_t error_length);
+int  rk_load_tableau(rk_tableau_t *tableau, const char *file_name, char *error, size_t error_length);
+
+static inline void rk_step(const rk_method_t *method, ode_t *ode, double x, const double *y, double h, double *out, double *err)
+{ method->kernel(method->tableau, ode, x, y, h, out, err); }
@@ -0,0 +1,298 @@
+#include "rkc.h"
+#include "sens.h"
+#include <math.h>
+#include <stdio.h>
+
+#define RKC_SAFETY 0.8
+#define RKC_MIN_SCALE 0.1
+#define RKC_MAX_SCALE 10.0
+#define RKC_RADIUS_ITERATIONS 20
+#define RKC_RADIUS_SLACK 1.2
+// damping of the polynomials, it keeps the stability region away from the
+// real axis between its touching points
+#define RKC1_DAMPING 0.05
+#define RKC2_DAMPING (2.0 / 13)
+
+typedef struct rkc_t
+{
+    u32 order;
+    u32 dim;
+    sens_t sens; // one direction, the jacobian-vector products
+    double v[ODE_MAX_DIM]; // eigenvector guess, kept between estimates
+    double rho;
+} rkc_t;
+
+// |df/dy| along v grows toward rho as v turns to the dominant eigenvector
+static void rkc__radius(rkc_t *r, ode_t *ode, double x, const double *y, const double *f)
+{
+    double jv[ODE_MAX_DIM], dydx[ODE_MAX_DIM], norm = 0, rho = 0;
+    for (u32 i = 0; i < r->dim; i ++)
+        norm += r->v[i] * r->v[i];
+    if (norm == 0)
+    {
+        // start from f unless the state is at rest
+        for (u32 i = 0; i < r->dim; i ++)
+            norm += f[i] * f[i];
+        for (u32 i = 0; i < r->dim; i ++)
+            r->v[i] = norm > 0 ? f[i] : 1;
+        norm = norm > 0 ? norm : r->dim;
+    }
+    norm = sqrt(norm);
+    for (u32 i = 0; i < r->dim; i ++)
+        r->v[i] /= norm;
+
+    for (u32 it = 0; it < RKC_RADIUS_ITERATIONS; it ++)
+    {
+        double n = 0;
+        sens_eval(&r->sens, ode, x, y, r->v, dydx, jv);
+        for (u32 i = 0; i < r->dim; i ++)
+            n += jv[i] * jv[i];
+        n = sqrt(n);
+        if (n == 0 || !isfinite(n))
+        {
+            // v is in the kernel, try another one next time
+            memset(r->v, 0, sizeof(r->v));
+            break;
+        }
+        for (u32 i = 0; i < r->dim; i ++)
+            r->v[i] = jv[i] / n;
+        int done = fabs(n - rho) <= 0.01 * n;
+        rho = n;
+        if (done)
+            break;
+    }
+    r->rho = RKC_RADIUS_SLACK * rho;
+}
+
+// chebyshev values and the first two derivatives at w0, walked to stage s
+typedef struct
+{
+    double t, dt, ddt;
+} rkc_cheb_t;
+
+static void rkc__cheb(double w0, u32 s, rkc_cheb_t *c)
+{
+    c[0].t = 1;  c[0].dt = 0; c[0].ddt = 0;
+    c[1].t = w0; c[1].dt = 1; c[1].ddt = 0;
+    for (u32 j = 2; j <= s; j ++)
+    {
+        c[j].t   = 2 * w0 * c[j - 1].t - c[j - 2].t;
+        c[j].dt  = 2 * c[j - 1].t + 2 * w0 * c[j - 1].dt - c[j - 2].dt;
+        c[j].ddt = 4 * c[j - 1].dt + 2 * w0 * c[j - 1].ddt - c[j - 2].ddt;
+    }
+}
+
+static double rkc__w0(u32 order, u32 s)
+{
+    return 1 + (order == 1 ? RKC1_DAMPING : RKC2_DAMPING) / ((double)s * s);
+}
+
+// the polynomial stays bounded while w0 + w1 z >= -1
+static double rkc__beta(u32 order, u32 s)
+{
+    const double w0 = rkc__w0(order, s);
+    rkc_cheb_t a = {1, 0, 0}, b = {w0, 1, 0};
+    for (u32 j = 2; j <= s; j ++)
+    {
+        rkc_cheb_t c = {2 * w0 * b.t - a.t, 2 * b.t + 2 * w0 * b.dt - a.dt, 4 * b.dt + 2 * w0 * b.ddt - a.ddt};
+        a = b;
+        b = c;
+    }
+    const double w1 = order == 1 ? b.t / b.dt : b.dt / b.ddt;
+    return (1 + w0) / w1;
+}
+
+static u32 rkc__stages(u32 order, double hrho)
+{
+    // the asymptotic bound as a first guess, then up to the exact one
+    u32 s = (u32)sqrt(hrho / (order == 1 ? 1.9 : 0.65));
+    s = s < 2 ? 2 : s > RKC_MAX_STAGES ? RKC_MAX_STAGES : s;
+    while (s < RKC_MAX_STAGES && rkc__beta(order, s) < hrho)
+        s ++;
+    return s;
+}
+
+// one step of s stages from f0 = f(x, y)
+static void rkc__step(u32 order, u32 s, ode_t *ode, double x, const double *y, const double *f0, double h, double *out)
+{
+    rkc_cheb_t c[RKC_MAX_STAGES + 1];
+    const u32 dim = ode->dim;
+    double y1[ODE_MAX_DIM], y2[ODE_MAX_DIM], f[ODE_MAX_DIM];
+    const double w0 = rkc__w0(order, s);
+    rkc__cheb(w0, s, c);
+
+    if (order == 1)
+    {
+        const double w1 = c[s].t / c[s].dt;
+        double c1 = w1 / w0, c2 = 0; // stage abscissae, y' = 1 through the recurrence
+        for (u32 i = 0; i < dim; i ++)
+        {
+            y2[i] = y[i];
+            y1[i] = y[i] + c1 * h * f0[i];
+        }
+        for (u32 j = 2; j <= s; j ++)
+        {
+            const double mu = 2 * w0 * c[j - 1].t / c[j].t, nu = -c[j - 2].t / c[j].t, mut = 2 * w1 * c[j - 1].t / c[j].t;
+            ode_eval(ode, x + c1 * h, y1, f);
+            for (u32 i = 0; i < dim; i ++)
+            {
+                double v = mu * y1[i] + nu * y2[i] + mut * h * f[i];
+                y2[i] = y1[i];
+                y1[i] = v;
+            }
+            double cj = mu * c1 + nu * c2 + mut;
+            c2 = c1;
+            c1 = cj;
+        }
+    }
+    else
+    {
+        // b_j = T_j'' / T_j'^2 from j = 2 on, b_0 = b_1 = b_2 and a_j = 1 - b_j T_j
+        const double w1 = c[s].dt / c[s].ddt;
+        #define RKC_B(j) ((j) < 2 ? c[2].ddt / (c[2].dt * c[2].dt) : c[j].ddt / (c[j].dt * c[j].dt))
+        double c1 = RKC_B(1) * w1, c2 = 0;
+        for (u32 i = 0; i < dim; i ++)
+        {
+            y2[i] = y[i];
+            y1[i] = y[i] + c1 * h * f0[i];
+        }
+        for (u32 j = 2; j <= s; j ++)
+        {
+            const double bj = RKC_B(j), bj1 = RKC_B(j - 1), bj2 = RKC_B(j - 2);
+            const double aj1 = 1 - bj1 * c[j - 1].t;
+            const double mu = 2 * w0 * bj / bj1, nu = -bj / bj2, mut = 2 * w1 * bj / bj1, gamt = -aj1 * mut;
+            ode_eval(ode, x + c1 * h, y1, f);
+            for (u32 i = 0; i < dim; i ++)
+            {
+                double v = (1 - mu - nu) * y[i] + mu * y1[i] + nu * y2[i] + mut * h * f[i] + gamt * h * f0[i];
+                y2[i] = y1[i];
+                y1[i] = v;
+            }
+            double cj = mu * c1 + nu * c2 + mut + gamt;
+            c2 = c1;
+            c1 = cj;
+        }
+        #undef RKC_B
+    }
+    memcpy(out, y1, dim * sizeof(*out));
+}
+
+static int rkc__fixed(rkc_t *r, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    double y[ODE_MAX_DIM], f0[ODE_MAX_DIM];
+    memcpy(y, p->y0, sizeof(y));
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, p->x0, y, ode->dim))
+        return 0;
+    for (u64 i = 0; i < n; i ++)
+    {
+        const double x = solve_step_x(p, n, i), h = solve_step_h(p, n, i);
+        ode_eval(ode, x, y, f0);
+        if (i % RKC_RADIUS_EVERY == 0)
+            rkc__radius(r, ode, x, y, f0);
+        rkc__step(r->order, rkc__stages(r->order, fabs(h) * r->rho), ode, x, y, f0, h, y);
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, i + 1), y, ode->dim))
+            return 0;
+    }
+    return 1;
+}
+
+// error estimate of sommeijer, shampine and verwer, the step's third order
+// term out of y, out and the end point slopes
+static int rkc__adaptive(rkc_t *r, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const u32 n = ode->dim;
+    const double dir = p->x1 >= p->x0 ? 1 : -1;
+    double y[ODE_MAX_DIM], out[ODE_MAX_DIM], f0[ODE_MAX_DIM], f1[ODE_MAX_DIM];
+    double x = p->x0, h = fabs(p->h) * dir;
+    u32 since = RKC_RADIUS_EVERY;
+    memcpy(y, p->y0, sizeof(y));
+
+    if (emit && !emit(user, x, y, n))
+        return 0;
+    ode_eval(ode, x, y, f0);
+    while ((p->x1 - x) * dir > 0)
+    {
+        if (stats->steps + stats->rejected >= p->max_steps)
+            return 0;
+        if (since >= RKC_RADIUS_EVERY)
+        {
+            rkc__radius(r, ode, x, y, f0);
+            since = 0;
+        }
+        // a step longer than the last stage count covers is cut back to it
+        if (fabs(h) * r->rho > rkc__beta(r->order, RKC_MAX_STAGES))
+            h = rkc__beta(r->order, RKC_MAX_STAGES) / r->rho * dir;
+        if ((x + h - p->x1) * dir > 0)
+            h = p->x1 - x;
+
+        rkc__step(r->order, rkc__stages(r->order, fabs(h) * r->rho), ode, x, y, f0, h, out);
+        ode_eval(ode, x + h, out, f1);
+
+        double e = 0;
+        for (u32 i = 0; i < n; i ++)
+        {
+            double est = 0.8 * (y[i] - out[i]) + 0.4 * h * (f0[i] + f1[i]);
+            double sc = p->atol + p->rtol * fmax(fabs(y[i]), fabs(out[i]));
+            e = fmax(e, fabs(est) / sc);
+        }
+
+        double scale = e > 0 ? RKC_SAFETY * pow(e, -1.0 / 3) : RKC_MAX_SCALE;
+        scale = fmin(RKC_MAX_SCALE, fmax(RKC_MIN_SCALE, scale));
+        if (e <= 1 && isfinite(e))
+        {
+            x += h;
+            memcpy(y, out, n * sizeof(*y));
+            memcpy(f0, f1, n * sizeof(*f0));
+            stats->steps ++;
+            since ++;
+            if (emit && !emit(user, x, y, n))
+                return 0;
+        }
+        else
+        {
+            stats->rejected ++;
+            since = RKC_RADIUS_EVERY;
+            if (!isfinite(e)) scale = RKC_MIN_SCALE;
+            scale = fmin(scale, 1);
+        }
+        h *= scale;
+        if (fabs(h) < 1e-14 * fmax(1, fabs(x)))
+            return 0;
+    }
+    return 1;
+}
+
+static int rkc__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const u32 slot = 1;
+    rkc_t r;
+    memset(&r, 0, sizeof(r));
+    r.order = solver->variant;
+    r.dim = ode->dim;
+    if (!init_sens(&r.sens, ode, &slot, 1))
+        return 0;
+    int ok = p->rtol > 0 && solver->adaptive ? rkc__adaptive(&r, ode, p, emit, user, stats)
+                                             : rkc__fixed(&r, ode, p, emit, user, stats);
+    destroy_sens(&r.sens);
+    return ok;
+}
+
+u32 rkc_solver_count(void)
+{
+    return 2;
+}
+
+void rkc_solver(u32 index, solver_t *solver)
+{
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), "RKC%u", index + 1);
+    solver->order    = index + 1;
+    solver->adaptive = index == 1;
+    solver->run      = rkc__solve;
+    solver->variant  = index + 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+#define RKC_MAX_STAGES 400
+// steps between spectral radius estimates, a rejected step also asks for one
+#define RKC_RADIUS_EVERY 25
+
+// runge-kutta-chebyshev: s explicit stages along a shifted chebyshev
+// polynomial stretch the real stability interval to about 1.9 s^2 (RKC1,
+// first order) or 0.65 s^2 (RKC2, second order, sommeijer, shampine and
+// verwer), so mildly stiff problems with a real dominant spectrum run at
+// the step accuracy asks for with s ~ sqrt(h rho) evaluations instead of
+// h rho. the spectral radius rho of df/dy comes from power iteration on
+// exact jacobian-vector products of the program, the stage count follows
+// from it every step. RKC2 adapts its step with rtol > 0
+u32  rkc_solver_count(void);
+void rkc_solver(u32 index, solver_t *solver);
@@ -0,0 +1,296 @@
+#include "sde.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define SDE_TWO_PI 6.283185307179586
+
+typedef struct
+{
+    sde_t *sde;
+    mexp_tree_t *drift;     // one per worker
+    mexp_tree_t *diffusion;
+    volatile u32 failed;
+} sde_job_t;
+
+typedef struct
+{
+    double x[MEXP_BATCH_SIZE];
+    double y[MEXP_BATCH_SIZE];
+    double f[MEXP_BATCH_SIZE];
+    double g[MEXP_BATCH_SIZE];
+    double gs[MEXP_BATCH_SIZE]; // g at the support point of the milstein step
+    double z[2 * MEXP_BATCH_SIZE];
+} sde_lanes_t;
+
+static const char *sde_names[SDE_SCHEME_COUNT] = {"em", "milstein"};
+
+// ten philox rounds over n counters side by side, written lane by lane so
+// that the 32x32 multiplies vectorize
+static void sde__philox(u32 *c0, u32 *c1, u32 *c2, u32 *c3, u32 k0, u32 k1, u32 n)
+{
+    for (u32 r = 0; r < 10; r ++)
+    {
+        for (u32 i = 0; i < n; i ++)
+        {
+            u64 p0 = (u64)PHILOX_M0 * c0[i];
+            u64 p1 = (u64)PHILOX_M1 * c2[i];
+            u32 n0 = (u32)(p1 >> 32) ^ c1[i] ^ k0;
+            u32 n2 = (u32)(p0 >> 32) ^ c3[i] ^ k1;
+            c0[i] = n0;
+            c1[i] = (u32)p1;
+            c2[i] = n2;
+            c3[i] = (u32)p0;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+// 53 bits from two words, never 0 so that the log below stays finite
+static inline double sde__uniform(u32 hi, u32 lo)
+{
+    return ((double)((((u64)hi << 32) | lo) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+void sde_normal_pairs(u64 seed, u32 pair, u32 first, u32 n, double *z)
+{
+    u32 c0[MEXP_BATCH_SIZE], c1[MEXP_BATCH_SIZE], c2[MEXP_BATCH_SIZE], c3[MEXP_BATCH_SIZE];
+    for (u32 at = 0; at < n; at += MEXP_BATCH_SIZE)
+    {
+        u32 m = n - at < MEXP_BATCH_SIZE ? n - at : MEXP_BATCH_SIZE;
+        for (u32 i = 0; i < m; i ++)
+        {
+            c0[i] = first + at + i;
+            c1[i] = pair;
+            c2[i] = 0;
+            c3[i] = 0;
+        }
+        sde__philox(c0, c1, c2, c3, (u32)seed, (u32)(seed >> 32), m);
+        // box-muller turns the two uniforms into the normals of both steps
+        for (u32 i = 0; i < m; i ++)
+        {
+            double r = sqrt(-2 * log(sde__uniform(c0[i], c1[i])));
+            double t = SDE_TWO_PI * sde__uniform(c2[i], c3[i]);
+            z[at + i] = r * cos(t);
+            z[n + at + i] = r * sin(t);
+        }
+    }
+}
+
+static void sde__fill(double *dst, double v, u32 n)
+{
+    for (u32 i = 0; i < n; i ++)
+        dst[i] = v;
+}
+
+// one step for n lanes at the same x, dw holds the standard normals
+static int sde__step(const sde_job_t *job, u32 worker, sde_lanes_t *l, double x, double h, const double *dw,
+                     const double *y0, double *y1, u32 n)
+{
+    mexp_tree_t *drift = &job->drift[worker], *diffusion = &job->diffusion[worker];
+    const double *v0[2] = {l->x, y0};
+    const double *vs[2] = {l->x, l->y};
+    const double sh = sqrt(h);
+    int ok = 1;
+
+    sde__fill(l->x, x, n);
+    ok &= mexp_eval_tree_batch(drift, v0, l->f, n);
+    ok &= mexp_eval_tree_batch(diffusion, v0, l->g, n);
+    if (job->sde->scheme == SDE_MILSTEIN)
+    {
+        for (u32 i = 0; i < n; i ++) l->y[i] = y0[i] + h * l->f[i] + sh * l->g[i];
+        ok &= mexp_eval_tree_batch(diffusion, vs, l->gs, n);
+        for (u32 i = 0; i < n; i ++)
+        {
+            double w = sh * dw[i];
+            y1[i] = y0[i] + h * l->f[i] + l->g[i] * w + (l->gs[i] - l->g[i]) * (w * w - h) / (2 * sh);
+        }
+    }
+    else
+    {
+        for (u32 i = 0; i < n; i ++)
+            y1[i] = y0[i] + h * l->f[i] + l->g[i] * sh * dw[i];
+    }
+    return ok;
+}
+
+static void sde__worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    sde_job_t *job = (sde_job_t *)user;
+    sde_t *sde = job->sde;
+    sde_lanes_t lanes;
+
+    for (u32 lane = begin; lane < end; lane += MEXP_BATCH_SIZE)
+    {
+        u32 n = end - lane < MEXP_BATCH_SIZE ? end - lane : MEXP_BATCH_SIZE;
+        for (u32 s = 1; s < sde->steps; s ++)
+        {
+            // step s takes increment k = s - 1, generated two at a time
+            u32 k = s - 1;
+            if ((k & 1) == 0)
+                sde_normal_pairs(sde->seed, k >> 1, lane, n, lanes.z);
+            double x = sde->x0 + k * sde->h;
+            if (!sde__step(job, worker, &lanes, x, sde->h, lanes.z + (k & 1) * n, sde_row(sde, s - 1) + lane, sde_row(sde, s) + lane, n))
+                pf_atomic_store(&job->failed, 1);
+        }
+    }
+}
+
+int init_sde(sde_t *sde, u32 count, u32 steps)
+{
+    memset(sde, 0, sizeof(*sde));
+    sde->count = count;
+    sde->steps = steps;
+    sde->y = (double *)calloc((size_t)count * steps, sizeof(*sde->y));
+    return sde->y != NULL;
+}
+
+void destroy_sde(sde_t *sde)
+{
+    free(sde->y);
+    sde->y = NULL;
+    sde->count = 0;
+    sde->steps = 0;
+}
+
+int run_sde(sde_t *sde, pool_t *pool, const mexp_tree_t *drift, const mexp_tree_t *diffusion, u32 scheme,
+            double x0, double h, double y0, u64 seed)
+{
+    u32 workers = pool_worker_count(pool);
+    sde_job_t job = {sde, NULL, NULL, 0};
+
+    if (scheme >= SDE_SCHEME_COUNT || h <= 0)
+        return 0;
+    job.drift = (mexp_tree_t *)calloc(workers, sizeof(*job.drift));
+    job.diffusion = (mexp_tree_t *)calloc(workers, sizeof(*job.diffusion));
+    if (!job.drift || !job.diffusion)
+        job.failed = 1;
+    for (u32 i = 0; !job.failed && i < workers; i ++)
+        if (!mexp_init_tree(&job.drift[i]) || !mexp_copy_tree(&job.drift[i], drift) ||
+            !mexp_init_tree(&job.diffusion[i]) || !mexp_copy_tree(&job.diffusion[i], diffusion))
+            job.failed = 1;
+
+    sde->x0 = x0;
+    sde->h = h;
+    sde->seed = seed;
+    sde->scheme = scheme;
+    sde__fill(sde_row(sde, 0), y0, sde->count);
+
+    double begin = pf_time();
+    if (!job.failed)
+        pool_for(pool, sde->count, MEXP_BATCH_SIZE * 4, sde__worker, &job);
+    sde->seconds = pf_time() - begin;
+    sde->rate = sde->seconds > 0 ? (double)sde->count * (sde->steps - 1) / sde->seconds : 0;
+
+    for (u32 i = 0; i < workers; i ++)
+    {
+        if (job.drift) mexp_free_tree(&job.drift[i]);
+        if (job.diffusion) mexp_free_tree(&job.diffusion[i]);
+    }
+    free(job.drift);
+    free(job.diffusion);
+    return !job.failed;
+}
+
+typedef struct
+{
+    const sde_t *sde;
+    const double *q;
+    u32 q_count;
+    double *out;
+    double *scratch; // one row per worker
+} sde_quantile_job_t;
+
+// smallest k + 1 values to the front with row[k] in its sorted place
+static void sde__select(double *row, u32 n, u32 k)
+{
+    u32 lo = 0, hi = n - 1;
+    while (lo < hi)
+    {
+        double pivot = row[lo + (hi - lo) / 2];
+        u32 i = lo, j = hi;
+        while (i <= j)
+        {
+            while (row[i] < pivot) i ++;
+            while (row[j] > pivot) j --;
+            if (i <= j)
+            {
+                double t = row[i]; row[i] = row[j]; row[j] = t;
+                i ++;
+                if (j == 0) break;
+                j --;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else return;
+    }
+}
+
+static double sde__order(double *row, u32 n, u32 k)
+{
+    sde__select(row, n, k);
+    return row[k];
+}
+
+static void sde__quantile_worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    sde_quantile_job_t *job = (sde_quantile_job_t *)user;
+    const u32 n = job->sde->count;
+    double *row = job->scratch + (size_t)worker * n;
+    for (u32 s = begin; s < end; s ++)
+    {
+        // paths that blew up are left out of the selection and sort last
+        const double *src = sde_row(job->sde, s);
+        u32 m = 0;
+        for (u32 i = 0; i < n; i ++)
+            if (isfinite(src[i])) row[m ++] = src[i];
+        // linear between the order statistics around q (n - 1)
+        for (u32 k = 0; k < job->q_count; k ++)
+        {
+            double at = job->q[k] * (n - 1);
+            u32 i = (u32)at;
+            double t = at - i, v = NAN;
+            if (i < m)
+                v = sde__order(row, m, i);
+            if (i < m && t > 0)
+                v = i + 1 < m ? v + t * (sde__order(row, m, i + 1) - v) : NAN;
+            job->out[(size_t)s * job->q_count + k] = v;
+        }
+    }
+}
+
+int sde_quantiles(const sde_t *sde, pool_t *pool, const double *q, u32 q_count, double *out)
+{
+    sde_quantile_job_t job = {sde, q, q_count, out, NULL};
+    if (!sde->count)
+        return 0;
+    job.scratch = (double *)malloc((size_t)pool_worker_count(pool) * sde->count * sizeof(double));
+    if (!job.scratch)
+        return 0;
+    pool_for(pool, sde->steps, 16, sde__quantile_worker, &job);
+    free(job.scratch);
+    return 1;
+}
+
+const char *sde_scheme_name(u32 scheme)
+{
+    return scheme < SDE_SCHEME_COUNT ? sde_names[scheme] : "?";
+}
+
+int find_sde_scheme(const char *name, u32 *scheme)
+{
+    for (u32 i = 0; i < SDE_SCHEME_COUNT; i ++)
+    {
+        if (!strcmp(name, sde_names[i]))
+        {
+            *scheme = i;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.h"
+#include "pool.h"
+#include "mexp.h"
+
+// many paths of dy = f(x, y) dx + g(x, y) dW started from the same y0 and
+// integrated in lockstep like the ensemble. the increments come from a
+// counter-based generator (philox4x32-10) keyed by the seed and counted by
+// path and step, so every path is the same whatever the thread count
+enum
+{
+    SDE_EULER_MARUYAMA = 0,
+    // the derivative-free variant, g(x, y + f h + g sqrt(h)) stands in for g'
+    SDE_MILSTEIN = 1,
+    SDE_SCHEME_COUNT
+};
+
+typedef struct sde_t
+{
+    u32 count; // paths
+    u32 steps;
+    double x0, h;
+    u64 seed;
+    u32 scheme;
+    double *y; // step-major like the ensemble
+
+    double seconds;
+    double rate; // path-steps per second of the last run
+} sde_t;
+
+int  init_sde(sde_t *sde, u32 count, u32 steps);
+void destroy_sde(sde_t *sde);
+int  run_sde(sde_t *sde, pool_t *pool, const mexp_tree_t *drift, const mexp_tree_t *diffusion, u32 scheme,
+             double x0, double h, double y0, u64 seed);
+// per step quantiles over the paths, out holds one row of q_count values per
+// step. paths that blew up count as larger than any finite value, a
+// quantile that falls among them is NaN
+int  sde_quantiles(const sde_t *sde, pool_t *pool, const double *q, u32 q_count, double *out);
+// standard normals for the paths first .. first + n - 1, one philox block
+// gives the increments of two steps: z[i] for step 2 * pair, z[n + i] for
+// step 2 * pair + 1
+void sde_normal_pairs(u64 seed, u32 pair, u32 first, u32 n, double *z);
+const char *sde_scheme_name(u32 scheme);
+int  find_sde_scheme(const char *name, u32 *scheme);
+
+static inline double *sde_row(const sde_t *sde, u32 step)
+{ return sde->y + (size_t)step * sde->count; }
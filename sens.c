@@ -0,0 +1,204 @@
+#include "sens.h"
+#include <math.h>
+#include <stdlib.h>
+
+static double sens__d_sin(double a, double r)  { (void)r; return cos(a); }
+static double sens__d_cos(double a, double r)  { (void)r; return -sin(a); }
+static double sens__d_tan(double a, double r)  { (void)a; return 1 + r * r; }
+static double sens__d_exp(double a, double r)  { (void)a; return r; }
+static double sens__d_log(double a, double r)  { (void)r; return 1 / a; }
+static double sens__d_sqrt(double a, double r) { (void)a; return 0.5 / r; }
+
+static const struct
+{
+    const char *name;
+    sens_deriv_fn deriv;
+}
+sens__funcs[] =
+{
+    {"sin",  sens__d_sin},
+    {"cos",  sens__d_cos},
+    {"tan",  sens__d_tan},
+    {"exp",  sens__d_exp},
+    {"log",  sens__d_log},
+    {"sqrt", sens__d_sqrt},
+};
+
+int init_sens(sens_t *sens, const ode_t *ode, const u32 *slots, u32 count)
+{
+    const mexp_program_t *prog = ode->prog;
+    const u32 n = sizeof(sens__funcs) / sizeof(sens__funcs[0]);
+    memset(sens, 0, sizeof(*sens));
+    if (count > SENS_MAX_DIRECTIONS)
+        return 0;
+    sens->dim = ode->dim;
+    sens->count = count;
+    for (u32 d = 0; d < count; d ++)
+    {
+        if (slots[d] == 0 || slots[d] >= ODE_MAX_VARS)
+            return 0;
+        sens->slots[d] = slots[d];
+    }
+
+    sens->deriv = (sens_deriv_fn *)calloc(prog->count ? prog->count : 1, sizeof(*sens->deriv));
+    sens->tangents = (double *)calloc((size_t)(prog->count ? prog->count : 1) * (count ? count : 1), sizeof(double));
+    if (!sens->deriv || !sens->tangents)
+    {
+        destroy_sens(sens);
+        return 0;
+    }
+    for (u32 i = 0; i < prog->count; i ++)
+    {
+        const mexp_instr_t *in = &prog->code[i];
+        if (in->op != MEXP_OP_CALL)
+            continue;
+        u32 f = 0;
+        while (f < n && strncmp(in->name, sens__funcs[f].name, sizeof(in->name)))
+            f ++;
+        if (f == n)
+        {
+            destroy_sens(sens);
+            return 0;
+        }
+        sens->deriv[i] = sens__funcs[f].deriv;
+    }
+    return 1;
+}
+
+void destroy_sens(sens_t *sens)
+{
+    free(sens->deriv);
+    free(sens->tangents);
+    free(sens->work);
+    sens->deriv = NULL;
+    sens->tangents = NULL;
+    sens->work = NULL;
+}
+
+void sens_eval(sens_t *sens, ode_t *ode, double x, const double *y, const double *s, double *dydx, double *ds)
+{
+    const mexp_program_t *prog = ode->prog;
+    const u32 n = sens->count;
+    ode_eval(ode, x, y, dydx);
+
+    // the primal values are still in the registers
+    const double *r = prog->regs;
+    for (u32 i = 0; i < prog->count; i ++)
+    {
+        const mexp_instr_t *in = &prog->code[i];
+        double *t = sens->tangents + (size_t)i * n;
+        // operands are registers for everything past the leaves
+        const int leaf = in->op == MEXP_OP_NUMBER || in->op == MEXP_OP_VARIABLE;
+        const double *ta = leaf ? NULL : sens->tangents + (size_t)in->a * n;
+        const double *tb = leaf ? NULL : sens->tangents + (size_t)in->b * n;
+        switch (in->op)
+        {
+            case MEXP_OP_NUMBER:
+                for (u32 d = 0; d < n; d ++) t[d] = 0;
+                break;
+            case MEXP_OP_VARIABLE:
+                if (in->a >= 1 && (u32)in->a <= sens->dim)
+                    memcpy(t, s + (size_t)(in->a - 1) * n, n * sizeof(*t));
+                else
+                    for (u32 d = 0; d < n; d ++) t[d] = sens->slots[d] == (u32)in->a;
+                break;
+            case MEXP_OP_ADD:
+                for (u32 d = 0; d < n; d ++) t[d] = ta[d] + tb[d];
+                break;
+            case MEXP_OP_SUB:
+                for (u32 d = 0; d < n; d ++) t[d] = ta[d] - tb[d];
+                break;
+            case MEXP_OP_MUL:
+                for (u32 d = 0; d < n; d ++) t[d] = ta[d] * r[in->b] + r[in->a] * tb[d];
+                break;
+            case MEXP_OP_DIV:
+                for (u32 d = 0; d < n; d ++) t[d] = (ta[d] - r[i] * tb[d]) / r[in->b];
+                break;
+            case MEXP_OP_POW:
+            {
+                // either partial is left out where its direction is 0, so that
+                // a constant exponent never takes the log of a negative base
+                const double a = r[in->a], b = r[in->b];
+                const double da = b * pow(a, b - 1), db = r[i] * log(a);
+                for (u32 d = 0; d < n; d ++)
+                    t[d] = (ta[d] != 0 ? da * ta[d] : 0) + (tb[d] != 0 ? db * tb[d] : 0);
+                break;
+            }
+            case MEXP_OP_CALL:
+            {
+                const double f = sens->deriv[i](r[in->a], r[i]);
+                for (u32 d = 0; d < n; d ++) t[d] = f * ta[d];
+                break;
+            }
+        }
+    }
+    for (u32 c = 0; c < sens->dim; c ++)
+        memcpy(ds + (size_t)c * n, sens->tangents + (size_t)prog->outputs[c] * n, n * sizeof(*ds));
+}
+
+// one step of the tableau on the stacked state z = (y, s)
+static void sens__step(sens_t *sens, const rk_tableau_t *tab, ode_t *ode, double x, double *z, double h)
+{
+    const u32 m = sens->dim * (sens->count + 1);
+    double *k = sens->work, *zt = sens->work + (size_t)tab->stages * m;
+    for (u32 st = 0; st < tab->stages; st ++)
+    {
+        for (u32 i = 0; i < m; i ++)
+        {
+            double v = z[i];
+            for (u32 j = 0; j < st; j ++)
+                v += h * tab->a[st][j] * k[(size_t)j * m + i];
+            zt[i] = v;
+        }
+        double *ks = k + (size_t)st * m;
+        sens_eval(sens, ode, x + tab->c[st] * h, zt, zt + sens->dim, ks, ks + sens->dim);
+    }
+    for (u32 i = 0; i < m; i ++)
+    {
+        double v = 0;
+        for (u32 st = 0; st < tab->stages; st ++)
+            v += tab->b[st] * k[(size_t)st * m + i];
+        z[i] += h * v;
+    }
+}
+
+int run_sens(sens_t *sens, const rk_tableau_t *tab, ode_t *ode, const solve_params_t *p,
+             sens_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    solve_stats_t dummy;
+    const u32 dim = sens->dim, n = sens->count, m = dim * (n + 1);
+    if (!stats) stats = &dummy;
+    memset(stats, 0, sizeof(*stats));
+    if (p->h == 0)
+        return 0;
+
+    // stage vectors and the stage state, then the state itself
+    if (sens->stages < tab->stages)
+    {
+        double *work = (double *)realloc(sens->work, (size_t)(tab->stages + 2) * m * sizeof(double));
+        if (!work)
+            return 0;
+        sens->work = work;
+        sens->stages = tab->stages;
+    }
+    double *z = sens->work + (size_t)(sens->stages + 1) * m;
+    memcpy(z, p->y0, dim * sizeof(*z));
+    memset(z + dim, 0, (size_t)dim * n * sizeof(*z));
+    for (u32 d = 0; d < n; d ++)
+        if (sens->slots[d] <= dim)
+            z[dim + (size_t)(sens->slots[d] - 1) * n + d] = 1;
+
+    u64 steps = solve_step_count(p), evals = ode->evals;
+    double begin = pf_time();
+    int ok = steps <= p->max_steps && (!emit || emit(user, p->x0, z, z + dim, dim, n));
+    for (u64 i = 0; ok && i < steps; i ++)
+    {
+        // x from the step index like the fixed step solvers
+        sens__step(sens, tab, ode, solve_step_x(p, steps, i), z, solve_step_h(p, steps, i));
+        stats->steps ++;
+        ok = !emit || emit(user, solve_step_x(p, steps, i + 1), z, z + dim, dim, n);
+    }
+    stats->seconds = pf_time() - begin;
+    stats->evals = ode->evals - evals;
+    return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common.h"
+#include "ode.h"
+#include "rk.h"
+#include "solve.h"
+
+// every variable slot but x
+#define SENS_MAX_DIRECTIONS (ODE_MAX_VARS - 1)
+
+// f'(a) of a call given a and f(a)
+typedef double (*sens_deriv_fn)(double a, double r);
+
+// forward sensitivities: s[i * count + d] = dy_i/dp_d where p_d is the
+// variable in slots[d], an initial value for slots 1..dim or a parameter
+// after them. they follow the variational equations
+//   s' = df/dy s + df/dp,  s(x0) = e_i for y0_i and 0 for parameters
+// whose right hand side comes out of one forward-mode pass over the
+// program next to f, with the exact derivative of every instruction
+typedef struct sens_t
+{
+    u32 dim;
+    u32 count; // directions
+    u32 slots[SENS_MAX_DIRECTIONS];
+    sens_deriv_fn *deriv; // per instruction, set for the calls
+    double *tangents; // count per register
+    double *work;     // stage vectors of the integration
+    u32 stages;
+} sens_t;
+
+// the pairs (y, s) the integration emits, returning 0 stops the run
+typedef int (*sens_emit_fn)(void *user, double x, const double *y, const double *s, u32 dim, u32 count);
+
+// returns 0 for an unknown call or a slot out of range, or when out of memory
+int  init_sens(sens_t *sens, const ode_t *ode, const u32 *slots, u32 count);
+void destroy_sens(sens_t *sens);
+
+// f and its derivative along every direction, ds = df/dy s + df/dp
+void sens_eval(sens_t *sens, ode_t *ode, double x, const double *y, const double *s, double *dydx, double *ds);
+
+// fixed steps of an explicit tableau over y and s together, so the
+// sensitivities are the exact derivatives of the discrete solution
+int  run_sens(sens_t *sens, const rk_tableau_t *tableau, ode_t *ode, const solve_params_t *params,
+              sens_emit_fn emit, void *user, solve_stats_t *stats);
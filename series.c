@@ -0,0 +1,92 @@
+#include "series.h"
+#include <math.h>
+#include <stdlib.h>
+
+void init_series(series_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->even = 1;
+}
+
+void destroy_series(series_t *s)
+{
+    free(s->x);
+    free(s->y);
+    free(s->render);
+    init_series(s);
+}
+
+int reset_series(series_t *s, u32 dim, size_t cap, double x0, double h)
+{
+    if ((size_t)dim * cap > s->y_cap)
+    {
+        double *y = (double *)realloc(s->y, (size_t)dim * cap * sizeof(*y));
+        if (!y) return 0;
+        s->y = y;
+        s->y_cap = (size_t)dim * cap;
+    }
+    s->dim = dim;
+    s->cap = cap;
+    s->count = 0;
+    s->x0 = x0;
+    s->h = h;
+    s->even = 1;
+    s->render_count = 0;
+    return 1;
+}
+
+// the points so far get an explicit x column
+static int series__spread(series_t *s)
+{
+    if (s->cap > s->x_cap)
+    {
+        double *x = (double *)realloc(s->x, s->cap * sizeof(*x));
+        if (!x) return 0;
+        s->x = x;
+        s->x_cap = s->cap;
+    }
+    for (size_t i = 0; i < s->count; i ++)
+        s->x[i] = s->x0 + i * s->h;
+    s->even = 0;
+    return 1;
+}
+
+int series_push(series_t *s, double x, const double *y)
+{
+    const size_t i = s->count;
+    if (i >= s->cap)
+        return 0;
+    // slices resumed from the last point round differently from x0 + i * h
+    if (s->even && fabs(x - (s->x0 + i * s->h)) > 1e-9 * fabs(s->h) && !series__spread(s))
+        return 0;
+    if (!s->even)
+        s->x[i] = x;
+    for (u32 c = 0; c < s->dim; c ++)
+        s->y[c * s->cap + i] = y[c];
+    s->count ++;
+    return 1;
+}
+
+const vec2f *series_render(series_t *s)
+{
+    const size_t need = (s->dim + 1) * s->cap;
+    if (need > s->render_cap)
+    {
+        vec2f *render = (vec2f *)realloc(s->render, need * sizeof(*render));
+        if (!render) return NULL;
+        s->render = render;
+        s->render_cap = need;
+        s->render_count = 0;
+    }
+    vec2f *phase = s->render + s->dim * s->cap;
+    for (size_t i = s->render_count; i < s->count; i ++)
+    {
+        const float x = (float)series_x(s, i);
+        for (u32 c = 0; c < s->dim; c ++)
+            s->render[c * s->cap + i] = (vec2f){x, (float)-s->y[c * s->cap + i]};
+        if (s->dim > 1)
+            phase[i] = (vec2f){(float)s->y[i], (float)-s->y[s->cap + i]};
+    }
+    s->render_count = s->count;
+    return s->render;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+
+// one integrated run held in columns. x is implicit (x0 + i * h) for as
+// long as the points come evenly spaced and only gets a column of its own
+// once they stop doing so, adaptive steps or a terminal event for example.
+// the float copies the renderer draws are brought up to date lazily
+typedef struct series_t
+{
+    u32 dim;
+    size_t count, cap;
+    double x0, h;
+    int even;          // x is implicit
+    double *x;         // cap values, valid when !even
+    double *y;         // component-major, dim runs of cap values
+    size_t x_cap, y_cap;
+
+    // screen orientation: dim runs of (x, -y), then (y[0], -y[1]) for the phase portrait
+    vec2f *render;
+    size_t render_cap;
+    size_t render_count; // points already converted
+} series_t;
+
+void init_series(series_t *series);
+void destroy_series(series_t *series);
+// empties the series for a run of up to cap points
+int  reset_series(series_t *series, u32 dim, size_t cap, double x0, double h);
+// returns 0 when the series is full or out of memory
+int  series_push(series_t *series, double x, const double *y);
+// the render runs with all count points converted, NULL when out of memory
+const vec2f *series_render(series_t *series);
+
+static inline double series_x(const series_t *series, size_t i)
+{ return series->even ? series->x0 + i * series->h : series->x[i]; }
+static inline const double *series_y(const series_t *series, u32 component)
+{ return series->y + component * series->cap; }
+static inline const vec2f *series_render_column(const series_t *series, u32 component)
+{ return series->render + component * series->cap; }
+static inline const vec2f *series_render_phase(const series_t *series)
+{ return series->render + series->dim * series->cap; }
@@ -0,0 +1,209 @@
+#include "solve.h"
+#include "platform.h"
+#include "abm.h"
+#include "gbs.h"
+#include "taylor.h"
+#include "symp.h"
+#include "rkc.h"
+#include "etd.h"
+#include <math.h>
+#include <ctype.h>
+
+#define SOLVE_SAFETY 0.9
+#define SOLVE_MIN_SCALE 0.2
+#define SOLVE_MAX_SCALE 5.0
+
+void init_solve_params(solve_params_t *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->x0 = 0;
+    params->x1 = 10;
+    params->h  = 0.01;
+    params->y0[0] = 1;
+    params->rtol = 0;
+    params->atol = 1e-9;
+    params->max_steps = 100000000;
+}
+
+u64 solve_step_count(const solve_params_t *p)
+{
+    const double steps = (p->x1 - p->x0) / p->h;
+    if (!(steps > 0) || !isfinite(steps) || steps >= 1e18)
+        return 0;
+    // a range that is a whole number of steps up to roundoff gets no sliver of a last step
+    const double whole = floor(steps + 0.5);
+    return fabs(steps - whole) <= 1e-9 * fmax(1, whole) ? (u64)whole : (u64)ceil(steps);
+}
+
+static int solve__fixed(const rk_method_t *method, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    double y[ODE_MAX_DIM];
+    memcpy(y, p->y0, sizeof(y));
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, solve_step_x(p, n, p->first_step), y, ode->dim))
+        return 0;
+    for (u64 i = p->first_step; i < n; i ++)
+    {
+        // x from the step index so that long runs do not accumulate drift
+        rk_step(method, ode, solve_step_x(p, n, i), y, solve_step_h(p, n, i), y, NULL);
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, i + 1), y, ode->dim))
+            return 0;
+    }
+    return 1;
+}
+
+static int solve__adaptive(const rk_method_t *method, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const rk_tableau_t *t = method->tableau;
+    const u32 n = ode->dim;
+    const double dir = p->x1 >= p->x0 ? 1 : -1;
+    double y[ODE_MAX_DIM], out[ODE_MAX_DIM], err[ODE_MAX_DIM];
+    double x = p->x0, h = fabs(p->h) * dir;
+    memcpy(y, p->y0, sizeof(y));
+
+    if (emit && !emit(user, x, y, n))
+        return 0;
+    while ((p->x1 - x) * dir > 0)
+    {
+        if (stats->steps + stats->rejected >= p->max_steps)
+            return 0;
+        if ((x + h - p->x1) * dir > 0)
+            h = p->x1 - x;
+
+        rk_step(method, ode, x, y, h, out, err);
+
+        double e = 0;
+        for (u32 i = 0; i < n; i ++)
+        {
+            double sc = p->atol + p->rtol * fmax(fabs(y[i]), fabs(out[i]));
+            double r  = fabs(err[i]) / sc;
+            e = r > e ? r : e;
+        }
+
+        double scale = e > 0 ? SOLVE_SAFETY * pow(e, -1.0 / t->order) : SOLVE_MAX_SCALE;
+        scale = fmin(SOLVE_MAX_SCALE, fmax(SOLVE_MIN_SCALE, scale));
+        if (e <= 1 && isfinite(e))
+        {
+            x += h;
+            memcpy(y, out, n * sizeof(*y));
+            stats->steps ++;
+            if (emit && !emit(user, x, y, n))
+                return 0;
+        }
+        else
+        {
+            stats->rejected ++;
+            if (!isfinite(e)) scale = SOLVE_MIN_SCALE;
+        }
+        h *= scale;
+        if (fabs(h) < 1e-14 * fmax(1, fabs(x)))
+            return 0;
+    }
+    return 1;
+}
+
+static int solve__rk(const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    if (params->rtol > 0 && solver->rk->tableau->embedded)
+        return solve__adaptive(solver->rk, ode, params, emit, user, stats);
+    return solve__fixed(solver->rk, ode, params, emit, user, stats);
+}
+
+void init_rk_solver(solver_t *solver, const rk_method_t *method)
+{
+    memset(solver, 0, sizeof(*solver));
+    memcpy(solver->name, method->tableau->name, RK_NAME_LENGTH);
+    solver->order    = method->tableau->order;
+    solver->adaptive = method->tableau->embedded;
+    solver->run      = solve__rk;
+    solver->rk       = method;
+    solver->restartable = 1;
+}
+
+static void solve__rk_builtin(u32 index, solver_t *solver)
+{
+    init_rk_solver(solver, rk_builtin(index));
+}
+
+static const struct
+{
+    u32  (*count)(void);
+    void (*get)(u32 index, solver_t *solver);
+}
+solve__families[] =
+{
+    {rk_builtin_count,     solve__rk_builtin},
+    {abm_solver_count,     abm_solver},
+    {gbs_solver_count,     gbs_solver},
+    {taylor_solver_count,  taylor_solver},
+    {symp_solver_count,    symp_solver},
+    {rkc_solver_count,     rkc_solver},
+    {etd_solver_count,     etd_solver},
+};
+#define SOLVE_FAMILY_COUNT (sizeof(solve__families) / sizeof(solve__families[0]))
+
+u32 solver_builtin_count(void)
+{
+    u32 count = 0;
+    for (u32 i = 0; i < SOLVE_FAMILY_COUNT; i ++)
+        count += solve__families[i].count();
+    return count;
+}
+
+void solver_builtin(u32 index, solver_t *solver)
+{
+    for (u32 i = 0; i < SOLVE_FAMILY_COUNT; i ++)
+    {
+        u32 count = solve__families[i].count();
+        if (index < count)
+        {
+            solve__families[i].get(index, solver);
+            return;
+        }
+        index -= count;
+    }
+    memset(solver, 0, sizeof(*solver));
+}
+
+int find_solver(solver_t *solver, const char *name)
+{
+    for (u32 i = 0; i < solver_builtin_count(); i ++)
+    {
+        solver_builtin(i, solver);
+        const char *a = solver->name, *b = name;
+        while (*a && toupper((u8)*a) == toupper((u8)*b)) { a ++; b ++; }
+        if (!*a && !*b)
+            return 1;
+    }
+    return 0;
+}
+
+int solve(const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    solve_stats_t dummy;
+    if (!stats) stats = &dummy;
+    memset(stats, 0, sizeof(*stats));
+    if (params->h == 0)
+        return 0;
+    // adaptive runs carry their step and multistep ones their history
+    if (params->first_step && (!solver->restartable || (solver->adaptive && params->rtol > 0)))
+        return 0;
+
+    u64 evals = ode->evals;
+    double begin = pf_time();
+    int ok = solver->run(solver, ode, params, emit, user, stats);
+    stats->seconds = pf_time() - begin;
+    stats->evals = ode->evals - evals;
+    return ok;
+}
+
+int solve_rk(const rk_method_t *method, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    solver_t solver;
+    init_rk_solver(&solver, method);
+    return solve(&solver, ode, params, emit, user, stats);
+}
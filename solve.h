@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+#include "ode.h"
+#include "rk.h"
+#include "pool.h"
+
+typedef struct solve_params_t
+{
+    double x0, x1, h;
+    double y0[ODE_MAX_DIM];
+    // with rtol > 0 methods that carry an error estimate adapt their step,
+    // h is then only the initial guess
+    double rtol, atol;
+    u64 max_steps;
+    // methods with independent work inside a step may spread it over this
+    // pool, it must not be running a pool_for of its own
+    pool_t *pool;
+    // a restartable solver's fixed step run takes y0 as the state after
+    // first_step steps and goes on from x0 + first_step * h, bit for bit
+    // as if it had never stopped there
+    u64 first_step;
+} solve_params_t;
+
+typedef struct solve_stats_t
+{
+    u64 steps;
+    u64 rejected;
+    u64 evals;
+    double seconds;
+} solve_stats_t;
+
+// called for every accepted point, the initial one included; returning 0 stops the run
+typedef int (*solve_emit_fn)(void *user, double x, const double *y, u32 dim);
+
+typedef struct solver_t solver_t;
+typedef int (*solver_fn)(const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats);
+
+// an integrator as the front ends pick it by name, runge-kutta methods keep
+// their tableau, other families tell their members apart by variant
+struct solver_t
+{
+    char name[RK_NAME_LENGTH];
+    u32 order;
+    int adaptive;
+    solver_fn run;
+    const rk_method_t *rk;
+    u32 variant;
+    int restartable; // its fixed step runs honour first_step
+};
+
+void init_solve_params(solve_params_t *params);
+
+// fixed step runs take whole steps of h from x0 and cut the last one short
+// to land on x1 when h does not divide the range. the step count is this,
+// step i starts at solve_step_x(p, n, i) and is solve_step_h(p, n, i) long
+u64  solve_step_count(const solve_params_t *params);
+static inline double solve_step_x(const solve_params_t *p, u64 n, u64 i)
+{ return i < n ? p->x0 + i * p->h : p->x1; }
+static inline double solve_step_h(const solve_params_t *p, u64 n, u64 i)
+{
+    const double last = p->x1 - (p->x0 + i * p->h);
+    // a last step that is h up to roundoff stays h, bit for bit like the others,
+    // with the same tolerance solve_step_count allows
+    const double off = (last - p->h) / (p->h * (n > 1 ? n : 1));
+    return i + 1 < n || off * off <= 1e-18 ? p->h : last;
+}
+void init_rk_solver(solver_t *solver, const rk_method_t *method);
+
+// every built-in integrator of every family
+u32  solver_builtin_count(void);
+void solver_builtin(u32 index, solver_t *solver);
+int  find_solver(solver_t *solver, const char *name);
+
+int  solve(const solver_t *solver, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats);
+int  solve_rk(const rk_method_t *method, ode_t *ode, const solve_params_t *params, solve_emit_fn emit, void *user, solve_stats_t *stats);
@@ -0,0 +1,260 @@
+#include "sweep.h"
+#include <math.h>
+#include <stdlib.h>
+
+static u32 sweep__padded(u32 length)
+{
+    return (length + 7) & ~7u;
+}
+
+int sweep_find_slot(const system_t *sys, const char *name, u32 *slot)
+{
+    const size_t length = strlen(name);
+    for (u32 i = 0; i < sys->dim; i ++)
+    {
+        const size_t label = strlen(sys->labels[i]);
+        if (!strcmp(name, sys->labels[i]) || (length == label + 1 && !strncmp(name, sys->labels[i], label) && name[label] == '0'))
+        {
+            *slot = 1 + i;
+            return 1;
+        }
+    }
+    for (u32 p = 0; length == 1 && p < sys->param_count; p ++)
+    {
+        if (sys->params[p] == name[0])
+        {
+            *slot = system_param_slot(sys, p);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int init_sweep(sweep_t *sweep, pool_t *pool, const system_t *sys, mexp_parser_t *parser,
+               const char *const *events, const int *terminal, u32 event_count)
+{
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->sys = sys;
+    sweep->worker_count = pool_worker_count(pool);
+    sweep->workers = (sweep_worker_t *)calloc(sweep->worker_count, sizeof(*sweep->workers));
+    if (!sweep->workers)
+        return 0;
+    for (u32 w = 0; w < sweep->worker_count; w ++)
+    {
+        sweep_worker_t *worker = &sweep->workers[w];
+        mexp_init_program(&worker->prog);
+        init_event_monitor(&worker->monitor);
+        if (!mexp_copy_program(&worker->prog, &sys->prog))
+            return 0;
+        for (u32 e = 0; e < event_count; e ++)
+            if (!add_event(&worker->monitor, parser, events[e], (int32_t)strlen(events[e]), terminal[e], EVENT_ANY))
+                return 0;
+    }
+    return 1;
+}
+
+void destroy_sweep(sweep_t *sweep)
+{
+    for (u32 w = 0; sweep->workers && w < sweep->worker_count; w ++)
+    {
+        mexp_free_program(&sweep->workers[w].prog);
+        destroy_event_monitor(&sweep->workers[w].monitor);
+    }
+    free(sweep->workers);
+    sweep->workers = NULL;
+}
+
+typedef struct
+{
+    sweep_record_t *record;
+    diverge_guard_t guard;
+} sweep_sink_t;
+
+static int sweep__point(void *user, double x, const double *y, u32 dim)
+{
+    sweep_sink_t *sink = (sweep_sink_t *)user;
+    sweep_record_t *r = sink->record;
+    // a diverged point is not recorded, the run ends on the last good one
+    if (!diverge_point(&sink->guard, x, y, dim))
+    {
+        r->flags |= SWEEP_BLOWUP;
+        return 0;
+    }
+    r->end_x = x;
+    r->final = y[0];
+    r->max_abs = fmax(r->max_abs, diverge_norm(y, dim));
+    return 1;
+}
+
+static void sweep__worker(void *user, u32 begin, u32 end, u32 worker)
+{
+    sweep_t *sweep = (sweep_t *)user;
+    sweep_worker_t *w = &sweep->workers[worker];
+    sweep_record_t records[SWEEP_GRAIN];
+    const u32 n0 = sweep->axes[0].count;
+    ode_t ode;
+
+    init_ode(&ode, &w->prog);
+    system_bind(sweep->sys, &ode, sweep->param_values);
+    for (u32 k = begin; k < end; k ++)
+    {
+        sweep_record_t *r = &records[k - begin];
+        solve_params_t params = sweep->params;
+        solve_stats_t stats;
+        sweep_sink_t sink;
+        const double values[2] = {sweep_axis_value(&sweep->axes[0], k % n0), sweep_axis_value(&sweep->axes[1], k / n0)};
+
+        for (u32 a = 0; a < 2; a ++)
+        {
+            const u32 slot = sweep->axes[a].slot;
+            if (slot == 0)
+                continue;
+            if (slot <= ode.dim)
+                params.y0[slot - 1] = values[a];
+            else
+                ode.vars[slot] = values[a];
+        }
+        memset(r, 0, sizeof(*r));
+        r->end_x = params.x0;
+        r->final = params.y0[0];
+        sink.record = r;
+        reset_diverge_guard(&sink.guard, &sweep->diverge);
+        int ok;
+        if (w->monitor.count)
+        {
+            reset_event_monitor(&w->monitor, &ode, sweep__point, &sink);
+            ok = solve(&sweep->solver, &ode, &params, event_emit, &w->monitor, &stats);
+            r->events = w->monitor.hit_count;
+            if (w->monitor.terminated)
+                r->flags |= SWEEP_STOPPED;
+        }
+        else
+            ok = solve(&sweep->solver, &ode, &params, sweep__point, &sink, &stats);
+        if (!ok && !r->flags)
+            r->flags |= SWEEP_FAILED;
+        w->evals += stats.evals;
+        w->blowups  += (r->flags & SWEEP_BLOWUP) != 0;
+        w->stops    += (r->flags & SWEEP_STOPPED) != 0;
+        w->failures += (r->flags & SWEEP_FAILED) != 0;
+    }
+
+    // chunks finish out of order, each goes straight to its place
+    pf_lock(&sweep->lock);
+    if (fseek(sweep->fp, (long)(sweep->offset + (u64)begin * sizeof(*records)), SEEK_SET) != 0 ||
+        fwrite(records, sizeof(*records), end - begin, sweep->fp) != end - begin)
+        sweep->write_failed = 1;
+    pf_unlock(&sweep->lock);
+}
+
+int run_sweep(sweep_t *sweep, pool_t *pool, FILE *fp, const char *expr)
+{
+    sweep_header_t hd;
+    const u32 length = (u32)strlen(expr);
+    const u64 zero = 0;
+    const u32 count = sweep->axes[0].count * sweep->axes[1].count;
+
+    memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, SWEEP_MAGIC, sizeof(SWEEP_MAGIC));
+    hd.version     = SWEEP_VERSION;
+    hd.byte_order  = SWEEP_BYTE_ORDER;
+    hd.dim         = sweep->sys->dim;
+    hd.expr_length = length;
+    snprintf(hd.method, sizeof(hd.method), "%s", sweep->solver.name);
+    hd.x0          = sweep->params.x0;
+    hd.x1          = sweep->params.x1;
+    hd.h           = sweep->params.h;
+    hd.limit       = sweep->diverge.limit;
+    hd.growth      = sweep->diverge.growth;
+    memcpy(hd.axes, sweep->axes, sizeof(hd.axes));
+    if (fwrite(&hd, sizeof(hd), 1, fp) != 1 || fwrite(expr, 1, length, fp) != length ||
+        fwrite(&zero, 1, sweep__padded(length) - length, fp) != sweep__padded(length) - length)
+        return 0;
+
+    if (!pf_init_mutex(&sweep->lock))
+        return 0;
+    sweep->fp = fp;
+    sweep->offset = sizeof(hd) + sweep__padded(length);
+    sweep->write_failed = 0;
+    for (u32 w = 0; w < sweep->worker_count; w ++)
+    {
+        sweep_worker_t *worker = &sweep->workers[w];
+        worker->evals = 0;
+        worker->blowups = worker->stops = worker->failures = 0;
+    }
+
+    double begin = pf_time();
+    pool_for(pool, count, SWEEP_GRAIN, sweep__worker, sweep);
+    sweep->seconds = pf_time() - begin;
+    pf_destroy_mutex(&sweep->lock);
+
+    sweep->evals = 0;
+    sweep->blowups = sweep->stops = sweep->failures = 0;
+    for (u32 w = 0; w < sweep->worker_count; w ++)
+    {
+        const sweep_worker_t *worker = &sweep->workers[w];
+        sweep->evals    += worker->evals;
+        sweep->blowups  += worker->blowups;
+        sweep->stops    += worker->stops;
+        sweep->failures += worker->failures;
+    }
+    return !sweep->write_failed;
+}
+
+int sweep_open_reader(sweep_reader_t *reader, const char *file_name, char *error, size_t error_length)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (!pf_map_file(&reader->mapping, file_name))
+    {
+        snprintf(error, error_length, "could not map '%s'", file_name);
+        return 0;
+    }
+
+    const u8 *base = (const u8 *)reader->mapping.data;
+    const u64 size = reader->mapping.size;
+    const sweep_header_t *hd = (const sweep_header_t *)base;
+    if (size < sizeof(*hd) || memcmp(hd->magic, SWEEP_MAGIC, sizeof(SWEEP_MAGIC)) != 0)
+    {
+        snprintf(error, error_length, "not a sweep file");
+        goto fail;
+    }
+    if (hd->version != SWEEP_VERSION || hd->byte_order != SWEEP_BYTE_ORDER)
+    {
+        snprintf(error, error_length, "unsupported sweep version %u", hd->version);
+        goto fail;
+    }
+    const u64 offset = sizeof(*hd) + sweep__padded(hd->expr_length);
+    if (!hd->axes[0].count || !hd->axes[1].count || offset > size ||
+        (size - offset) / sizeof(sweep_record_t) < (u64)hd->axes[0].count * hd->axes[1].count)
+    {
+        snprintf(error, error_length, "truncated sweep file");
+        goto fail;
+    }
+
+    reader->header  = hd;
+    reader->expr    = (const char *)(base + sizeof(*hd));
+    reader->records = (const sweep_record_t *)(base + offset);
+    return 1;
+
+fail:
+    sweep_close_reader(reader);
+    return 0;
+}
+
+void sweep_close_reader(sweep_reader_t *reader)
+{
+    pf_unmap_file(&reader->mapping);
+    reader->header  = NULL;
+    reader->expr    = NULL;
+    reader->records = NULL;
+}
+
+double sweep_field(const sweep_record_t *record, u32 field)
+{
+    switch (field)
+    {
+        case SWEEP_FINAL:   return record->final;
+        case SWEEP_MAX_ABS: return record->max_abs;
+        case SWEEP_END_X:   return record->end_x;
+        default:            return record->events;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "common.h"
+#include "platform.h"
+#include "pool.h"
+#include "system.h"
+#include "event.h"
+#include "solve.h"
+#include "diverge.h"
+#include <stdio.h>
+
+// summary file of a sweep over a grid of two axes, native byte order:
+//   sweep_header_t, expression text padded to 8 bytes,
+//   one sweep_record_t per grid point, the first axis running fastest
+#define SWEEP_MAGIC "ERKSWEP"
+#define SWEEP_VERSION 2
+#define SWEEP_BYTE_ORDER 0x01020304
+#define SWEEP_NAME_LENGTH 8
+#define SWEEP_METHOD_LENGTH 16
+// grid points a worker takes at a time, and writes out together
+#define SWEEP_GRAIN 16
+
+enum
+{
+    SWEEP_FINAL = 0,
+    SWEEP_MAX_ABS,
+    SWEEP_END_X,
+    SWEEP_EVENTS,
+    SWEEP_FIELD_COUNT,
+};
+
+enum
+{
+    SWEEP_BLOWUP  = 1, // the run diverged (diverge.h)
+    SWEEP_STOPPED = 2, // a terminal event ended the run
+    SWEEP_FAILED  = 4, // the solver gave up for other reasons
+};
+
+// an axis sets a parameter or, for the slots 1..dim, an initial value.
+// slot 0 sets nothing, a one axis sweep has a second axis of count 1 there
+typedef struct sweep_axis_t
+{
+    char name[SWEEP_NAME_LENGTH];
+    u32 slot;
+    u32 count;
+    double lo, hi;
+} sweep_axis_t;
+
+typedef struct sweep_record_t
+{
+    double final;   // first component at end_x
+    double max_abs; // largest |y_i| along the run
+    double end_x;   // x1, where a stop ended the run, or the last point before a blow-up
+    u32 events;     // crossings of the event functions
+    u32 flags;
+} sweep_record_t;
+
+typedef struct sweep_header_t
+{
+    char magic[8];
+    u32 version;
+    u32 byte_order;
+    u32 dim;
+    u32 expr_length;
+    char method[SWEEP_METHOD_LENGTH];
+    double x0, x1, h;
+    double limit, growth;
+    sweep_axis_t axes[2];
+} sweep_header_t;
+
+typedef struct sweep_worker_t
+{
+    mexp_program_t prog;
+    event_monitor_t monitor;
+    u64 evals;
+    u32 blowups, stops, failures;
+} sweep_worker_t;
+
+// the system is compiled once, every worker runs its own copy of the
+// program against its own variable slots and event monitor
+typedef struct sweep_t
+{
+    const system_t *sys;
+    solver_t solver;
+    solve_params_t params; // y0 holds the initial values no axis sets
+    double param_values[128];
+    sweep_axis_t axes[2];
+    diverge_t diverge;
+
+    sweep_worker_t *workers;
+    u32 worker_count;
+
+    // filled in by run_sweep
+    FILE *fp;
+    u64 offset; // of the first record
+    pf_mutex_t lock;
+    int write_failed;
+    u64 evals;
+    u32 blowups, stops, failures;
+    double seconds;
+} sweep_t;
+
+// the slot of a parameter letter or a component label, optionally with a
+// trailing 0 ("y0" for y)
+int  sweep_find_slot(const system_t *sys, const char *name, u32 *slot);
+static inline double sweep_axis_value(const sweep_axis_t *axis, u32 i)
+{ return axis->count > 1 ? axis->lo + (axis->hi - axis->lo) * i / (axis->count - 1) : axis->lo; }
+
+// the caller fills in solver, params, param_values, axes and diverge after
+// this. events are parsed with the parser the system came from, once per
+// worker
+int  init_sweep(sweep_t *sweep, pool_t *pool, const system_t *sys, mexp_parser_t *parser,
+                const char *const *events, const int *terminal, u32 event_count);
+void destroy_sweep(sweep_t *sweep);
+// writes the header, then streams the records to fp as workers finish them
+int  run_sweep(sweep_t *sweep, pool_t *pool, FILE *fp, const char *expr);
+
+typedef struct sweep_reader_t
+{
+    pf_mapping_t mapping;
+    const sweep_header_t *header;
+    const char *expr;
+    const sweep_record_t *records;
+} sweep_reader_t;
+
+int  sweep_open_reader(sweep_reader_t *reader, const char *file_name, char *error, size_t error_length);
+void sweep_close_reader(sweep_reader_t *reader);
+double sweep_field(const sweep_record_t *record, u32 field);
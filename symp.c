@@ -0,0 +1,241 @@
+#include "symp.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SYMP_MAX_WEIGHTS 3
+
+// a composition of the second order step with substeps of w * h
+typedef struct
+{
+    const char *name;
+    u32 order;
+    int kick_first;
+    u32 count;
+    double w[SYMP_MAX_WEIGHTS];
+} symp_method_t;
+
+// the triple jump w1, -2^(1/3) w1, w1 with w1 = 1 / (2 - 2^(1/3))
+#define SYMP_W1  1.3512071919596576
+#define SYMP_W0 -1.7024143839193153
+
+static const symp_method_t symp__methods[] =
+{
+    {"VERLET",     2, 1, 1, {1}},
+    {"LEAPFROG",   2, 0, 1, {1}},
+    {"YOSHIDA4",   4, 1, 3, {SYMP_W1, SYMP_W0, SYMP_W1}},
+    {"FORESTRUTH", 4, 0, 3, {SYMP_W1, SYMP_W0, SYMP_W1}},
+};
+
+int symp_layout(const ode_t *ode, symp_layout_t *layout)
+{
+    const mexp_program_t *prog = ode->prog;
+    const u32 dim = ode->dim;
+    int role[ODE_MAX_DIM]; // 0 unknown, 1 position, 2 velocity
+    u32 vel_of[ODE_MAX_DIM];
+    u8 *reach;
+
+    memset(layout, 0, sizeof(*layout));
+    memset(role, 0, sizeof(role));
+    for (u32 c = 0; c < dim; c ++)
+    {
+        const mexp_instr_t *in = &prog->code[prog->outputs[c]];
+        if (in->op == MEXP_OP_VARIABLE && in->a >= 1 && (u32)in->a <= dim && (u32)in->a - 1 != c)
+        {
+            vel_of[c] = in->a - 1;
+            role[c] = 1;
+        }
+    }
+    for (u32 c = 0; c < dim; c ++)
+    {
+        if (role[c] != 1)
+            continue;
+        if (role[vel_of[c]] != 0)
+            return 0; // a position or taken twice
+        role[vel_of[c]] = 2;
+        layout->pos[layout->count] = c;
+        layout->vel[layout->count ++] = vel_of[c];
+    }
+    if (2 * layout->count != dim)
+        return 0;
+
+    // operands come before their instruction, so one pass from the back
+    // marks everything the forces read
+    reach = (u8 *)calloc(prog->count ? prog->count : 1, 1);
+    if (!reach)
+        return 0;
+    for (u32 k = 0; k < layout->count; k ++)
+        reach[prog->outputs[layout->vel[k]]] = 1;
+    int ok = 1;
+    for (u32 i = prog->count; i -- > 0;)
+    {
+        const mexp_instr_t *in = &prog->code[i];
+        if (!reach[i])
+            continue;
+        if (in->op == MEXP_OP_VARIABLE)
+        {
+            if (in->a >= 1 && (u32)in->a <= dim && role[in->a - 1] == 2)
+                ok = 0;
+        }
+        else if (in->op != MEXP_OP_NUMBER)
+        {
+            reach[in->a] = 1;
+            if (in->op != MEXP_OP_CALL)
+                reach[in->b] = 1;
+        }
+    }
+    free(reach);
+    return ok;
+}
+
+typedef struct
+{
+    const symp_layout_t *layout;
+    ode_t *ode;
+    double f[ODE_MAX_DIM];
+    int fresh; // f belongs to the current positions and x
+} symp_state_t;
+
+static void symp__kick(symp_state_t *s, double x, double *y, double h)
+{
+    const symp_layout_t *l = s->layout;
+    if (!s->fresh)
+    {
+        ode_eval(s->ode, x, y, s->f);
+        s->fresh = 1;
+    }
+    for (u32 k = 0; k < l->count; k ++)
+        y[l->vel[k]] += h * s->f[l->vel[k]];
+}
+
+static void symp__drift(symp_state_t *s, double *y, double h)
+{
+    const symp_layout_t *l = s->layout;
+    for (u32 k = 0; k < l->count; k ++)
+        y[l->pos[k]] += h * y[l->vel[k]];
+    s->fresh = 0;
+}
+
+// x is a position of unit velocity, so the kicks see the time the
+// positions are at and x dependent forces keep the order. the closing kick
+// takes x_end, so the f it leaves for the next step is the one a run
+// restarted there computes
+static void symp__step(symp_state_t *s, const symp_method_t *m, double x, double x_end, double *y, double h)
+{
+    for (u32 i = 0; i < m->count; i ++)
+    {
+        const double wh = m->w[i] * h;
+        if (m->kick_first)
+        {
+            symp__kick(s, x, y, 0.5 * wh);
+            symp__drift(s, y, wh);
+            x = i + 1 < m->count ? x + wh : x_end;
+            symp__kick(s, x, y, 0.5 * wh);
+        }
+        else
+        {
+            symp__drift(s, y, 0.5 * wh);
+            x += 0.5 * wh;
+            symp__kick(s, x, y, wh);
+            symp__drift(s, y, 0.5 * wh);
+            x += 0.5 * wh;
+        }
+    }
+}
+
+static int symp__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const symp_method_t *m = &symp__methods[solver->variant];
+    symp_layout_t layout;
+    symp_state_t s;
+    double y[ODE_MAX_DIM];
+
+    if (!symp_layout(ode, &layout))
+        return 0;
+    s.layout = &layout;
+    s.ode = ode;
+    s.fresh = 0;
+    memcpy(y, p->y0, sizeof(y));
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, solve_step_x(p, n, p->first_step), y, ode->dim))
+        return 0;
+    for (u64 i = p->first_step; i < n; i ++)
+    {
+        symp__step(&s, m, solve_step_x(p, n, i), solve_step_x(p, n, i + 1), y, solve_step_h(p, n, i));
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, i + 1), y, ode->dim))
+            return 0;
+    }
+    return 1;
+}
+
+u32 symp_solver_count(void)
+{
+    return sizeof(symp__methods) / sizeof(symp__methods[0]);
+}
+
+void symp_solver(u32 index, solver_t *solver)
+{
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), "%s", symp__methods[index].name);
+    solver->order    = symp__methods[index].order;
+    solver->adaptive = 0;
+    solver->run      = symp__solve;
+    solver->variant  = index;
+    solver->restartable = 1;
+}
+
+int init_symp_energy(symp_energy_t *energy, const ode_t *ode)
+{
+    memset(energy, 0, sizeof(*energy));
+    energy->ode = *ode;
+    energy->ode.evals = 0;
+    return symp_layout(ode, &energy->layout);
+}
+
+// 5 point gauss-legendre on [0, 1], exact for the work along a segment up
+// to degree 9 in its parameter
+static const double symp__gauss_t[5] =
+{
+    0.046910077030668004, 0.23076534494715845, 0.5, 0.76923465505284155, 0.95308992296933200,
+};
+static const double symp__gauss_w[5] =
+{
+    0.11846344252809454, 0.23931433524968324, 0.28444444444444444, 0.23931433524968324, 0.11846344252809454,
+};
+
+double symp_energy_point(symp_energy_t *energy, double x, const double *y)
+{
+    const symp_layout_t *l = &energy->layout;
+    double kinetic = 0;
+    for (u32 k = 0; k < l->count; k ++)
+        kinetic += 0.5 * y[l->vel[k]] * y[l->vel[k]];
+
+    if (energy->points)
+    {
+        double z[ODE_MAX_DIM], f[ODE_MAX_DIM], dq[ODE_MAX_DIM / 2], work = 0;
+        memcpy(z, y, energy->ode.dim * sizeof(*z));
+        for (u32 k = 0; k < l->count; k ++)
+            dq[k] = y[l->pos[k]] - energy->q[k];
+        for (u32 g = 0; g < 5; g ++)
+        {
+            for (u32 k = 0; k < l->count; k ++)
+                z[l->pos[k]] = energy->q[k] + symp__gauss_t[g] * dq[k];
+            ode_eval(&energy->ode, x, z, f);
+            for (u32 k = 0; k < l->count; k ++)
+                work += symp__gauss_w[g] * f[l->vel[k]] * dq[k];
+        }
+        energy->potential -= work;
+    }
+    for (u32 k = 0; k < l->count; k ++)
+        energy->q[k] = y[l->pos[k]];
+
+    double e = kinetic + energy->potential;
+    if (!energy->points ++)
+        energy->e0 = e;
+    energy->max_drift = fmax(energy->max_drift, fabs(e - energy->e0));
+    return e;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+// the state of a separable second order system: y'_pos[k] = y_vel[k] and
+// y'_vel[k] = f_k(x, positions), as "y'' = f" or "y' = v; v' = f" give it
+typedef struct symp_layout_t
+{
+    u32 count;
+    u32 pos[ODE_MAX_DIM / 2];
+    u32 vel[ODE_MAX_DIM / 2];
+} symp_layout_t;
+
+// splitting methods for separable second order systems: the drift moves
+// the positions by their velocities, the kick moves the velocities by the
+// forces, each exactly. verlet and its yoshida composition kick first,
+// leapfrog and forest-ruth drift first. they are symplectic, so on a
+// hamiltonian problem the energy error stays bounded over any number of
+// steps instead of drifting, and do not adapt the step. any other system
+// makes the run fail
+u32  symp_solver_count(void);
+void symp_solver(u32 index, solver_t *solver);
+
+// returns 0 unless every component is a position whose derivative is
+// another component's value or a velocity whose derivative does not read
+// any velocity
+int  symp_layout(const ode_t *ode, symp_layout_t *layout);
+
+// energy of a run for the drift diagnostic: the kinetic part is half the
+// squared velocities and the potential is minus the work of the forces,
+// integrated along the straight segments between consecutive points. it is
+// conserved for forces that are gradients and do not depend on x
+typedef struct symp_energy_t
+{
+    symp_layout_t layout;
+    ode_t ode; // own variables and eval count, the program is shared
+    double q[ODE_MAX_DIM / 2];
+    double potential;
+    double e0;
+    double max_drift;
+    u64 points;
+} symp_energy_t;
+
+int    init_symp_energy(symp_energy_t *energy, const ode_t *ode);
+// feeds the next point of the run and returns its energy
+double symp_energy_point(symp_energy_t *energy, double x, const double *y);
@@ -0,0 +1,235 @@
+#include "system.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SYSTEM_MAX_TEXT 1024
+
+#if defined(_MSC_VER)
+#define SYSTEM_PRINTF(fmt, args)
+#else
+#define SYSTEM_PRINTF(fmt, args) __attribute__((format(printf, fmt, args)))
+#endif
+
+#define ISALPHA(ch) (((ch) >= 'a' && (ch) <= 'z') || ((ch) >= 'A' && (ch) <= 'Z'))
+#define ISSPACE(ch) ((ch) == ' ' || (ch) == '\t' || (ch) == '\r' || (ch) == '\n')
+
+typedef struct
+{
+    const char *rhs;
+    u32 rhs_length;
+    char name;
+    u32 order;
+    u32 first; // state index of name itself
+} system_equation_t;
+
+int init_system(system_t *sys)
+{
+    memset(sys, 0, sizeof(*sys));
+    for (u32 i = 0; i < ODE_MAX_DIM; i ++)
+        if (!mexp_init_tree(&sys->trees[i]))
+            return 0;
+    return mexp_init_program(&sys->prog);
+}
+
+void destroy_system(system_t *sys)
+{
+    for (u32 i = 0; i < ODE_MAX_DIM; i ++)
+        mexp_free_tree(&sys->trees[i]);
+    mexp_free_program(&sys->prog);
+}
+
+static int system__fail(system_t *sys, const char *format, ...) SYSTEM_PRINTF(2, 3);
+static int system__fail(system_t *sys, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(sys->error, sizeof(sys->error), format, args);
+    va_end(args);
+    sys->dim = 0;
+    return 0;
+}
+
+// state index of name with the given number of primes, -1 if it is not in the state
+static int system__find(const system_equation_t *eqs, u32 count, char name, u32 primes)
+{
+    for (u32 i = 0; i < count; i ++)
+        if (eqs[i].name == name && primes < eqs[i].order)
+            return eqs[i].first + primes;
+    return -1;
+}
+
+// lone letters the way the mexp tokenizer sees them, a letter followed by
+// another starts a function name that runs over letters and digits
+static int system__add_params(system_t *sys, const char *rhs, u32 length)
+{
+    for (u32 j = 0; j < length; j ++)
+    {
+        char ch = rhs[j];
+        if (!ISALPHA(ch))
+            continue;
+        if (j + 1 < length && ISALPHA(rhs[j + 1]))
+        {
+            while (j + 1 < length && (ISALPHA(rhs[j + 1]) || (rhs[j + 1] >= '0' && rhs[j + 1] <= '9'))) j ++;
+            continue;
+        }
+        int known = ch == 'x' || memchr(sys->params, ch, sys->param_count) != NULL;
+        for (u32 c = 0; c < sys->dim && !known; c ++)
+            known = sys->vars[c] == ch;
+        if (known)
+            continue;
+        if (sys->param_count >= SYSTEM_MAX_PARAMS || sys->dim + sys->param_count >= ODE_MAX_VARS - 1)
+            return 0;
+        sys->params[sys->param_count ++] = ch;
+    }
+    return 1;
+}
+
+int parse_system(system_t *sys, mexp_parser_t *parser, const char *text, u32 length)
+{
+    system_equation_t eqs[ODE_MAX_DIM];
+    u32 count = 0, dim = 0;
+    int used[128] = {0}, bare = 0;
+    sys->dim = 0;
+    sys->param_count = 0;
+    sys->error[0] = 0;
+
+    for (u32 i = 0; i < length; i ++)
+        if ((u8)text[i] < 128) used[(u8)text[i]] = 1;
+
+    // split into equations and read the left hand sides
+    const char *at = text, *last = text + length;
+    while (at < last)
+    {
+        const char *end = at;
+        while (end < last && *end != ';' && *end != '\n') end ++;
+        const char *eq = at;
+        while (eq < end && *eq != '=') eq ++;
+
+        const char *s = at;
+        while (s < end && ISSPACE(*s)) s ++;
+        if (s < end)
+        {
+            system_equation_t *e = &eqs[count];
+            if (count >= ODE_MAX_DIM)
+                return system__fail(sys, "too many equations");
+            if (eq == end)
+            {
+                // a lone expression is y' = f
+                bare = 1;
+                e->name = 'y';
+                e->order = 1;
+                e->rhs = at;
+                e->rhs_length = (u32)(end - at);
+            }
+            else
+            {
+                const char *l = s;
+                e->name = *l ++;
+                e->order = 0;
+                while (l < eq && *l == '\'') { e->order ++; l ++; }
+                while (l < eq && ISSPACE(*l)) l ++;
+                if (!ISALPHA(e->name) || e->name == 'x' || e->order == 0 || l != eq)
+                    return system__fail(sys, "expected name' = ... in '%.*s'", (int)(end - at), at);
+                e->rhs = eq + 1;
+                e->rhs_length = (u32)(end - eq - 1);
+            }
+            if (bare && count > 0)
+                return system__fail(sys, "systems need name' = ... for every equation");
+            for (u32 i = 0; i < count; i ++)
+                if (eqs[i].name == e->name)
+                    return system__fail(sys, "'%c' has two equations", e->name);
+            if (dim + e->order > ODE_MAX_DIM)
+                return system__fail(sys, "more than 16 state components");
+            e->first = dim;
+            dim += e->order;
+            count ++;
+        }
+        at = end + 1;
+    }
+    if (count == 0)
+        return system__fail(sys, "empty expression");
+
+    // derivatives get letters the text does not use
+    char next = 'A';
+    for (u32 i = 0; i < count; i ++)
+    {
+        for (u32 k = 0; k < eqs[i].order; k ++)
+        {
+            u32 c = eqs[i].first + k;
+            if (k == 0)
+                sys->vars[c] = eqs[i].name;
+            else
+            {
+                while (next <= 'z' && (used[(u8)next] || !ISALPHA(next))) next ++;
+                if (next > 'z')
+                    return system__fail(sys, "out of variable names");
+                sys->vars[c] = next;
+                used[(u8)next] = 1;
+            }
+            snprintf(sys->labels[c], SYSTEM_LABEL_LENGTH, "%c%.*s", eqs[i].name, (int)k, "''''''''''''''''");
+        }
+    }
+
+    // y', y'' ... on the right hand sides become their state letters
+    char rhs[ODE_MAX_DIM][SYSTEM_MAX_TEXT];
+    u32 rhs_length[ODE_MAX_DIM];
+    sys->dim = dim;
+    for (u32 i = 0; i < count; i ++)
+    {
+        const system_equation_t *e = &eqs[i];
+        u32 n = 0;
+        for (u32 j = 0; j < e->rhs_length; j ++)
+        {
+            char ch = e->rhs[j];
+            if (n >= SYSTEM_MAX_TEXT)
+                return system__fail(sys, "equation too long");
+            if (ISALPHA(ch) && j + 1 < e->rhs_length && e->rhs[j + 1] == '\'' && (j == 0 || !ISALPHA(e->rhs[j - 1])))
+            {
+                u32 primes = 0;
+                while (j + 1 < e->rhs_length && e->rhs[j + 1] == '\'') { primes ++; j ++; }
+                int c = system__find(eqs, count, ch, primes);
+                if (c == -1)
+                {
+                    snprintf(sys->error, sizeof(sys->error), "%c%.*s is not part of the state", ch, (int)primes, "''''''''''''''''");
+                    sys->dim = 0;
+                    return 0;
+                }
+                rhs[i][n ++] = sys->vars[c];
+                continue;
+            }
+            rhs[i][n ++] = ch;
+        }
+        rhs_length[i] = n;
+        if (!system__add_params(sys, rhs[i], n))
+            return system__fail(sys, "too many parameters");
+    }
+
+    mexp_clear_variables(parser);
+    mexp_add_variable(parser, 'x');
+    for (u32 c = 0; c < dim; c ++)
+        mexp_add_variable(parser, sys->vars[c]);
+    for (u32 k = 0; k < sys->param_count; k ++)
+        mexp_add_variable(parser, sys->params[k]);
+
+    for (u32 i = 0; i < count; i ++)
+    {
+        const system_equation_t *e = &eqs[i];
+        // the lower derivatives just hand over to the next component
+        for (u32 k = 0; k + 1 < e->order; k ++)
+            if (!mexp_generate_tree(&sys->trees[e->first + k], parser, &sys->vars[e->first + k + 1], 1))
+                return system__fail(sys, "%s", mexp_get_error(parser));
+        if (!mexp_generate_tree(&sys->trees[e->first + e->order - 1], parser, rhs[i], rhs_length[i]))
+            return system__fail(sys, "%s", mexp_get_error(parser));
+    }
+
+    if (!mexp_compile_program(&sys->prog, sys->trees, dim))
+        return system__fail(sys, "could not compile");
+    return 1;
+}
+
+void system_bind(const system_t *sys, ode_t *ode, const double *values)
+{
+    for (u32 k = 0; k < sys->param_count; k ++)
+        ode->vars[system_param_slot(sys, k)] = values[(u8)sys->params[k]];
+}
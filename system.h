@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+#include "mexp.h"
+#include "ode.h"
+
+#define SYSTEM_LABEL_LENGTH (ODE_MAX_DIM + 2)
+#define SYSTEM_MAX_PARAMS (ODE_MAX_VARS - 1 - ODE_MAX_DIM)
+#define SYSTEM_PARAM_DEFAULT 1.0
+
+// a set of first order equations built from text: a bare "f" is y' = f,
+// otherwise ';' separated "y' = ...", "z'' = ..." equations. an equation of
+// order k puts y, y', ..., y^(k-1) into the state and those derivatives may
+// appear on any right hand side. all right hand sides are compiled into one
+// program so shared subexpressions are evaluated once per step. any other
+// lone letter on a right hand side is a parameter, read from the variable
+// slot after the state so it can change between runs without reparsing
+typedef struct system_t
+{
+    u32 dim;
+    char vars[ODE_MAX_DIM]; // parser variable of each component
+    u32 param_count;
+    char params[SYSTEM_MAX_PARAMS];
+    char labels[ODE_MAX_DIM][SYSTEM_LABEL_LENGTH];
+    mexp_tree_t trees[ODE_MAX_DIM];
+    mexp_program_t prog;
+    char error[MEXP_ERROR_LENGTH + 1];
+} system_t;
+
+int  init_system(system_t *sys);
+void destroy_system(system_t *sys);
+
+// replaces the parser's variables with x, the state components and the
+// parameters in slot order
+int  parse_system(system_t *sys, mexp_parser_t *parser, const char *text, u32 length);
+
+// values holds one entry per letter, indexed by the character itself
+void system_bind(const system_t *sys, ode_t *ode, const double *values);
+
+static inline u32 system_param_slot(const system_t *sys, u32 param)
+{ return 1 + sys->dim + param; }
@@ -0,0 +1,80 @@
+#include "task.h"
+#include <stdlib.h>
+
+static void task__thread(void *user)
+{
+    task_t *task = (task_t *)user;
+
+    pf_lock(&task->lock);
+    while (1)
+    {
+        while (!task->quit && task->posted == task->taken)
+            pf_wait(&task->wake, &task->lock);
+        if (task->quit) break;
+        u32 generation = task->taken = task->posted;
+        memcpy(task->running, task->pending, task->job_size);
+        task->busy = 1;
+        pf_unlock(&task->lock);
+
+        task->fn(task->user, task->running, generation);
+
+        pf_lock(&task->lock);
+        task->busy = 0;
+        pf_broadcast(&task->idle);
+    }
+    pf_unlock(&task->lock);
+}
+
+int init_task(task_t *task, task_fn fn, void *user, u32 job_size)
+{
+    task->fn = fn;
+    task->user = user;
+    task->job_size = job_size;
+    task->posted = 0;
+    task->taken = 0;
+    task->busy = 0;
+    task->quit = 0;
+    task->pending = malloc(job_size);
+    task->running = malloc(job_size);
+    if (!task->pending || !task->running) return 0;
+    if (!pf_init_mutex(&task->lock)) return 0;
+    if (!pf_init_cond(&task->wake)) return 0;
+    if (!pf_init_cond(&task->idle)) return 0;
+    return pf_create_thread(&task->thread, task__thread, task);
+}
+
+void destroy_task(task_t *task)
+{
+    pf_lock(&task->lock);
+    task->quit = 1;
+    // a queued job is dropped, a running one that polls task_cancelled sees
+    // the bump and stops at its next check, others run to their end
+    pf_atomic_add(&task->posted, 1);
+    pf_signal(&task->wake);
+    pf_unlock(&task->lock);
+    pf_join_thread(&task->thread);
+
+    pf_destroy_cond(&task->wake);
+    pf_destroy_cond(&task->idle);
+    pf_destroy_mutex(&task->lock);
+    free(task->pending);
+    free(task->running);
+}
+
+void finish_task(task_t *task)
+{
+    pf_lock(&task->lock);
+    while (task->busy || task->posted != task->taken)
+        pf_wait(&task->idle, &task->lock);
+    pf_unlock(&task->lock);
+}
+
+u32 post_task(task_t *task, const void *job)
+{
+    pf_lock(&task->lock);
+    memcpy(task->pending, job, task->job_size);
+    u32 generation = pf_atomic_add(&task->posted, 1) + 1;
+    pf_signal(&task->wake);
+    pf_unlock(&task->lock);
+    return generation;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+#include "platform.h"
+
+// one background thread that runs the newest posted job. posting copies the
+// job, so the caller may reuse its buffer, and supersedes whatever is still
+// queued or running; long jobs poll task_cancelled to give up early.
+// destroy_task drops a queued job, finish_task first waits for it
+typedef struct task_t task_t;
+typedef void (*task_fn)(void *user, const void *job, u32 generation);
+
+struct task_t
+{
+    pf_thread_t thread;
+    pf_mutex_t lock;
+    pf_cond_t wake;
+    pf_cond_t idle; // signalled when a job returns
+    task_fn fn;
+    void *user;
+    u32 job_size;
+    void *pending, *running;
+    volatile u32 posted; // generation of the newest job
+    u32 taken;           // generation copied into running
+    int busy;
+    int quit;
+};
+
+int  init_task(task_t *task, task_fn fn, void *user, u32 job_size);
+void destroy_task(task_t *task);
+// returns once the newest posted job has run to its end
+void finish_task(task_t *task);
+u32  post_task(task_t *task, const void *job);
+
+static inline int task_cancelled(task_t *task, u32 generation)
+{ return pf_atomic_load(&task->posted) != generation; }
@@ -0,0 +1,426 @@
+#include "taylor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TAYLOR_SAFETY 0.9
+
+enum
+{
+    TAYLOR_NUMBER = 0, // numbers and parameters
+    TAYLOR_X,
+    TAYLOR_Y,
+    TAYLOR_ADD,
+    TAYLOR_SUB,
+    TAYLOR_MUL,
+    TAYLOR_DIV,
+    TAYLOR_POW_INT,   // repeated products, aux holds the powers 2 .. n - 1
+    TAYLOR_POW_CONST, // constant exponent, needs the base away from 0
+    TAYLOR_POW,       // exp(b log a), aux holds log a and b log a
+    TAYLOR_SIN,       // aux holds the cosine
+    TAYLOR_COS,       // aux holds the sine
+    TAYLOR_TAN,       // aux holds 1 + tan^2
+    TAYLOR_EXP,
+    TAYLOR_LOG,
+    TAYLOR_SQRT,
+};
+
+typedef struct
+{
+    u32 kind;
+    u32 a, b;   // series of the operands
+    u32 aux;    // first private series
+    double value; // numbers, the exponent of constant powers
+    u32 power;
+} taylor_op_t;
+
+typedef struct taylor_t
+{
+    mexp_program_t *prog;
+    u32 order, dim, stride;
+    taylor_op_t *ops;
+    // stride coefficients per series: the registers, then y, then the aux series
+    double *jet;
+    u32 y_first;
+} taylor_t;
+
+static const struct
+{
+    const char *name;
+    u32 kind, aux;
+}
+taylor__funcs[] =
+{
+    {"sin",  TAYLOR_SIN,  1},
+    {"cos",  TAYLOR_COS,  1},
+    {"tan",  TAYLOR_TAN,  1},
+    {"exp",  TAYLOR_EXP,  0},
+    {"log",  TAYLOR_LOG,  0},
+    {"sqrt", TAYLOR_SQRT, 0},
+};
+
+static inline double *taylor__series(const taylor_t *t, u32 index)
+{
+    return t->jet + (size_t)index * t->stride;
+}
+
+// sum of a[j] b[k - j] for j in [lo, hi]
+static inline double taylor__dot(const double *a, const double *b, u32 lo, u32 hi, u32 k)
+{
+    double s = 0;
+    for (u32 j = lo; j <= hi; j ++)
+        s += a[j] * b[k - j];
+    return s;
+}
+
+// sum of j a[j] b[k - j] for j in [1, hi], the derivative rules all share it
+static inline double taylor__dot_d(const double *a, const double *b, u32 hi, u32 k)
+{
+    double s = 0;
+    for (u32 j = 1; j <= hi; j ++)
+        s += j * a[j] * b[k - j];
+    return s;
+}
+
+// coefficient k of instruction i, the ones below k are all known
+static void taylor__coefficient(taylor_t *t, u32 i, u32 k)
+{
+    const taylor_op_t *op = &t->ops[i];
+    double *c = taylor__series(t, i);
+    const double *a = taylor__series(t, op->a), *b = taylor__series(t, op->b);
+    switch (op->kind)
+    {
+        case TAYLOR_NUMBER : c[k] = k == 0 ? op->value : 0; break;
+        case TAYLOR_X      : c[k] = k == 0 ? op->value : k == 1 ? 1 : 0; break;
+        case TAYLOR_Y      : c[k] = a[k]; break;
+        case TAYLOR_ADD    : c[k] = a[k] + b[k]; break;
+        case TAYLOR_SUB    : c[k] = a[k] - b[k]; break;
+        case TAYLOR_MUL    : c[k] = taylor__dot(a, b, 0, k, k); break;
+        case TAYLOR_DIV    : c[k] = (a[k] - (k ? taylor__dot(c, b, 0, k - 1, k) : 0)) / b[0]; break;
+        case TAYLOR_POW_INT:
+        {
+            if (op->power == 0)
+            {
+                c[k] = k == 0;
+                break;
+            }
+            const double *p = a;
+            for (u32 m = 2; m <= op->power; m ++)
+            {
+                double *q = m == op->power ? c : taylor__series(t, op->aux + m - 2);
+                q[k] = taylor__dot(a, p, 0, k, k);
+                p = q;
+            }
+            if (op->power == 1)
+                c[k] = a[k];
+            break;
+        }
+        case TAYLOR_POW_CONST:
+        {
+            const double r = op->value;
+            if (k == 0)
+            {
+                c[0] = pow(a[0], r);
+                break;
+            }
+            double s = 0;
+            for (u32 j = 1; j <= k; j ++)
+                s += ((r + 1) * j - k) * a[j] * c[k - j];
+            c[k] = s / (k * a[0]);
+            break;
+        }
+        case TAYLOR_POW:
+        {
+            double *l = taylor__series(t, op->aux), *m = taylor__series(t, op->aux + 1);
+            l[k] = k == 0 ? log(a[0]) : (a[k] - taylor__dot_d(l, a, k - 1, k) / k) / a[0];
+            m[k] = taylor__dot(b, l, 0, k, k);
+            c[k] = k == 0 ? exp(m[0]) : taylor__dot_d(m, c, k, k) / k;
+            break;
+        }
+        case TAYLOR_SIN:
+        case TAYLOR_COS:
+        {
+            double *s = op->kind == TAYLOR_SIN ? c : taylor__series(t, op->aux);
+            double *o = op->kind == TAYLOR_SIN ? taylor__series(t, op->aux) : c;
+            if (k == 0)
+            {
+                s[0] = sin(a[0]);
+                o[0] = cos(a[0]);
+                break;
+            }
+            s[k] =  taylor__dot_d(a, o, k, k) / k;
+            o[k] = -taylor__dot_d(a, s, k, k) / k;
+            break;
+        }
+        case TAYLOR_TAN:
+        {
+            double *u = taylor__series(t, op->aux);
+            c[k] = k == 0 ? tan(a[0]) : taylor__dot_d(a, u, k, k) / k;
+            u[k] = taylor__dot(c, c, 0, k, k) + (k == 0);
+            break;
+        }
+        case TAYLOR_EXP  : c[k] = k == 0 ? exp(a[0]) : taylor__dot_d(a, c, k, k) / k; break;
+        case TAYLOR_LOG  : c[k] = k == 0 ? log(a[0]) : (a[k] - taylor__dot_d(c, a, k - 1, k) / k) / a[0]; break;
+        case TAYLOR_SQRT : c[k] = k == 0 ? sqrt(a[0]) : (a[k] - (k > 1 ? taylor__dot(c, c, 1, k - 1, k) : 0)) / (2 * c[0]); break;
+    }
+}
+
+// the kinds follow the instructions, constants are folded by value once so
+// that an exponent knows whether it is an integer
+static int taylor__plan(taylor_t *t, ode_t *ode)
+{
+    mexp_program_t *prog = ode->prog;
+    const u32 count = prog->count;
+    double out[ODE_MAX_DIM];
+    u8 *constant = (u8 *)calloc(count ? count : 1, 1);
+    u32 aux = count + t->dim;
+    int ok = constant != NULL;
+
+    mexp_eval_program(prog, ode->vars, out);
+    for (u32 i = 0; ok && i < count; i ++)
+    {
+        const mexp_instr_t *in = &prog->code[i];
+        taylor_op_t *op = &t->ops[i];
+        // leaves keep a and b at 0 so that every operand pointer stays in the jet
+        int leaf = in->op == MEXP_OP_NUMBER || in->op == MEXP_OP_VARIABLE;
+        op->a = !leaf && in->a >= 0 ? (u32)in->a : 0;
+        op->b = !leaf && in->b >= 0 ? (u32)in->b : 0;
+        switch (in->op)
+        {
+            case MEXP_OP_NUMBER:
+                op->kind = TAYLOR_NUMBER;
+                op->value = in->value;
+                constant[i] = 1;
+                break;
+            case MEXP_OP_VARIABLE:
+                if (in->a == 0)
+                {
+                    op->kind = TAYLOR_X;
+                }
+                else if ((u32)in->a <= t->dim)
+                {
+                    op->kind = TAYLOR_Y;
+                    op->a = t->y_first + in->a - 1;
+                }
+                else
+                {
+                    op->kind = TAYLOR_NUMBER;
+                    op->value = ode->vars[in->a];
+                    constant[i] = 1;
+                }
+                break;
+            case MEXP_OP_ADD: op->kind = TAYLOR_ADD; break;
+            case MEXP_OP_SUB: op->kind = TAYLOR_SUB; break;
+            case MEXP_OP_MUL: op->kind = TAYLOR_MUL; break;
+            case MEXP_OP_DIV: op->kind = TAYLOR_DIV; break;
+            case MEXP_OP_POW:
+            {
+                double r = prog->regs[in->b];
+                if (!constant[in->b])
+                {
+                    op->kind = TAYLOR_POW;
+                    op->aux = aux;
+                    aux += 2;
+                }
+                else if (r >= 0 && r <= TAYLOR_MAX_POWER && r == floor(r))
+                {
+                    op->kind = TAYLOR_POW_INT;
+                    op->power = (u32)r;
+                    op->aux = aux;
+                    aux += op->power > 2 ? op->power - 2 : 0;
+                }
+                else
+                {
+                    op->kind = TAYLOR_POW_CONST;
+                    op->value = r;
+                }
+                break;
+            }
+            case MEXP_OP_CALL:
+            {
+                u32 f = 0, n = sizeof(taylor__funcs) / sizeof(taylor__funcs[0]);
+                while (f < n && strncmp(in->name, taylor__funcs[f].name, sizeof(in->name)))
+                    f ++;
+                if (f == n)
+                {
+                    ok = 0;
+                    break;
+                }
+                op->kind = taylor__funcs[f].kind;
+                op->aux = aux;
+                aux += taylor__funcs[f].aux;
+                break;
+            }
+            default:
+                ok = 0;
+                break;
+        }
+        if (in->op >= MEXP_OP_ADD && in->op <= MEXP_OP_POW)
+            constant[i] = constant[in->a] && constant[in->b];
+        else if (in->op == MEXP_OP_CALL)
+            constant[i] = constant[in->a];
+    }
+    free(constant);
+
+    t->jet = ok ? (double *)calloc((size_t)aux * t->stride, sizeof(double)) : NULL;
+    return t->jet != NULL;
+}
+
+static int taylor__init(taylor_t *t, ode_t *ode, u32 order)
+{
+    memset(t, 0, sizeof(*t));
+    t->prog = ode->prog;
+    t->order = order;
+    t->dim = ode->dim;
+    t->stride = order + 1;
+    t->y_first = ode->prog->count;
+    t->ops = (taylor_op_t *)calloc(ode->prog->count ? ode->prog->count : 1, sizeof(*t->ops));
+    return t->ops && taylor__plan(t, ode);
+}
+
+static void taylor__destroy(taylor_t *t)
+{
+    free(t->ops);
+    free(t->jet);
+}
+
+// the coefficients of y(x + t) up to the order, 0 when they are not finite
+static int taylor__jet(taylor_t *t, ode_t *ode, double x, const double *y)
+{
+    const mexp_program_t *prog = t->prog;
+    const u32 n = t->order;
+
+    for (u32 i = 0; i < prog->count; i ++)
+        if (t->ops[i].kind == TAYLOR_X)
+            t->ops[i].value = x;
+    for (u32 c = 0; c < t->dim; c ++)
+        taylor__series(t, t->y_first + c)[0] = y[c];
+    for (u32 k = 0; k < n; k ++)
+    {
+        for (u32 i = 0; i < prog->count; i ++)
+            taylor__coefficient(t, i, k);
+        for (u32 c = 0; c < t->dim; c ++)
+            taylor__series(t, t->y_first + c)[k + 1] = taylor__series(t, prog->outputs[c])[k] / (k + 1);
+    }
+    // one coefficient of every register per order, counted as an evaluation each
+    ode->evals += n;
+
+    for (u32 c = 0; c < t->dim; c ++)
+    {
+        const double *s = taylor__series(t, t->y_first + c);
+        for (u32 k = 0; k <= n; k ++)
+            if (!isfinite(s[k]))
+                return 0;
+    }
+    return 1;
+}
+
+static void taylor__sum(const taylor_t *t, double h, double *y)
+{
+    for (u32 c = 0; c < t->dim; c ++)
+    {
+        const double *s = taylor__series(t, t->y_first + c);
+        double v = s[t->order];
+        for (u32 k = t->order; k-- > 0;)
+            v = v * h + s[k];
+        y[c] = v;
+    }
+}
+
+// the last two coefficients estimate the radius of convergence, the step
+// keeps both of their terms at the tolerance
+static double taylor__step(const taylor_t *t, const double *y, const solve_params_t *p)
+{
+    double h = INFINITY;
+    for (u32 k = t->order - 1; k <= t->order; k ++)
+    {
+        double norm = 0;
+        for (u32 c = 0; c < t->dim; c ++)
+        {
+            double sc = p->atol + p->rtol * fabs(y[c]);
+            norm = fmax(norm, fabs(taylor__series(t, t->y_first + c)[k]) / sc);
+        }
+        if (norm > 0)
+            h = fmin(h, pow(norm, -1.0 / k));
+    }
+    return TAYLOR_SAFETY * h;
+}
+
+static int taylor__fixed(taylor_t *t, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    double y[ODE_MAX_DIM];
+    memcpy(y, p->y0, sizeof(y));
+
+    u64 n = solve_step_count(p);
+    if (n > p->max_steps)
+        return 0;
+    if (emit && !emit(user, solve_step_x(p, n, p->first_step), y, t->dim))
+        return 0;
+    for (u64 s = p->first_step; s < n; s ++)
+    {
+        if (!taylor__jet(t, ode, solve_step_x(p, n, s), y))
+            return 0;
+        taylor__sum(t, solve_step_h(p, n, s), y);
+        stats->steps ++;
+        if (emit && !emit(user, solve_step_x(p, n, s + 1), y, t->dim))
+            return 0;
+    }
+    return 1;
+}
+
+// the step comes out of the coefficients before it is taken, so nothing is
+// ever rejected and h from the params goes unused
+static int taylor__adaptive(taylor_t *t, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    const double dir = p->x1 >= p->x0 ? 1 : -1;
+    double y[ODE_MAX_DIM], x = p->x0;
+    memcpy(y, p->y0, sizeof(y));
+
+    if (emit && !emit(user, x, y, t->dim))
+        return 0;
+    while ((p->x1 - x) * dir > 0)
+    {
+        if (stats->steps >= p->max_steps || !taylor__jet(t, ode, x, y))
+            return 0;
+        double h = taylor__step(t, y, p) * dir;
+        int last = (x + h - p->x1) * dir >= 0;
+        if (last)
+            h = p->x1 - x;
+        if (!(fabs(h) >= 1e-14 * fmax(1, fabs(x))))
+            return 0;
+
+        taylor__sum(t, h, y);
+        x = last ? p->x1 : x + h;
+        stats->steps ++;
+        if (emit && !emit(user, x, y, t->dim))
+            return 0;
+    }
+    return 1;
+}
+
+static int taylor__solve(const solver_t *solver, ode_t *ode, const solve_params_t *p, solve_emit_fn emit, void *user, solve_stats_t *stats)
+{
+    taylor_t t;
+    int ok = taylor__init(&t, ode, solver->variant);
+    if (ok)
+        ok = p->rtol > 0 ? taylor__adaptive(&t, ode, p, emit, user, stats) : taylor__fixed(&t, ode, p, emit, user, stats);
+    taylor__destroy(&t);
+    return ok;
+}
+
+u32 taylor_solver_count(void)
+{
+    return TAYLOR_MAX_ORDER / 10;
+}
+
+void taylor_solver(u32 index, solver_t *solver)
+{
+    const u32 order = 10 * (index + 1);
+    memset(solver, 0, sizeof(*solver));
+    snprintf(solver->name, sizeof(solver->name), "TAYLOR%u", order);
+    solver->order    = order;
+    solver->adaptive = 1;
+    solver->run      = taylor__solve;
+    solver->variant  = order;
+    solver->restartable = 1;
+}
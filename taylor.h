@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common.h"
+#include "solve.h"
+
+#define TAYLOR_MAX_ORDER 30
+// integer powers up to this one are repeated products, so they stay
+// analytic where the base goes through 0
+#define TAYLOR_MAX_POWER 8
+
+// taylor series method: the coefficients of y(x + t) to the solver's order
+// come from pushing truncated power series through the compiled program
+// one coefficient at a time (y_k+1 = f_k / (k + 1)), an instruction costs
+// O(order^2) per step instead of one evaluation. adaptive runs take the
+// step from the decay of the last two coefficients (jorba and zou), fixed
+// ones sum the series at h. every builtin function has its series rule, a
+// power with a variable exponent goes through log and needs a positive base
+u32  taylor_solver_count(void);
+void taylor_solver(u32 index, solver_t *solver);
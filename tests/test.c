@@ -0,0 +1,16 @@
+#include "test.h"
+
+u32 test_failures = 0;
+u32 test_checks = 0;
+
+int main(void)
+{
+    test_mexp();
+    test_rk();
+    test_solve();
+    test_abm();
+    test_traj();
+    test_pack();
+    printf("%u checks, %u failed\n", test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
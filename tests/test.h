@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../common.h"
+#include <stdio.h>
+#include <math.h>
+
+// a failed check prints where and keeps going, the runner exits 1 at the end
+extern u32 test_failures;
+extern u32 test_checks;
+
+#define TEST_CHECK(cond) do { \
+        test_checks ++; \
+        if (!(cond)) \
+        { \
+            test_failures ++; \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define TEST_NEAR(a, b, tol) do { \
+        const double test__a = (a), test__b = (b); \
+        test_checks ++; \
+        if (!(fabs(test__a - test__b) <= (tol))) \
+        { \
+            test_failures ++; \
+            fprintf(stderr, "%s:%d: %s = %.17g, expected %.17g\n", __FILE__, __LINE__, #a, test__a, test__b); \
+        } \
+    } while (0)
+
+void test_mexp(void);
+void test_rk(void);
+void test_solve(void);
+void test_abm(void);
+void test_traj(void);
+void test_pack(void);
@@ -0,0 +1,73 @@
+#include "test.h"
+#include "../solve.h"
+#include "../system.h"
+
+typedef struct
+{
+    u32 count;
+    double x, y, worst;
+} test_track_t;
+
+// keeps the last point and the worst relative error against exp(x)
+static int test__track(void *user, double x, const double *y, u32 dim)
+{
+    test_track_t *track = (test_track_t *)user;
+    const double e = fabs(y[0] - exp(x)) / exp(x);
+    (void)dim;
+    track->count ++;
+    track->x = x;
+    track->y = y[0];
+    if (e > track->worst)
+        track->worst = e;
+    return 1;
+}
+
+// an initial step far too large for the tolerance still gives an accurate
+// solution, the rk4 bootstrap points are error checked like the rest
+static void test__adaptive(const char *name, double h)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    solver_t solver;
+    solve_params_t params;
+    solve_stats_t stats;
+    test_track_t track = {0, 0, 0, 0};
+    double values[128] = {0};
+    const char *expr = "y";
+
+    mexp_init_parser(&parser);
+    init_system(&sys);
+    TEST_CHECK(parse_system(&sys, &parser, expr, (u32)strlen(expr)));
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, values);
+
+    TEST_CHECK(find_solver(&solver, name));
+    init_solve_params(&params);
+    params.x0 = 0;
+    params.x1 = 5;
+    params.h = h;
+    params.rtol = 1e-8;
+    params.atol = 1e-8;
+    params.y0[0] = 1;
+    TEST_CHECK(solve(&solver, &ode, &params, test__track, &track, &stats));
+    if (track.worst > 1e-4)
+        fprintf(stderr, "%s: h = %g strayed %g from exp(x)\n", name, h, track.worst);
+    TEST_CHECK(track.x == 5);
+    TEST_NEAR(track.y, exp(5), 1e-4 * exp(5));
+    TEST_CHECK(track.worst <= 1e-4);
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+}
+
+void test_abm(void)
+{
+    const char *names[] = { "abm2", "abm3", "abm4", "abm5", "ABM5PEC" };
+
+    for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i ++)
+    {
+        test__adaptive(names[i], 5);
+        test__adaptive(names[i], 2);
+        test__adaptive(names[i], 0.01);
+    }
+}
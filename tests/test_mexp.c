@@ -0,0 +1,51 @@
+#include "test.h"
+#include "../mexp.h"
+
+// the tree and the compiled program of expr at x, y
+static void test__eval(const char *expr, double x, double y, double expected)
+{
+    mexp_parser_t parser;
+    mexp_tree_t tree;
+    mexp_program_t prog;
+    double v[2] = {x, y}, out = NAN;
+
+    mexp_init_parser(&parser);
+    mexp_add_variable(&parser, 'x');
+    mexp_add_variable(&parser, 'y');
+    mexp_init_tree(&tree);
+    mexp_init_program(&prog);
+    if (!mexp_generate_tree(&tree, &parser, expr, (int32_t)strlen(expr)))
+    {
+        fprintf(stderr, "'%s': %s\n", expr, mexp_get_error(&parser));
+        TEST_CHECK(!"parse");
+    }
+    else
+    {
+        TEST_NEAR(mexp_eval_tree(&tree, v), expected, 1e-12 * fmax(1, fabs(expected)));
+        if (mexp_compile_program(&prog, &tree, 1))
+            mexp_eval_program(&prog, v, &out);
+        TEST_NEAR(out, expected, 1e-12 * fmax(1, fabs(expected)));
+    }
+    mexp_free_program(&prog);
+    mexp_free_tree(&tree);
+    mexp_free_parser(&parser);
+}
+
+void test_mexp(void)
+{
+    test__eval("1+2", 0, 0, 3);
+    test__eval("1-2-3", 0, 0, -4);
+    test__eval("8/4/2", 0, 0, 1);
+    test__eval("1+2*3+4", 0, 0, 11);
+    test__eval("2*3+4*5", 0, 0, 26);
+    test__eval("1+2*3^2", 0, 0, 19);
+    test__eval("1+2*3^2*2+1", 0, 0, 38);
+    test__eval("1+2^3*2-1", 0, 0, 16);
+    test__eval("2^3^1*2", 0, 0, 16);
+    test__eval("1-2*3-4*5", 0, 0, -25);
+    test__eval("2*(3+4)*5", 0, 0, 70);
+    test__eval("-y*y-x*y", 2, 3, -15);
+    test__eval("y + x*y^2*2 + 1", 2, 3, 40);
+    test__eval("x*y^2/3+y", 2, 3, 9);
+    test__eval("sin(x)*2+cos(y)^2*3", 2, 3, sin(2) * 2 + cos(3) * cos(3) * 3);
+}
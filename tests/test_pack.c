@@ -0,0 +1,33 @@
+#include "test.h"
+#include "../pack.h"
+
+// packs x from x0 by dx and looks every point up again
+static void test__find(double x0, double dx)
+{
+    pack_t pack;
+    const u32 points = 5 * PACK_BLOCK_SIZE + 17;
+    int pushed = 1;
+
+    TEST_CHECK(init_pack(&pack, 1, 0));
+    for (u32 i = 0; i < points; i ++)
+    {
+        const double y = i;
+        pushed &= pack_push(&pack, x0 + i * dx, &y);
+    }
+    TEST_CHECK(pushed && pack_flush(&pack));
+
+    u32 wrong = 0;
+    for (u32 i = 0; i < points; i ++)
+        wrong += pack_find_block(&pack, x0 + i * dx) != i / PACK_BLOCK_SIZE;
+    TEST_CHECK(wrong == 0);
+    // past the end of the run in its own direction there is no block
+    TEST_CHECK(pack_find_block(&pack, x0 + points * dx) == pack.block_count);
+    TEST_CHECK(pack_find_block(&pack, x0 - dx) == 0);
+    destroy_pack(&pack);
+}
+
+void test_pack(void)
+{
+    test__find(0, 0.25);
+    test__find(10, -0.25);
+}
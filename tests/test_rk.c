@@ -0,0 +1,29 @@
+#include "test.h"
+#include "../rk.h"
+
+static const char test__rk4[] =
+    "name rk4\n"
+    "order 4\n"
+    "a 1/2\n"
+    "a 0 1/2\n"
+    "a 0 0 1\n"
+    "b 1/6 1/3 1/3 1/6\n";
+
+void test_rk(void)
+{
+    rk_tableau_t t;
+    char error[128] = "";
+    char text[512];
+
+    TEST_CHECK(rk_parse_tableau(&t, test__rk4, sizeof(test__rk4) - 1, error, sizeof(error)));
+    TEST_CHECK(t.stages == 4 && t.order == 4);
+    TEST_NEAR(t.c[3], 1, 0);
+
+    // one weight past the limit is an error, not a shorter method
+    int n = snprintf(text, sizeof(text), "b");
+    for (u32 i = 0; i <= RK_MAX_STAGES; i ++)
+        n += snprintf(text + n, sizeof(text) - n, " 1/%u", RK_MAX_STAGES + 1);
+    error[0] = 0;
+    TEST_CHECK(!rk_parse_tableau(&t, text, n, error, sizeof(error)));
+    TEST_CHECK(strstr(error, "at most 16 stages") != NULL);
+}
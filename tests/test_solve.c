@@ -0,0 +1,74 @@
+#include "test.h"
+#include "../solve.h"
+#include "../system.h"
+
+typedef struct
+{
+    u32 count;
+    double x, y;
+} test_last_t;
+
+static int test__keep(void *user, double x, const double *y, u32 dim)
+{
+    test_last_t *last = (test_last_t *)user;
+    (void)dim;
+    last->count ++;
+    last->x = x;
+    last->y = y[0];
+    return 1;
+}
+
+// every fixed step solver ends on x1, with the last step cut short when h
+// does not divide the range
+static void test__fixed_end(double h, u32 points)
+{
+    mexp_parser_t parser;
+    system_t sys;
+    ode_t ode;
+    double values[128] = {0};
+    const char *expr = "y'' = -y";
+
+    mexp_init_parser(&parser);
+    init_system(&sys);
+    TEST_CHECK(parse_system(&sys, &parser, expr, (u32)strlen(expr)));
+    init_ode(&ode, &sys.prog);
+    system_bind(&sys, &ode, values);
+
+    for (u32 i = 0; i < solver_builtin_count(); i ++)
+    {
+        solver_t solver;
+        solve_params_t params;
+        solve_stats_t stats;
+        test_last_t last = {0, 0, 0};
+
+        solver_builtin(i, &solver);
+        init_solve_params(&params);
+        params.x0 = 0;
+        params.x1 = 1;
+        params.h = h;
+        params.y0[0] = 1;
+        params.y0[1] = 0;
+        if (!solve(&solver, &ode, &params, test__keep, &last, &stats))
+        {
+            fprintf(stderr, "%s: h = %g failed\n", solver.name, h);
+            TEST_CHECK(!"solve");
+            continue;
+        }
+        if (last.count != points || last.x != 1)
+            fprintf(stderr, "%s: h = %g gave %u points up to x = %.17g\n", solver.name, h, last.count, last.x);
+        TEST_CHECK(last.count == points);
+        TEST_CHECK(last.x == 1);
+        // even euler at h = 0.4 lands within this of cos(1)
+        TEST_NEAR(last.y, cos(1), 0.25);
+    }
+    destroy_system(&sys);
+    mexp_free_parser(&parser);
+}
+
+void test_solve(void)
+{
+    test__fixed_end(0.25, 5);
+    test__fixed_end(0.3, 5);
+    test__fixed_end(0.4, 4);
+    test__fixed_end(0.1, 11);
+}
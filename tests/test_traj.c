@@ -0,0 +1,80 @@
+#include "test.h"
+#include "../traj.h"
+#include <stddef.h>
+
+#define TEST_TRAJ_FILE "test_traj.tmp"
+
+// rewrites one header or index field of the written file and tries to open it
+static int test__open_patched(u64 at, const void *value, size_t length)
+{
+    traj_reader_t reader;
+    char error[128];
+    FILE *fp = fopen(TEST_TRAJ_FILE, "r+b");
+    if (!fp)
+        return -1;
+    fseek(fp, (long)at, SEEK_SET);
+    fwrite(value, 1, length, fp);
+    fclose(fp);
+
+    int ok = traj_open_reader(&reader, TEST_TRAJ_FILE, error, sizeof(error));
+    if (ok)
+        traj_close_reader(&reader);
+    return ok;
+}
+
+void test_traj(void)
+{
+    traj_writer_t writer;
+    traj_reader_t reader;
+    traj_header_t header;
+    char error[128];
+    const u32 points = TRAJ_BLOCK_SIZE + 100;
+
+    TEST_CHECK(traj_open_writer(&writer, TEST_TRAJ_FILE, "y", "rk4", 0.5, 2));
+    int written = 1;
+    for (u32 i = 0; i < points; i ++)
+    {
+        double y[2] = { i % 1000 == 0 ? 100.0 : 0.0, -1.0 };
+        written &= traj_write(&writer, i * 0.5, y);
+    }
+    TEST_CHECK(traj_close_writer(&writer) && written);
+
+    TEST_CHECK(traj_open_reader(&reader, TEST_TRAJ_FILE, error, sizeof(error)));
+    if (!reader.header)
+        return;
+    header = *reader.header;
+    const traj_index_t first = reader.index[0];
+    TEST_CHECK(header.point_count == points);
+    TEST_CHECK(header.block_count == 2);
+    TEST_CHECK(first.y_max == 100.0);
+    TEST_CHECK(traj_block_y(&reader, 1, 1)[0] == -1.0);
+    traj_close_reader(&reader);
+
+    // each lie in the header has to be caught, the original goes back after
+    const u32 dims[] = { 0xffffffffu, 0x7fffffffu, 3 };
+    for (u32 i = 0; i < sizeof(dims) / sizeof(dims[0]); i ++)
+    {
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, dim), &dims[i], sizeof(u32)) == 0);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, dim), &header.dim, sizeof(u32)) == 1);
+    }
+    const u64 counts[] = { 0xffffffffffffffffull, (u64)1 << 61, points + 1 };
+    for (u32 i = 0; i < sizeof(counts) / sizeof(counts[0]); i ++)
+    {
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, point_count), &counts[i], sizeof(u64)) == 0);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, point_count), &header.point_count, sizeof(u64)) == 1);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, block_count), &counts[i], sizeof(u64)) == 0);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, block_count), &header.block_count, sizeof(u64)) == 1);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, index_offset), &counts[i], sizeof(u64)) == 0);
+        TEST_CHECK(test__open_patched(offsetof(traj_header_t, index_offset), &header.index_offset, sizeof(u64)) == 1);
+    }
+    const u64 block = header.index_offset;
+    const u64 offsets[] = { 0xfffffffffffffff8ull, 0, header.index_offset - 8 };
+    for (u32 i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i ++)
+    {
+        TEST_CHECK(test__open_patched(block + offsetof(traj_index_t, offset), &offsets[i], sizeof(u64)) == 0);
+        TEST_CHECK(test__open_patched(block + offsetof(traj_index_t, offset), &first.offset, sizeof(u64)) == 1);
+    }
+    const u32 big = 0xffffffffu;
+    TEST_CHECK(test__open_patched(block + offsetof(traj_index_t, count), &big, sizeof(u32)) == 0);
+    remove(TEST_TRAJ_FILE);
+}
@@ -0,0 +1,212 @@
+#include "traj.h"
+#include <math.h>
+#include <stdlib.h>
+
+static u64 traj__padded(u64 n)
+{
+    return (n + 7) & ~(u64)7;
+}
+
+static void traj__reset_block(traj_index_t *block)
+{
+    block->count = 0;
+    block->reserved = 0;
+    block->x_min = INFINITY;
+    block->x_max = -INFINITY;
+    block->y_min = INFINITY;
+    block->y_max = -INFINITY;
+}
+
+static int traj__flush_block(traj_writer_t *w)
+{
+    traj_index_t *b = &w->block;
+    const u32 bs = w->header.block_size;
+    if (b->count == 0)
+        return 1;
+
+    // the buffer is laid out for a full block, columns are written trimmed
+    b->offset = w->offset;
+    for (u32 c = 0; c <= w->header.dim; c ++)
+        if (fwrite(w->buffer + (size_t)c * bs, sizeof(double), b->count, w->fp) != b->count)
+            return 0;
+    if (fwrite(b, sizeof(*b), 1, w->index_fp) != 1)
+        return 0;
+
+    w->offset += (u64)b->count * (w->header.dim + 1) * sizeof(double);
+    w->header.block_count ++;
+    w->header.x_min = fmin(w->header.x_min, b->x_min);
+    w->header.x_max = fmax(w->header.x_max, b->x_max);
+    w->header.y_min = fmin(w->header.y_min, b->y_min);
+    w->header.y_max = fmax(w->header.y_max, b->y_max);
+    traj__reset_block(b);
+    return 1;
+}
+
+int traj_open_writer(traj_writer_t *w, const char *file_name, const char *expr, const char *method, double h, u32 dim)
+{
+    static const u8 zeros[8] = {0};
+    traj_header_t *hd = &w->header;
+
+    memset(w, 0, sizeof(*w));
+    memcpy(hd->magic, TRAJ_MAGIC, sizeof(TRAJ_MAGIC));
+    hd->version    = TRAJ_VERSION;
+    hd->byte_order = TRAJ_BYTE_ORDER;
+    hd->dim        = dim;
+    hd->block_size = TRAJ_BLOCK_SIZE;
+    snprintf(hd->method, sizeof(hd->method), "%s", method);
+    hd->h = h;
+    hd->x_min = INFINITY;
+    hd->x_max = -INFINITY;
+    hd->y_min = INFINITY;
+    hd->y_max = -INFINITY;
+    hd->expr_length = (u32)strlen(expr);
+    traj__reset_block(&w->block);
+
+    w->buffer = (double *)malloc((size_t)TRAJ_BLOCK_SIZE * (dim + 1) * sizeof(double));
+    w->fp = fopen(file_name, "wb");
+    w->index_fp = tmpfile();
+    if (!w->buffer || !w->fp || !w->index_fp)
+    {
+        traj_close_writer(w);
+        return 0;
+    }
+
+    // the header is written again with the final counts on close
+    fwrite(hd, sizeof(*hd), 1, w->fp);
+    fwrite(expr, 1, hd->expr_length, w->fp);
+    fwrite(zeros, 1, traj__padded(hd->expr_length) - hd->expr_length, w->fp);
+    w->offset = sizeof(*hd) + traj__padded(hd->expr_length);
+    return 1;
+}
+
+int traj_write(traj_writer_t *w, double x, const double *y)
+{
+    traj_index_t *b = &w->block;
+    const u32 bs = w->header.block_size;
+
+    w->buffer[b->count] = x;
+    for (u32 c = 0; c < w->header.dim; c ++)
+        w->buffer[(size_t)(c + 1) * bs + b->count] = y[c];
+    b->x_min = fmin(b->x_min, x);
+    b->x_max = fmax(b->x_max, x);
+    if (isfinite(y[0]))
+    {
+        b->y_min = fmin(b->y_min, y[0]);
+        b->y_max = fmax(b->y_max, y[0]);
+    }
+    b->count ++;
+    w->header.point_count ++;
+
+    if (b->count == bs)
+        return traj__flush_block(w);
+    return 1;
+}
+
+int traj_close_writer(traj_writer_t *w)
+{
+    int ok = w->fp && w->index_fp;
+    if (ok)
+    {
+        char buf[1 << 14];
+        size_t n;
+        ok = traj__flush_block(w);
+        w->header.index_offset = w->offset;
+        rewind(w->index_fp);
+        while (ok && (n = fread(buf, 1, sizeof(buf), w->index_fp)) > 0)
+            ok = fwrite(buf, 1, n, w->fp) == n;
+        ok = ok && fseek(w->fp, 0, SEEK_SET) == 0;
+        ok = ok && fwrite(&w->header, sizeof(w->header), 1, w->fp) == 1;
+    }
+    if (w->fp && fclose(w->fp) != 0)
+        ok = 0;
+    if (w->index_fp)
+        fclose(w->index_fp);
+    free(w->buffer);
+    w->fp = NULL;
+    w->index_fp = NULL;
+    w->buffer = NULL;
+    return ok;
+}
+
+int traj_open_reader(traj_reader_t *reader, const char *file_name, char *error, size_t error_length)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (!pf_map_file(&reader->mapping, file_name))
+    {
+        snprintf(error, error_length, "could not map '%s'", file_name);
+        return 0;
+    }
+
+    const u8 *base = (const u8 *)reader->mapping.data;
+    const u64 size = reader->mapping.size;
+    const traj_header_t *hd = (const traj_header_t *)base;
+    if (size < sizeof(*hd) || memcmp(hd->magic, TRAJ_MAGIC, sizeof(TRAJ_MAGIC)) != 0)
+    {
+        snprintf(error, error_length, "not a trajectory file");
+        goto fail;
+    }
+    if (hd->version != TRAJ_VERSION || hd->byte_order != TRAJ_BYTE_ORDER)
+    {
+        snprintf(error, error_length, "unsupported trajectory version %u", hd->version);
+        goto fail;
+    }
+    // every count is checked by division against the bytes that are there,
+    // so nothing in the header can overflow its way past the mapping
+    const u64 data = sizeof(*hd) + traj__padded(hd->expr_length);
+    const u64 row = ((u64)hd->dim + 1) * sizeof(double);
+    if (hd->dim == 0 || hd->block_size == 0 || data > size ||
+        hd->index_offset < data || hd->index_offset > size || hd->index_offset % 8 != 0 ||
+        (size - hd->index_offset) / sizeof(traj_index_t) < hd->block_count ||
+        (hd->index_offset - data) / row < hd->point_count)
+    {
+        snprintf(error, error_length, "truncated trajectory file");
+        goto fail;
+    }
+
+    reader->header = hd;
+    reader->expr   = (const char *)(base + sizeof(*hd));
+    reader->index  = (const traj_index_t *)(base + hd->index_offset);
+    u64 points = 0;
+    for (u64 i = 0; i < hd->block_count; i ++)
+    {
+        const traj_index_t *b = &reader->index[i];
+        if (b->count == 0 || b->count > hd->block_size || b->offset < data || b->offset % 8 != 0 ||
+            b->offset > hd->index_offset || (hd->index_offset - b->offset) / row < b->count)
+        {
+            snprintf(error, error_length, "corrupt block %llu", (unsigned long long)i);
+            goto fail;
+        }
+        points += b->count;
+    }
+    if (points != hd->point_count)
+    {
+        snprintf(error, error_length, "blocks hold %llu points, header says %llu",
+                (unsigned long long)points, (unsigned long long)hd->point_count);
+        goto fail;
+    }
+    return 1;
+
+fail:
+    traj_close_reader(reader);
+    return 0;
+}
+
+void traj_close_reader(traj_reader_t *reader)
+{
+    pf_unmap_file(&reader->mapping);
+    reader->header = NULL;
+    reader->expr   = NULL;
+    reader->index  = NULL;
+}
+
+u64 traj_find_block(const traj_reader_t *reader, double x)
+{
+    u64 lo = 0, hi = reader->header->block_count;
+    while (lo < hi)
+    {
+        u64 mid = lo + (hi - lo) / 2;
+        if (reader->index[mid].x_max < x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+#include "platform.h"
+#include <stdio.h>
+
+// binary trajectory file, all values in native byte order:
+//   traj_header_t, expression text padded to 8 bytes,
+//   blocks of up to block_size points stored as x[count] then y_0[count] ... y_dim-1[count],
+//   traj_index_t per block at index_offset
+#define TRAJ_MAGIC "ERKTRAJ"
+#define TRAJ_VERSION 1
+#define TRAJ_BYTE_ORDER 0x01020304
+#define TRAJ_BLOCK_SIZE 4096
+#define TRAJ_METHOD_LENGTH 16
+
+typedef struct traj_header_t
+{
+    char magic[8];
+    u32 version;
+    u32 byte_order;
+    u32 dim;
+    u32 block_size;
+    char method[TRAJ_METHOD_LENGTH];
+    double h;
+    double x_min, x_max;
+    double y_min, y_max;
+    u64 point_count;
+    u64 block_count;
+    u64 index_offset;
+    u32 expr_length;
+    u32 reserved;
+} traj_header_t;
+
+typedef struct traj_index_t
+{
+    u64 offset;
+    u32 count;
+    u32 reserved;
+    double x_min, x_max;
+    double y_min, y_max;
+} traj_index_t;
+
+// streams blocks to disk as they fill, the index is spooled to a temporary
+// file so memory use does not grow with the run length
+typedef struct traj_writer_t
+{
+    FILE *fp;
+    FILE *index_fp;
+    traj_header_t header;
+    traj_index_t block;
+    double *buffer;
+    u64 offset;
+} traj_writer_t;
+
+typedef struct traj_reader_t
+{
+    pf_mapping_t mapping;
+    const traj_header_t *header;
+    const char *expr;
+    const traj_index_t *index;
+} traj_reader_t;
+
+int  traj_open_writer(traj_writer_t *writer, const char *file_name, const char *expr, const char *method, double h, u32 dim);
+int  traj_write(traj_writer_t *writer, double x, const double *y);
+int  traj_close_writer(traj_writer_t *writer);
+
+int  traj_open_reader(traj_reader_t *reader, const char *file_name, char *error, size_t error_length);
+void traj_close_reader(traj_reader_t *reader);
+// first block whose x range reaches x, x has to be increasing
+u64  traj_find_block(const traj_reader_t *reader, double x);
+
+static inline const double *traj_block_x(const traj_reader_t *reader, u64 block)
+{ return (const double *)((const u8 *)reader->mapping.data + reader->index[block].offset); }
+static inline const double *traj_block_y(const traj_reader_t *reader, u64 block, u32 component)
+{ return traj_block_x(reader, block) + (size_t)reader->index[block].count * (component + 1); }